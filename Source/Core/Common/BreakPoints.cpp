@@ -170,12 +170,11 @@ void MemChecks::AddFromStrings(const TMemChecksStr& mcstrs)
 
 void MemChecks::Add(const TMemCheck& _rMemoryCheck)
 {
-  bool had_any = HasAny();
   if (GetMemCheck(_rMemoryCheck.StartAddress) == nullptr)
     m_MemChecks.push_back(_rMemoryCheck);
-  // If this is the first one, clear the JIT cache so it can switch to
-  // watchpoint-compatible code.
-  if (!had_any && jit)
+  // The JIT compiles accesses to watched memory differently, and the
+  // fastmem arena leaves watched pages unmapped, so both need an update.
+  if (jit)
     jit->GetBlockCache()->SchedulateClearCacheThreadSafe();
 }
 
@@ -186,13 +185,32 @@ void MemChecks::Remove(u32 _Address)
     if (i->StartAddress == _Address)
     {
       m_MemChecks.erase(i);
-      if (!HasAny() && jit)
+      if (jit)
         jit->GetBlockCache()->SchedulateClearCacheThreadSafe();
       return;
     }
   }
 }
 
+void MemChecks::Clear()
+{
+  if (HasAny() && jit)
+    jit->GetBlockCache()->SchedulateClearCacheThreadSafe();
+  m_MemChecks.clear();
+}
+
+bool MemChecks::OverlapsMemoryRange(u32 address, u32 size) const
+{
+  const u32 end = address + size - 1;
+  for (const TMemCheck& mc : m_MemChecks)
+  {
+    const u32 mc_end = mc.bRange ? mc.EndAddress : mc.StartAddress;
+    if (mc.StartAddress <= end && address <= mc_end)
+      return true;
+  }
+  return false;
+}
+
 TMemCheck* MemChecks::GetMemCheck(u32 address)
 {
   for (TMemCheck& bp : m_MemChecks)
@@ -96,9 +96,11 @@ public:
 
   // memory breakpoint
   TMemCheck* GetMemCheck(u32 address);
+  // Whether any memory check watches an address in [address, address + size).
+  bool OverlapsMemoryRange(u32 address, u32 size) const;
   void Remove(u32 _Address);
 
-  void Clear() { m_MemChecks.clear(); }
+  void Clear();
   bool HasAny() const { return !m_MemChecks.empty(); }
 };
 
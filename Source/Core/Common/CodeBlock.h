@@ -68,6 +68,16 @@ public:
     }
   }
 
+  // Call this right after AllocCodeSpace. Poisons the code space so that it's faulted in with
+  // huge pages where possible, and returns how many bytes of it are.
+  size_t UseHugePages()
+  {
+    if (!Common::AdviseHugePages(region, region_size))
+      return 0;
+    PoisonMemory();
+    return Common::GetHugePageBytes(region, region_size);
+  }
+
   bool IsInSpace(u8* ptr) const { return (ptr >= region) && (ptr < (region + region_size)); }
   // Cannot currently be undone. Will write protect the entire code region.
   // Start over if you need to change the code (call FreeCodeSpace(), AllocCodeSpace()).
@@ -0,0 +1,98 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+// A bounded lock-free queue with any number of writers and a single reader, which never
+// allocates. Every slot has a sequence number telling whether it's free for the writer of a given
+// position or filled for the reader, see Dmitry Vyukov's bounded MPMC queue.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace Common
+{
+template <typename T, size_t Size>
+class MPSCQueue
+{
+  static_assert(Size && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+public:
+  MPSCQueue()
+  {
+    for (size_t i = 0; i < Size; i++)
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  // Can be called from any thread. Returns false if the queue is full.
+  template <typename Arg>
+  bool TryPush(Arg&& t)
+  {
+    size_t position = m_write_position.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true)
+    {
+      slot = &m_slots[position & (Size - 1)];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const ptrdiff_t difference =
+          static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+      if (difference == 0)
+      {
+        if (m_write_position.compare_exchange_weak(position, position + 1,
+                                                   std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (difference < 0)
+      {
+        // The reader hasn't freed the slot from the last time around yet.
+        return false;
+      }
+      else
+      {
+        // Another writer took the position.
+        position = m_write_position.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->value = std::forward<Arg>(t);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only to be called from the reader thread. Stops at a slot whose writer hasn't finished yet,
+  // even if later ones are filled.
+  bool Pop(T& t)
+  {
+    Slot& slot = m_slots[m_read_position & (Size - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != m_read_position + 1)
+      return false;
+
+    t = std::move(slot.value);
+    slot.sequence.store(m_read_position + Size, std::memory_order_release);
+    m_read_position++;
+    return true;
+  }
+
+  // Only to be called from the reader thread. Also false while a writer is still filling a slot.
+  bool Empty() const { return m_write_position.load(std::memory_order_acquire) == m_read_position; }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::array<Slot, Size> m_slots;
+  // Writers and the reader on separate cache lines.
+  alignas(64) std::atomic<size_t> m_write_position{0};
+  alignas(64) size_t m_read_position = 0;
+};
+}
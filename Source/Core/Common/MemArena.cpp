@@ -10,6 +10,7 @@
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/MsgHandler.h"
 #include "Common/StringUtil.h"
 
@@ -21,6 +22,9 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #ifdef ANDROID
 #include <linux/ashmem.h>
 #include <sys/ioctl.h>
@@ -51,8 +55,9 @@ static int AshmemCreateFileMapping(const char* name, size_t size)
 }
 #endif
 
-void MemArena::GrabSHMSegment(size_t size)
+void MemArena::GrabSHMSegment(size_t size, bool huge_pages)
 {
+  m_huge_pages = false;
 #ifdef _WIN32
   hMemoryMapping =
       CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, (DWORD)(size), nullptr);
@@ -64,6 +69,22 @@ void MemArena::GrabSHMSegment(size_t size)
     return;
   }
 #else
+#if defined(__linux__) && defined(__NR_memfd_create)
+  // Files in /dev/shm only get huge pages if it was mounted with them. memfd files follow
+  // /sys/kernel/mm/transparent_hugepage/shmem_enabled, which honors madvise with "advise".
+  if (huge_pages)
+  {
+    fd = static_cast<int>(syscall(__NR_memfd_create, "dolphin-emu", 0));
+    if (fd != -1)
+    {
+      if (ftruncate(fd, size) < 0)
+        ERROR_LOG(MEMMAP, "Failed to allocate low memory space");
+      m_huge_pages = true;
+      return;
+    }
+    WARN_LOG(MEMMAP, "memfd_create failed: %s", strerror(errno));
+  }
+#endif
   for (int i = 0; i < 10000; i++)
   {
     std::string file_name = StringFromFormat("/dolphinmem.%d", i);
@@ -109,6 +130,9 @@ void* MemArena::CreateView(s64 offset, size_t size, void* base)
   }
   else
   {
+    // Views of single pages are mapped all the time with the MMU, and can't use huge pages.
+    if (m_huge_pages && size >= Common::HUGE_PAGE_SIZE)
+      Common::AdviseHugePages(retval, size);
     return retval;
   }
 #endif
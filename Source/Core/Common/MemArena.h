@@ -20,7 +20,8 @@
 class MemArena
 {
 public:
-  void GrabSHMSegment(size_t size);
+  // With huge_pages, views are backed by transparent huge pages where the OS allows it.
+  void GrabSHMSegment(size_t size, bool huge_pages = false);
   void ReleaseSHMSegment();
   void* CreateView(s64 offset, size_t size, void* base = nullptr);
   void ReleaseView(void* view, size_t size);
@@ -34,4 +35,5 @@ private:
 #else
   int fd;
 #endif
+  bool m_huge_pages = false;
 };
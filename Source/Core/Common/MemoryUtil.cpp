@@ -2,6 +2,7 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
 #include <string>
@@ -223,6 +224,61 @@ void UnWriteProtectMemory(void* ptr, size_t size, bool allowExecute)
     PanicAlert("UnWriteProtectMemory failed!\n%s", GetLastErrorMsg().c_str());
 }
 
+bool AdviseHugePages(void* ptr, size_t size)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  const uintptr_t start = (reinterpret_cast<uintptr_t>(ptr) + HUGE_PAGE_SIZE - 1) &
+                          ~(HUGE_PAGE_SIZE - 1);
+  const uintptr_t end = (reinterpret_cast<uintptr_t>(ptr) + size) & ~(HUGE_PAGE_SIZE - 1);
+  if (start >= end)
+    return true;
+  if (madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE) != 0)
+  {
+    WARN_LOG(COMMON, "madvise(MADV_HUGEPAGE) failed: %s", GetLastErrorMsg().c_str());
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t GetHugePageBytes(const void* ptr, size_t size)
+{
+#ifdef __linux__
+  FILE* file = fopen("/proc/self/smaps", "r");
+  if (!file)
+    return 0;
+
+  const uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t end = start + size;
+  size_t bytes = 0;
+  size_t overlap = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), file))
+  {
+    // Every mapping starts with its range, followed by its fields.
+    unsigned long long map_start, map_end, kb;
+    if (sscanf(line, "%llx-%llx ", &map_start, &map_end) == 2)
+    {
+      if (map_start < end && map_end > start)
+        overlap = std::min<uintptr_t>(map_end, end) - std::max<uintptr_t>(map_start, start);
+      else
+        overlap = 0;
+    }
+    else if (overlap && (sscanf(line, "AnonHugePages: %llu kB", &kb) == 1 ||
+                         sscanf(line, "ShmemPmdMapped: %llu kB", &kb) == 1))
+    {
+      bytes += std::min<size_t>(kb * 1024, overlap);
+    }
+  }
+  fclose(file);
+  return std::min(bytes, size);
+#else
+  return 0;
+#endif
+}
+
 std::string MemUsage()
 {
 #ifdef _WIN32
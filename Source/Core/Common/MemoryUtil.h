@@ -9,6 +9,9 @@
 
 namespace Common
 {
+// The size of a huge page on x86-64 and on ARM64 with 4 KiB pages.
+constexpr size_t HUGE_PAGE_SIZE = 0x200000;
+
 void* AllocateExecutableMemory(size_t size, bool low = true);
 void* AllocateMemoryPages(size_t size);
 void FreeMemoryPages(void* ptr, size_t size);
@@ -17,6 +20,11 @@ void FreeAlignedMemory(void* ptr);
 void ReadProtectMemory(void* ptr, size_t size);
 void WriteProtectMemory(void* ptr, size_t size, bool executable = false);
 void UnWriteProtectMemory(void* ptr, size_t size, bool allowExecute = false);
+// Asks for the huge pages which fit into the range to be used when it's faulted in. Returns false
+// if the OS doesn't support transparent huge pages.
+bool AdviseHugePages(void* ptr, size_t size);
+// Returns how many bytes of the range are mapped with huge pages.
+size_t GetHugePageBytes(const void* ptr, size_t size);
 std::string MemUsage();
 size_t MemPhysical();
 
@@ -0,0 +1,95 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/SwapCopy.h"
+
+#include <cstddef>
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+
+#ifdef _M_X86
+#include "Common/CPUDetect.h"
+#include "Common/Intrinsics.h"
+
+// The rest of the code is built for SSE2, so the kernels enable what they use themselves.
+#ifdef _MSC_VER
+#define FUNCTION_TARGET(x)
+#else
+#define FUNCTION_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace Common
+{
+namespace
+{
+#ifdef _M_X86
+// Both return how many bytes they copied, which is a multiple of their vector size.
+FUNCTION_TARGET("ssse3")
+size_t CopySwappedSSSE3(u8* dst, const u8* src, size_t bytes, int element_size)
+{
+  const __m128i mask = element_size == 2 ?
+                           _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1) :
+                           _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  size_t i = 0;
+  for (; i + 16 <= bytes; i += 16)
+  {
+    const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(data, mask));
+  }
+  return i;
+}
+
+FUNCTION_TARGET("avx2")
+size_t CopySwappedAVX2(u8* dst, const u8* src, size_t bytes, int element_size)
+{
+  // vpshufb shuffles within each 128-bit lane, so the mask is the same for both.
+  const __m256i mask =
+      element_size == 2 ?
+          _mm256_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13,
+                          10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1) :
+          _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3, 12, 13, 14, 15,
+                          8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  size_t i = 0;
+  for (; i + 32 <= bytes; i += 32)
+  {
+    const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(data, mask));
+  }
+  return i;
+}
+#endif
+
+// Returns how many elements were copied with vector instructions.
+size_t CopySwappedVector(void* dst, const void* src, size_t count, int element_size)
+{
+#ifdef _M_X86
+  u8* dst_bytes = static_cast<u8*>(dst);
+  const u8* src_bytes = static_cast<const u8*>(src);
+  const size_t bytes = count * element_size;
+  size_t done = 0;
+  if (cpu_info.bAVX2)
+    done = CopySwappedAVX2(dst_bytes, src_bytes, bytes, element_size);
+  if (cpu_info.bSSSE3)
+    done += CopySwappedSSSE3(dst_bytes + done, src_bytes + done, bytes - done, element_size);
+  return done / element_size;
+#else
+  return 0;
+#endif
+}
+}  // namespace
+
+void CopySwapped(u16* dst, const u16* src, size_t count)
+{
+  for (size_t i = CopySwappedVector(dst, src, count, sizeof(u16)); i < count; i++)
+    dst[i] = swap16(src[i]);
+}
+
+void CopySwapped(u32* dst, const u32* src, size_t count)
+{
+  for (size_t i = CopySwappedVector(dst, src, count, sizeof(u32)); i < count; i++)
+    dst[i] = swap32(src[i]);
+}
+}
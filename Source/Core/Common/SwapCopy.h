@@ -0,0 +1,17 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+// Copies count elements from src to dst, swapping the bytes of each of them. Uses SSSE3 or AVX2
+// when the CPU has them. dst may be src, but the ranges must not overlap otherwise.
+void CopySwapped(u16* dst, const u16* src, size_t count);
+void CopySwapped(u32* dst, const u32* src, size_t count);
+}
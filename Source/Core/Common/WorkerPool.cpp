@@ -0,0 +1,73 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/WorkerPool.h"
+
+#include <utility>
+
+#include "Common/Thread.h"
+
+namespace Common
+{
+WorkerPool::WorkerPool(size_t num_threads, const std::string& name)
+{
+  for (size_t i = 1; i < num_threads; ++i)
+    m_threads.emplace_back(&WorkerPool::WorkerThread, this, i, name + " " + std::to_string(i));
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_shutdown = true;
+  }
+  m_work_available.notify_all();
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void WorkerPool::Run(const std::function<void(size_t)>& function)
+{
+  if (!m_threads.empty())
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_function = &function;
+      m_busy_threads = m_threads.size();
+      m_generation++;
+    }
+    m_work_available.notify_all();
+  }
+
+  function(0);
+
+  // Every worker has to finish before the next call, so none of them can miss one.
+  std::unique_lock<std::mutex> lk(m_mutex);
+  m_work_done.wait(lk, [&] { return m_busy_threads == 0; });
+  m_function = nullptr;
+}
+
+void WorkerPool::WorkerThread(size_t index, std::string name)
+{
+  SetCurrentThreadName(name.c_str());
+
+  u64 generation = 0;
+  std::unique_lock<std::mutex> lk(m_mutex);
+  while (true)
+  {
+    m_work_available.wait(lk, [&] { return m_shutdown || m_generation != generation; });
+    if (m_shutdown)
+      return;
+    generation = m_generation;
+
+    const std::function<void(size_t)>* function = m_function;
+    lk.unlock();
+    (*function)(index);
+    lk.lock();
+
+    if (--m_busy_threads == 0)
+      m_work_done.notify_one();
+  }
+}
+}
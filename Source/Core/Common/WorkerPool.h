@@ -0,0 +1,48 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+// A fixed set of threads which run a function together, for splitting up work which has to be
+// done in small batches many times a second. The thread calling Run takes part in it, so a pool of
+// one thread doesn't start any.
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+class WorkerPool final
+{
+public:
+  WorkerPool(size_t num_threads, const std::string& name);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  size_t GetNumThreads() const { return m_threads.size() + 1; }
+  // Calls function on every thread of the pool with the index of the thread, 0 being the calling
+  // thread, and returns once all of them are done.
+  void Run(const std::function<void(size_t)>& function);
+
+private:
+  void WorkerThread(size_t index, std::string name);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_work_available;
+  std::condition_variable m_work_done;
+  const std::function<void(size_t)>* m_function = nullptr;
+  u64 m_generation = 0;
+  size_t m_busy_threads = 0;
+  bool m_shutdown = false;
+};
+}
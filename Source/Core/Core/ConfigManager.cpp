@@ -588,6 +588,17 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("BBA_MAC", &m_bba_mac);
   core->Get("TimeProfiling", &bJITILTimeProfiling, false);
   core->Get("OutputIR", &bJITILOutputIR, false);
+  core->Get("JITTiered", &bJITTiered, false);
+  core->Get("JITTraces", &bJITTraces, false);
+  core->Get("JITAnalysisCache", &bJITAnalysisCache, false);
+  core->Get("JITIdleLoops", &bJITIdleLoops, false);
+  core->Get("SamplingProfiler", &bSamplingProfiler, false);
+  core->Get("SamplingProfilerRate", &iSamplingProfilerRate, 1000);
+  core->Get("HugePages", &bHugePages, false);
+  core->Get("BatchGatherPipe", &bBatchGatherPipe, false);
+  core->Get("DSPHLEVoiceThreads", &iDSPHLEVoiceThreads, 0);
+  core->Get("DSPUCodeCache", &bDSPUCodeCache, false);
+  core->Get("HLEMemoryFunctions", &bHLEMemoryFunctions, false);
   for (int i = 0; i < MAX_SI_CHANNELS; ++i)
   {
     core->Get(StringFromFormat("SIDevice%i", i), (u32*)&m_SIDevice[i],
@@ -602,6 +613,7 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("RunCompareServer", &bRunCompareServer, false);
   core->Get("RunCompareClient", &bRunCompareClient, false);
   core->Get("MMU", &bMMU, false);
+  core->Get("MMUFastmem", &bMMUFastmem, false);
   core->Get("BBDumpPort", &iBBDumpPort, -1);
   core->Get("SyncGPU", &bSyncGPU, false);
   core->Get("SyncGpuMaxDistance", &iSyncGpuMaxDistance, 200000);
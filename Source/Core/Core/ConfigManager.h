@@ -82,6 +82,28 @@ struct SConfig : NonCopyable
   bool bJITBranchOff = false;
   bool bJITILTimeProfiling = false;
   bool bJITILOutputIR = false;
+  // Run cold blocks in the interpreter and compile them once they get hot.
+  bool bJITTiered = false;
+  // Recompile hot blocks into traces following their mostly taken branches.
+  bool bJITTraces = false;
+  // Keep the analysis of blocks in the user cache directory between runs.
+  bool bJITAnalysisCache = false;
+  // Skip loops which only wait for memory or CTR to change, and report them.
+  bool bJITIdleLoops = false;
+  // Sample where the emulator spends its time, see SamplingProfiler.h.
+  bool bSamplingProfiler = false;
+  int iSamplingProfilerRate = 1000;
+  // Back emulated memory and JIT code with transparent huge pages where the OS allows it.
+  bool bHugePages = false;
+  // Let JIT blocks fill the gather pipe with several bursts before sending them to the FIFO.
+  bool bBatchGatherPipe = false;
+  // Threads the DSP HLE spreads AX voices over. 0 or 1 processes them on the DSP thread only.
+  int iDSPHLEVoiceThreads = 0;
+  // Keep the analysis of DSP LLE ucodes and the blocks compiled for them in the user cache
+  // directory between runs.
+  bool bDSPUCodeCache = false;
+  // Replace memcpy, memset and the data cache range functions of games with native versions.
+  bool bHLEMemoryFunctions = false;
 
   bool bFastmem;
   bool bFPRF = false;
@@ -105,6 +127,8 @@ struct SConfig : NonCopyable
   bool bRunCompareClient = false;
 
   bool bMMU = false;
+  // Mirror page table translations into the logical address space for fastmem.
+  bool bMMUFastmem = false;
   bool bDCBZOFF = false;
   int iBBDumpPort = 0;
   bool bFastDiscSpeed = false;
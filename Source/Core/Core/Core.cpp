@@ -20,6 +20,7 @@
 #include "Common/CPUDetect.h"
 #include "Common/CommonPaths.h"
 #include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
 #include "Common/Flag.h"
 #include "Common/Logging/LogManager.h"
 #include "Common/MathUtil.h"
@@ -64,6 +65,7 @@
 #include "Core/PatchEngine.h"
 #include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/SamplingProfiler.h"
 #include "Core/State.h"
 
 #ifdef USE_GDBSTUB
@@ -346,6 +348,7 @@ static void CPUSetInitialExecutionState()
 static void CpuThread()
 {
   DeclareAsCPUThread();
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::CPU);
 
   const SConfig& _CoreParameter = SConfig::GetInstance();
 
@@ -418,6 +421,7 @@ static void CpuThread()
 static void FifoPlayerThread()
 {
   DeclareAsCPUThread();
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::CPU);
   const SConfig& _CoreParameter = SConfig::GetInstance();
 
   if (_CoreParameter.bCPUThread)
@@ -589,6 +593,9 @@ void EmuThread()
   else
     cpuThreadFunc = CpuThread;
 
+  if (core_parameter.bSamplingProfiler)
+    SamplingProfiler::Start(core_parameter.iSamplingProfilerRate);
+
   // ENTER THE VIDEO THREAD LOOP
   if (core_parameter.bCPUThread)
   {
@@ -641,6 +648,14 @@ void EmuThread()
 
   INFO_LOG(CONSOLE, "%s", StopMessage(true, "CPU thread stopped.").c_str());
 
+  if (SamplingProfiler::IsRunning())
+  {
+    SamplingProfiler::Stop();
+    File::CreateFullPath(File::GetUserPath(D_LOGS_IDX));
+    SamplingProfiler::WriteReport(File::GetUserPath(D_LOGS_IDX) + core_parameter.m_strGameID +
+                                  "-samples.txt");
+  }
+
   if (core_parameter.bCPUThread)
     g_video_backend->Video_Cleanup();
 
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <mutex>
 #include <string>
@@ -11,8 +12,8 @@
 
 #include "Common/Assert.h"
 #include "Common/ChunkFile.h"
-#include "Common/FifoQueue.h"
 #include "Common/Logging/Log.h"
+#include "Common/MPSCQueue.h"
 #include "Common/StringUtil.h"
 #include "Common/Thread.h"
 
@@ -20,6 +21,7 @@
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/SamplingProfiler.h"
 
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/VideoBackendBase.h"
@@ -30,6 +32,10 @@ struct EventType
 {
   TimedCallback callback;
   const std::string* name;
+  // Bumped by RemoveEvent(), which makes every queued event of this type from before stale.
+  u64 generation;
+  // The number of queued events of this type which aren't stale.
+  u32 pending;
 };
 
 struct Event
@@ -38,6 +44,7 @@ struct Event
   u64 fifo_order;
   u64 userdata;
   EventType* type;
+  u64 generation;
 };
 
 // Sort by time, unless the times are the same, in which case sort by the order added to the queue
@@ -51,18 +58,27 @@ static bool operator<(const Event& left, const Event& right)
 }
 
 // unordered_map stores each element separately as a linked list node so pointers to elements
-// remain stable regardless of rehashes/resizing.
+// remain stable regardless of rehashes/resizing. Types are never erased, only unregistered.
 static std::unordered_map<std::string, EventType> s_event_types;
 
 // STATE_TO_SAVE
 // The queue is a min-heap using std::make_heap/push_heap/pop_heap.
-// We don't use std::priority_queue because we need to be able to serialize, unserialize and
-// erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't accomodated
-// by the standard adaptor class.
+// We don't use std::priority_queue because we need to be able to serialize and unserialize
+// events regardless of the queue order, which isn't accomodated by the standard adaptor class.
+//
+// Hardware like the VI, SI and DSP removes and reschedules its events all the time. Instead of
+// erasing them from the heap, RemoveEvent() only marks them as stale in O(1), and stale events are
+// dropped when they reach the top of the heap. Should they pile up, they're erased all at once.
 static std::vector<Event> s_event_queue;
+static u32 s_stale_events;
 static u64 s_event_fifo_id;
-static std::mutex s_ts_write_lock;
-static Common::FifoQueue<Event, false> s_ts_queue;
+// Events scheduled from other threads, moved into s_event_queue by the CPU thread.
+static Common::MPSCQueue<Event, 1024> s_ts_queue;
+// Events which didn't fit into s_ts_queue. While there are any, every thread adds to it instead,
+// so that the events of each thread stay in order.
+static std::mutex s_ts_overflow_lock;
+static std::vector<Event> s_ts_overflow;
+static std::atomic<bool> s_ts_overflowed{false};
 
 static float s_last_OC_factor;
 float g_last_OC_factor_inverted;
@@ -107,21 +123,72 @@ EventType* RegisterEvent(const std::string& name, TimedCallback callback)
 {
   // check for existing type with same name.
   // we want event type names to remain unique so that we can use them for serialization.
-  _assert_msg_(POWERPC, s_event_types.find(name) == s_event_types.end(),
+  auto itr = s_event_types.find(name);
+  _assert_msg_(POWERPC, itr == s_event_types.end() || !itr->second.callback,
                "CoreTiming Event \"%s\" is already registered. Events should only be registered "
                "during Init to avoid breaking save states.",
                name.c_str());
 
-  auto info = s_event_types.emplace(name, EventType{callback, nullptr});
-  EventType* event_type = &info.first->second;
-  event_type->name = &info.first->first;
-  return event_type;
+  if (itr == s_event_types.end())
+  {
+    itr = s_event_types.emplace(name, EventType{nullptr, nullptr, 0, 0}).first;
+    itr->second.name = &itr->first;
+  }
+  itr->second.callback = callback;
+  return &itr->second;
+}
+
+static bool IsStale(const Event& ev)
+{
+  return ev.generation != ev.type->generation;
+}
+
+static void PushEvent(Event ev)
+{
+  ev.generation = ev.type->generation;
+  ev.type->pending++;
+  s_event_queue.emplace_back(std::move(ev));
+  std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+}
+
+// Returns the earliest event which isn't stale, or nullptr if there are none.
+static const Event* GetNextEvent()
+{
+  while (!s_event_queue.empty() && IsStale(s_event_queue.front()))
+  {
+    std::pop_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    s_event_queue.pop_back();
+    s_stale_events--;
+  }
+  return s_event_queue.empty() ? nullptr : &s_event_queue.front();
+}
+
+static void EraseStaleEvents()
+{
+  if (!s_stale_events)
+    return;
+
+  s_event_queue.erase(std::remove_if(s_event_queue.begin(), s_event_queue.end(), IsStale),
+                      s_event_queue.end());
+  std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+  s_stale_events = 0;
+}
+
+static void ResetPendingCounts()
+{
+  for (auto& event_type : s_event_types)
+    event_type.second.pending = 0;
+  s_stale_events = 0;
 }
 
 void UnregisterAllEvents()
 {
   _assert_msg_(POWERPC, s_event_queue.empty(), "Cannot unregister events with events pending");
-  s_event_types.clear();
+
+  // The types are kept, as some hardware removes its events before registering them again,
+  // e.g. the decrementer in PowerPC::Init().
+  for (auto& event_type : s_event_types)
+    event_type.second.callback = nullptr;
 }
 
 void Init()
@@ -145,7 +212,6 @@ void Init()
 
 void Shutdown()
 {
-  std::lock_guard<std::mutex> lk(s_ts_write_lock);
   MoveEvents();
   ClearPendingEvents();
   UnregisterAllEvents();
@@ -153,7 +219,6 @@ void Shutdown()
 
 void DoState(PointerWrap& p)
 {
-  std::lock_guard<std::mutex> lk(s_ts_write_lock);
   p.Do(g_slice_length);
   p.Do(g_global_timer);
   p.Do(s_idled_cycles);
@@ -168,6 +233,7 @@ void DoState(PointerWrap& p)
   p.DoMarker("CoreTimingData");
 
   MoveEvents();
+  EraseStaleEvents();
   p.DoEachElement(s_event_queue, [](PointerWrap& pw, Event& ev) {
     pw.Do(ev.time);
     pw.Do(ev.fifo_order);
@@ -186,7 +252,7 @@ void DoState(PointerWrap& p)
     if (pw.GetMode() == PointerWrap::MODE_READ)
     {
       auto itr = s_event_types.find(name);
-      if (itr != s_event_types.end())
+      if (itr != s_event_types.end() && itr->second.callback)
       {
         ev.type = &itr->second;
       }
@@ -205,7 +271,15 @@ void DoState(PointerWrap& p)
   // The exact layout of the heap in memory is implementation defined, therefore it is platform
   // and library version specific.
   if (p.GetMode() == PointerWrap::MODE_READ)
+  {
+    ResetPendingCounts();
+    for (Event& ev : s_event_queue)
+    {
+      ev.generation = ev.type->generation;
+      ev.type->pending++;
+    }
     std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+  }
 }
 
 // This should only be called from the CPU thread. If you are calling
@@ -229,6 +303,7 @@ u64 GetIdleTicks()
 void ClearPendingEvents()
 {
   s_event_queue.clear();
+  ResetPendingCounts();
 }
 
 void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata, FromThread from)
@@ -255,8 +330,7 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
     if (!s_is_global_timer_sane)
       ForceExceptionCheck(cycles_into_future);
 
-    s_event_queue.emplace_back(Event{timeout, s_event_fifo_id++, userdata, event_type});
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    PushEvent(Event{timeout, s_event_fifo_id++, userdata, event_type, 0});
   }
   else
   {
@@ -267,22 +341,29 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
                 event_type->name->c_str());
     }
 
-    std::lock_guard<std::mutex> lk(s_ts_write_lock);
-    s_ts_queue.Push(Event{g_global_timer + cycles_into_future, 0, userdata, event_type});
+    const Event event{g_global_timer + cycles_into_future, 0, userdata, event_type, 0};
+    if (s_ts_overflowed.load(std::memory_order_acquire) || !s_ts_queue.TryPush(event))
+    {
+      std::lock_guard<std::mutex> lk(s_ts_overflow_lock);
+      s_ts_overflow.push_back(event);
+      s_ts_overflowed.store(true, std::memory_order_release);
+    }
   }
 }
 
 void RemoveEvent(EventType* event_type)
 {
-  auto itr = std::remove_if(s_event_queue.begin(), s_event_queue.end(),
-                            [&](const Event& e) { return e.type == event_type; });
+  // The event type is still nullptr if its hardware hasn't been initialized yet.
+  if (!event_type || !event_type->pending)
+    return;
 
-  // Removing random items breaks the invariant so we have to re-establish it.
-  if (itr != s_event_queue.end())
-  {
-    s_event_queue.erase(itr, s_event_queue.end());
-    std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-  }
+  event_type->generation++;
+  s_stale_events += event_type->pending;
+  event_type->pending = 0;
+
+  // Erasing costs as much as the stale events took to remove, so this stays O(1) amortized.
+  if (s_stale_events > 32 && s_stale_events > s_event_queue.size() / 2)
+    EraseStaleEvents();
 }
 
 void RemoveAllEvents(EventType* event_type)
@@ -303,18 +384,33 @@ void ForceExceptionCheck(s64 cycles)
   }
 }
 
+static void AddThreadSafeEvent(Event ev)
+{
+  ev.fifo_order = s_event_fifo_id++;
+  PushEvent(std::move(ev));
+}
+
 void MoveEvents()
 {
   for (Event ev; s_ts_queue.Pop(ev);)
-  {
-    ev.fifo_order = s_event_fifo_id++;
-    s_event_queue.emplace_back(std::move(ev));
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-  }
+    AddThreadSafeEvent(std::move(ev));
+
+  // The overflowed events came after everything in the queue, including events whose writer
+  // hasn't finished yet.
+  if (!s_ts_overflowed.load(std::memory_order_acquire) || !s_ts_queue.Empty())
+    return;
+
+  std::lock_guard<std::mutex> lk(s_ts_overflow_lock);
+  for (Event& ev : s_ts_overflow)
+    AddThreadSafeEvent(std::move(ev));
+  s_ts_overflow.clear();
+  s_ts_overflowed.store(false, std::memory_order_release);
 }
 
 void Advance()
 {
+  SamplingProfiler::ScopedSubsystem profiler_scope(SamplingProfiler::Subsystem::CoreTiming);
+
   MoveEvents();
 
   int cyclesExecuted = g_slice_length - DowncountToCycles(PowerPC::ppcState.downcount);
@@ -325,11 +421,13 @@ void Advance()
 
   s_is_global_timer_sane = true;
 
-  while (!s_event_queue.empty() && s_event_queue.front().time <= g_global_timer)
+  for (const Event* next = GetNextEvent(); next && next->time <= g_global_timer;
+       next = GetNextEvent())
   {
     Event evt = std::move(s_event_queue.front());
     std::pop_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
     s_event_queue.pop_back();
+    evt.type->pending--;
     // NOTICE_LOG(POWERPC, "[Scheduler] %-20s (%lld, %lld)", evt.type->name->c_str(),
     //            g_global_timer, evt.time);
     evt.type->callback(evt.userdata, g_global_timer - evt.time);
@@ -338,10 +436,10 @@ void Advance()
   s_is_global_timer_sane = false;
 
   // Still events left (scheduled in the future)
-  if (!s_event_queue.empty())
+  if (const Event* next = GetNextEvent())
   {
-    g_slice_length = static_cast<int>(
-        std::min<s64>(s_event_queue.front().time - g_global_timer, MAX_SLICE_LENGTH));
+    g_slice_length =
+        static_cast<int>(std::min<s64>(next->time - g_global_timer, MAX_SLICE_LENGTH));
   }
 
   PowerPC::ppcState.downcount = CyclesToDowncount(g_slice_length);
@@ -359,6 +457,8 @@ void LogPendingEvents()
   std::sort(clone.begin(), clone.end());
   for (const Event& ev : clone)
   {
+    if (IsStale(ev))
+      continue;
     INFO_LOG(POWERPC, "PENDING: Now: %" PRId64 " Pending: %" PRId64 " Type: %s", g_global_timer,
              ev.time, ev.type->name->c_str());
   }
@@ -387,6 +487,8 @@ std::string GetScheduledEventsSummary()
   std::sort(clone.begin(), clone.end());
   for (const Event& ev : clone)
   {
+    if (IsStale(ev))
+      continue;
     text += StringFromFormat("%s : %" PRIi64 " %016" PRIx64 "\n", ev.type->name->c_str(), ev.time,
                              ev.userdata);
   }
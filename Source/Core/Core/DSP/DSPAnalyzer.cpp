@@ -13,6 +13,7 @@ namespace DSPAnalyzer
 {
 // Holds data about all instructions in RAM.
 std::array<u8, ISPACE> code_flags;
+std::array<u16, ISPACE> loop_starts;
 
 // Good candidates for idle skipping is mail wait loops. If we're time slicing
 // between the main CPU and the DSP, if the DSP runs into one of these, it might
@@ -63,6 +64,7 @@ const u16 idle_skip_sigs[NUM_IDLE_SIGS][MAX_IDLE_SIG_SIZE + 1] = {
 static void Reset()
 {
   code_flags.fill(0);
+  loop_starts.fill(0);
 }
 
 static void AnalyzeRange(u16 start_addr, u16 end_addr)
@@ -90,12 +92,14 @@ static void AnalyzeRange(u16 start_addr, u16 end_addr)
       u16 loop_end = dsp_imem_read(addr + 1);
       code_flags[addr] |= CODE_LOOP_START;
       code_flags[loop_end] |= CODE_LOOP_END;
+      loop_starts[loop_end] = static_cast<u16>(addr + 2u);
     }
     else if ((inst & 0xffe0) == 0x0040 || (inst & 0xff00) == 0x1000)
     {
       // LOOP, LOOPI
       code_flags[addr] |= CODE_LOOP_START;
       code_flags[static_cast<u16>(addr + 1u)] |= CODE_LOOP_END;
+      loop_starts[static_cast<u16>(addr + 1u)] = static_cast<u16>(addr + 1u);
     }
 
     // Mark the last arithmetic/multiplier instruction before a branch.
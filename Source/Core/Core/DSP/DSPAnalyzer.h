@@ -30,6 +30,10 @@ enum
 // This one will be helpful for debuggers and jits.
 extern std::array<u8, ISPACE> code_flags;
 
+// Where the loop ending at an address flagged CODE_LOOP_END starts over, so that the jit can jump
+// straight back to it. Only valid at those addresses.
+extern std::array<u16, ISPACE> loop_starts;
+
 // This one should be called every time IRAM changes - which is basically
 // every time that a new ucode gets uploaded, and never else. At that point,
 // we can do as much static analysis as we want - but we should always throw
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <memory>
+#include <vector>
 
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
@@ -21,6 +22,7 @@
 #include "Core/DSP/DSPHost.h"
 #include "Core/DSP/DSPIntUtil.h"
 #include "Core/DSP/DSPInterpreter.h"
+#include "Core/DSP/DSPUCodeCache.h"
 
 SDSP g_dsp;
 DSPBreakpoints g_dsp_breakpoints;
@@ -30,6 +32,9 @@ bool g_init_hax = false;
 std::unique_ptr<DSPEmitter> g_dsp_jit;
 std::unique_ptr<DSPCaptureLogger> g_dsp_cap;
 static Common::Event step_event;
+static DSPUCodeCache s_ucode_cache;
+// The ucode in IRAM, if the cache is open.
+static DSPUCodeCache::Key s_ucode_key;
 
 // Returns false if the hash fails and the user hits "Yes"
 static bool VerifyRoms()
@@ -127,6 +132,7 @@ bool DSPCore_Init(const DSPInitOptions& opts)
 
   // Fill IRAM with HALT opcodes.
   std::fill(g_dsp.iram, g_dsp.iram + DSP_IRAM_SIZE, 0x0021);
+  DSPInterpreter::ClearDecodedInstructions();
 
   // Just zero out DRAM.
   std::fill(g_dsp.dram, g_dsp.dram + DSP_DRAM_SIZE, 0);
@@ -146,7 +152,14 @@ bool DSPCore_Init(const DSPInitOptions& opts)
 
   // Initialize JIT, if necessary
   if (opts.core_type == DSPInitOptions::CORE_JIT)
+  {
     g_dsp_jit = std::make_unique<DSPEmitter>();
+    if (!opts.ucode_cache_filename.empty())
+    {
+      s_ucode_cache.Open(opts.ucode_cache_filename);
+      s_ucode_key = DSPUCodeCache::GetKey();
+    }
+  }
 
   g_dsp_cap.reset(opts.capture_logger);
 
@@ -154,6 +167,16 @@ bool DSPCore_Init(const DSPInitOptions& opts)
   return true;
 }
 
+// Remembers the blocks compiled for the ucode in IRAM. Only ucodes which ran are worth that, and
+// blocks in IROM are kept when the ucode is replaced, so they don't tell whether it did.
+static void StoreCompiledBlocks()
+{
+  const std::vector<u16> blocks = g_dsp_jit->GetCompiledBlocks();
+  const auto in_iram = [](u16 address) { return address < DSP_IRAM_SIZE; };
+  if (std::any_of(blocks.begin(), blocks.end(), in_iram))
+    s_ucode_cache.Store(s_ucode_key, blocks);
+}
+
 void DSPCore_Shutdown()
 {
   if (core_state == DSPCORE_STOP)
@@ -161,6 +184,12 @@ void DSPCore_Shutdown()
 
   core_state = DSPCORE_STOP;
 
+  if (s_ucode_cache.IsOpen())
+  {
+    StoreCompiledBlocks();
+    s_ucode_cache.Close();
+  }
+
   g_dsp_jit.reset();
 
   DSPCore_FreeMemoryPages();
@@ -177,6 +206,29 @@ void DSPCore_Reset()
   DSPAnalyzer::Analyze();
 }
 
+void DSPCore_IRAMChanged()
+{
+  DSPInterpreter::ClearDecodedInstructions();
+
+  if (g_dsp_jit)
+  {
+    if (s_ucode_cache.IsOpen())
+      StoreCompiledBlocks();
+    g_dsp_jit->ClearIRAM();
+  }
+
+  if (!s_ucode_cache.IsOpen())
+  {
+    DSPAnalyzer::Analyze();
+    return;
+  }
+
+  s_ucode_key = DSPUCodeCache::GetKey();
+  if (!s_ucode_cache.LoadAnalysis(s_ucode_key))
+    DSPAnalyzer::Analyze();
+  g_dsp_jit->SetBlocksToPrecompile(s_ucode_cache.GetBlocks(s_ucode_key));
+}
+
 void DSPCore_SetException(u8 level)
 {
   g_dsp.exceptions |= 1 << level;
@@ -241,6 +293,10 @@ int DSPCore_RunCycles(int cycles)
 {
   if (g_dsp_jit)
   {
+    // IRAM may have changed while the DSP wasn't running.
+    if (g_dsp.reset_dspjit_codespace)
+      g_dsp_jit->ClearIRAMandDSPJITCodespaceReset();
+
     if (g_dsp.external_interrupt_waiting)
     {
       DSPCore_CheckExternalInterrupt();
@@ -312,23 +368,6 @@ void DSPCore_Step()
 void CompileCurrent()
 {
   g_dsp_jit->Compile(g_dsp.pc);
-
-  bool retry = true;
-
-  while (retry)
-  {
-    retry = false;
-    for (u16 i = 0x0000; i < 0xffff; ++i)
-    {
-      if (!g_dsp_jit->unresolvedJumps[i].empty())
-      {
-        u16 addrToCompile = g_dsp_jit->unresolvedJumps[i].front();
-        g_dsp_jit->Compile(addrToCompile);
-        if (!g_dsp_jit->unresolvedJumps[i].empty())
-          retry = true;
-      }
-    }
-  }
 }
 
 u16 DSPCore_ReadRegister(size_t reg)
@@ -325,6 +325,11 @@ struct DSPInitOptions
   // Default: dummy implementation, does nothing.
   DSPCaptureLogger* capture_logger;
 
+  // Optional file keeping the analysis of ucodes and the blocks the JIT compiled for them between
+  // runs, see DSPUCodeCache. Only used by the JIT.
+  // Default: empty, no cache.
+  std::string ucode_cache_filename;
+
   DSPInitOptions() : core_type(CORE_JIT), capture_logger(new DefaultDSPCaptureLogger()) {}
 };
 
@@ -335,6 +340,9 @@ bool DSPCore_Init(const DSPInitOptions& opts);
 void DSPCore_Reset();
 void DSPCore_Shutdown();  // Frees all allocated memory.
 
+// Throws away what was compiled or decoded for the old contents of IRAM and analyzes the new ones.
+void DSPCore_IRAMChanged();
+
 void DSPCore_CheckExternalInterrupt();
 void DSPCore_CheckExceptions();
 void DSPCore_SetExternalInterrupt(bool val);
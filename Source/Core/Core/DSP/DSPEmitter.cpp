@@ -3,6 +3,8 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #include "Core/DSP/DSPAnalyzer.h"
 #include "Core/DSP/DSPCore.h"
@@ -16,6 +18,12 @@
 
 using namespace Gen;
 
+static void PatchBlockLinkJump(u8* jump, const u8* target)
+{
+  XEmitter emitter(jump);
+  emitter.JMP(target, true);
+}
+
 DSPEmitter::DSPEmitter() : gpr(*this), storeIndex(-1), storeIndex2(-1)
 {
   m_compiledCode = nullptr;
@@ -57,7 +65,11 @@ void DSPEmitter::ClearIRAM()
     blocks[i] = (DSPCompiledCode)stubEntryPoint;
     blockLinks[i] = nullptr;
     blockSize[i] = 0;
-    unresolvedJumps[i].clear();
+
+    // Blocks outside of IRAM may still be run before the code space is cleared.
+    for (u8* jump : m_block_link_jumps[i])
+      PatchBlockLinkJump(jump, jump + 5);
+    m_block_link_jumps[i].clear();
   }
   g_dsp.reset_dspjit_codespace = true;
 }
@@ -73,9 +85,32 @@ void DSPEmitter::ClearIRAMandDSPJITCodespaceReset()
     blocks[i] = (DSPCompiledCode)stubEntryPoint;
     blockLinks[i] = nullptr;
     blockSize[i] = 0;
-    unresolvedJumps[i].clear();
+    m_block_link_jumps[i].clear();
   }
   g_dsp.reset_dspjit_codespace = false;
+
+  for (u16 address : m_blocks_to_precompile)
+  {
+    if (blocks[address] == (DSPCompiledCode)stubEntryPoint)
+      Compile(address);
+  }
+  m_blocks_to_precompile.clear();
+}
+
+std::vector<u16> DSPEmitter::GetCompiledBlocks() const
+{
+  std::vector<u16> addresses;
+  for (int i = 0x0000; i < MAX_BLOCKS; i++)
+  {
+    if (blocks[i] != (DSPCompiledCode)stubEntryPoint)
+      addresses.push_back(static_cast<u16>(i));
+  }
+  return addresses;
+}
+
+void DSPEmitter::SetBlocksToPrecompile(std::vector<u16> addresses)
+{
+  m_blocks_to_precompile = std::move(addresses);
 }
 
 // Must go out of block if exception is detected
@@ -202,7 +237,6 @@ void DSPEmitter::Compile(u16 start_addr)
 {
   // Remember the current block address for later
   startAddr = start_addr;
-  unresolvedJumps[start_addr].clear();
 
   const u8* entryPoint = AlignCode16();
 
@@ -218,6 +252,7 @@ void DSPEmitter::Compile(u16 start_addr)
   gpr.LoadRegs();
 
   blockLinkEntry = GetCodePtr();
+  gpr.EnterLinkedBlock();
 
   compilePC = start_addr;
   bool fixup_pc = false;
@@ -236,9 +271,6 @@ void DSPEmitter::Compile(u16 start_addr)
     blockSize[start_addr]++;
     compilePC += opcode->size;
 
-    // If the block was trying to link into itself, remove the link
-    unresolvedJumps[start_addr].remove(compilePC);
-
     fixup_pc = true;
 
     // Handle loop condition, only if current instruction was flagged as a loop destination
@@ -263,6 +295,20 @@ void DSPEmitter::Compile(u16 start_addr)
       // end of each block and in this order
       DSPJitRegCache c(gpr);
       HandleLoop();
+      // Go on with the next iteration, or with what follows the loop, without the dispatcher.
+      if (!(DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP))
+      {
+        const u16 loop_start = DSPAnalyzer::loop_starts[static_cast<u16>(compilePC - 1u)];
+        gpr.FlushRegsForLink();
+        CMP(16, M(&g_dsp.pc), Imm16(loop_start));
+        FixupBranch loop_ended = J_CC(CC_NE, true);
+        WriteBlockLink(loop_start, blockSize[start_addr]);
+        SetJumpTarget(loop_ended);
+        CMP(16, M(&g_dsp.pc), Imm16(compilePC));
+        FixupBranch loop_left = J_CC(CC_NE, true);
+        WriteBlockLink(compilePC, blockSize[start_addr]);
+        SetJumpTarget(loop_left);
+      }
       gpr.SaveRegs();
       if (!DSPHost::OnThread() && DSPAnalyzer::code_flags[start_addr] & DSPAnalyzer::CODE_IDLE_SKIP)
       {
@@ -325,33 +371,15 @@ void DSPEmitter::Compile(u16 start_addr)
   if (fixup_pc)
   {
     MOV(16, M(&(g_dsp.pc)), Imm16(compilePC));
+    WriteBlockLink(compilePC, blockSize[start_addr]);
   }
 
   blocks[start_addr] = (DSPCompiledCode)entryPoint;
+  blockLinks[start_addr] = blockLinkEntry;
 
-  // Mark this block as a linkable destination if it does not contain
-  // any unresolved CALL's
-  if (unresolvedJumps[start_addr].empty())
-  {
-    blockLinks[start_addr] = blockLinkEntry;
-
-    for (u16 i = 0x0000; i < 0xffff; ++i)
-    {
-      if (!unresolvedJumps[i].empty())
-      {
-        // Check if there were any blocks waiting for this block to be linkable
-        size_t size = unresolvedJumps[i].size();
-        unresolvedJumps[i].remove(start_addr);
-        if (unresolvedJumps[i].size() < size)
-        {
-          // Mark the block to be recompiled again
-          blocks[i] = (DSPCompiledCode)stubEntryPoint;
-          blockLinks[i] = nullptr;
-          blockSize[i] = 0;
-        }
-      }
-    }
-  }
+  // Link the blocks which have been waiting for this one, including itself.
+  for (u8* jump : m_block_link_jumps[start_addr])
+    PatchBlockLinkJump(jump, blockLinkEntry);
 
   if (blockSize[start_addr] == 0)
   {
@@ -373,6 +401,47 @@ void DSPEmitter::Compile(u16 start_addr)
   JMP(returnDispatcher, true);
 }
 
+void DSPEmitter::WriteBlockLink(u16 dest, u16 cycles)
+{
+  // Idle skipping blocks give up the rest of the cycles, which only the dispatcher can do.
+  if (DSPAnalyzer::code_flags[startAddr] & DSPAnalyzer::CODE_IDLE_SKIP)
+    return;
+
+  gpr.FlushRegsForLink();
+
+  // Do the same checks as the dispatcher, so that the cycle count comes out the same.
+  CMP(16, M(&g_cycles_left), Imm16(cycles));
+  FixupBranch not_enough_cycles = J_CC(CC_BE, true);
+  TEST(8, M(&g_dsp.cr), Imm8(CR_HALT));
+  FixupBranch halted = J_CC(CC_NZ, true);
+  FixupBranch interrupt;
+  if (DSPHost::OnThread())
+  {
+    CMP(8, M(const_cast<bool*>(&g_dsp.external_interrupt_waiting)), Imm8(0));
+    interrupt = J_CC(CC_NE, true);
+  }
+  SUB(16, M(&g_cycles_left), Imm16(cycles));
+
+  // Until the block is compiled, this jumps to the code right after it, which has the dispatcher
+  // compile and run it.
+  u8* jump = GetWritableCodePtr();
+  JMP(blockLinks[dest] ? blockLinks[dest] : jump + 5, true);
+  m_block_link_jumps[dest].push_back(jump);
+
+  DSPJitRegCache c(gpr);
+  MOV(16, M(&g_dsp.pc), Imm16(dest));
+  gpr.SaveRegs();
+  XOR(32, R(EAX), R(EAX));  // The cycles are already taken
+  JMP(returnDispatcher, true);
+  gpr.LoadRegs(false);
+  gpr.FlushRegs(c, false);
+
+  SetJumpTarget(not_enough_cycles);
+  SetJumpTarget(halted);
+  if (DSPHost::OnThread())
+    SetJumpTarget(interrupt);
+}
+
 const u8* DSPEmitter::CompileStub()
 {
   const u8* entryPoint = AlignCode16();
@@ -402,6 +471,12 @@ void DSPEmitter::CompileDispatcher()
   TEST(8, M(&g_dsp.cr), Imm8(CR_HALT));
   FixupBranch _halt = J_CC(CC_NE);
 
+  if (m_count_dispatcher_entries)
+  {
+    MOV(64, R(RBX), ImmPtr(&m_dispatcher_entries));
+    ADD(64, MatR(RBX), Imm8(1));
+  }
+
   // Execute block. Cycles executed returned in EAX.
   MOVZX(64, 16, ECX, M(&g_dsp.pc));
   MOV(64, R(RBX), ImmPtr(blocks));
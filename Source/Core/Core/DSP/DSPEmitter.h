@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <list>
+#include <vector>
 
 #include "Common/x64ABI.h"
 #include "Common/x64Emitter.h"
@@ -30,12 +30,28 @@ public:
   void ClearIRAM();
   void ClearIRAMandDSPJITCodespaceReset();
 
+  // The start addresses of the blocks which are compiled now.
+  std::vector<u16> GetCompiledBlocks() const;
+  // Compiles these blocks when the code space is reset next, so they're ready when they first run.
+  void SetBlocksToPrecompile(std::vector<u16> addresses);
+
   void CompileDispatcher();
   Block CompileStub();
   void Compile(u16 start_addr);
 
   bool FlagsNeeded();
 
+  // Jumps straight to the block at dest, compiling it first if needed, if the dispatcher would run
+  // it next after this block took the given number of cycles. Otherwise, falls through to the
+  // block exit that is written next.
+  void WriteBlockLink(u16 dest, u16 cycles);
+
+  // Has the dispatcher count how many times it runs a block, as opposed to blocks jumping to each
+  // other, for profiling. Takes effect once the dispatcher is compiled again at the next code space
+  // reset.
+  void SetCountDispatcherEntries(bool count) { m_count_dispatcher_entries = count; }
+  u64 GetDispatcherEntries() const { return m_dispatcher_entries; }
+
   void FallBackToInterpreter(UDSPInstruction inst);
 
   // CC Util
@@ -247,7 +263,6 @@ public:
   u16 startAddr;
   Block* blockLinks;
   u16* blockSize;
-  std::list<u16> unresolvedJumps[MAX_BLOCKS];
 
   DSPJitRegCache gpr;
 
@@ -255,6 +270,12 @@ private:
   DSPCompiledCode* blocks;
   Block blockLinkEntry;
   u16 compileSR;
+  bool m_count_dispatcher_entries = false;
+  u64 m_dispatcher_entries = 0;
+  // The jumps written by WriteBlockLink, by the block they go to, so that they can be pointed at it
+  // once it's compiled and away from it again when it's gone.
+  std::vector<u8*> m_block_link_jumps[MAX_BLOCKS];
+  std::vector<u16> m_blocks_to_precompile;
 
   // The index of the last stored ext value (compile time).
   int storeIndex;
@@ -4,15 +4,81 @@
 // Refer to the license.txt file included.
 
 #include "Core/DSP/DSPInterpreter.h"
+
+#include <array>
+
 #include "Core/DSP/DSPAnalyzer.h"
 #include "Core/DSP/DSPCore.h"
 #include "Core/DSP/DSPHWInterface.h"
+#include "Core/DSP/DSPIntExtOps.h"
 #include "Core/DSP/DSPIntUtil.h"
 #include "Core/DSP/DSPMemoryMap.h"
 #include "Core/DSP/DSPTables.h"
 
 namespace DSPInterpreter
 {
+// Instructions in IRAM and IROM are decoded the first time they run, into the functions which
+// carry out their main and extended parts. Other addresses aren't backed by memory and are
+// decoded every time they run.
+struct DecodedInstruction
+{
+  // DecodeAndExecute until the instruction has been decoded.
+  dspIntFunc main_func;
+  // Null if there is no extended part.
+  dspIntFunc ext_func;
+  UDSPInstruction opc;
+};
+
+static std::array<DecodedInstruction, DSP_IRAM_SIZE + DSP_IROM_SIZE> s_decoded;
+
+static DecodedInstruction& GetDecodedInstruction(u16 address)
+{
+  // IROM comes right after IRAM.
+  return s_decoded[((address >> 3) & DSP_IRAM_SIZE) | (address & DSP_IRAM_MASK)];
+}
+
+static __forceinline void ExecuteDecoded(const DecodedInstruction& inst)
+{
+  // The instruction may replace the code, and with it inst.
+  const dspIntFunc main_func = inst.main_func;
+  const dspIntFunc ext_func = inst.ext_func;
+  const UDSPInstruction opc = inst.opc;
+
+  if (!ext_func)
+  {
+    main_func(opc);
+    return;
+  }
+
+  ext_func(opc);
+  main_func(opc);
+  applyWriteBackLog();
+}
+
+static void DecodeAndExecute(const UDSPInstruction)
+{
+  DecodedInstruction& inst = GetDecodedInstruction(g_dsp.pc - 1);
+  inst.opc = dsp_imem_read(g_dsp.pc - 1);
+
+  const DSPOPCTemplate* tinst = GetOpTemplate(inst.opc);
+  inst.main_func = tinst->intFunc;
+  inst.ext_func = nullptr;
+  if (tinst->extended)
+  {
+    const u16 ext_opc = (inst.opc >> 12) == 0x3 ? inst.opc & 0x7F : inst.opc & 0xFF;
+    // Without an extension there is nothing to write back either.
+    if (extOpTable[ext_opc]->intFunc != Ext::nop)
+      inst.ext_func = extOpTable[ext_opc]->intFunc;
+  }
+
+  ExecuteDecoded(inst);
+}
+
+void ClearDecodedInstructions()
+{
+  s_decoded.fill({DecodeAndExecute, nullptr, 0});
+}
+
 // NOTE: These have nothing to do with g_dsp.r.cr !
 
 void WriteCR(u16 val)
@@ -52,9 +118,11 @@ u16 ReadCR()
   return g_dsp.cr;
 }
 
-void Step()
+// Step, inlined into the loops below.
+static __forceinline void StepInline()
 {
-  DSPCore_CheckExceptions();
+  if (g_dsp.exceptions)
+    DSPCore_CheckExceptions();
 
   g_dsp.step_counter++;
 
@@ -73,13 +141,28 @@ void Step()
   }
 #endif
 
-  u16 opc = dsp_fetch_code();
-  ExecuteInstruction(UDSPInstruction(opc));
+  const u16 pc = g_dsp.pc;
+  switch (pc >> 12)
+  {
+  case 0:  // IRAM
+  case 8:  // IROM
+    g_dsp.pc++;
+    ExecuteDecoded(GetDecodedInstruction(pc));
+    break;
+  default:
+    ExecuteInstruction(UDSPInstruction(dsp_fetch_code()));
+    break;
+  }
 
   if (DSPAnalyzer::code_flags[static_cast<u16>(g_dsp.pc - 1u)] & DSPAnalyzer::CODE_LOOP_END)
     HandleLoop();
 }
 
+void Step()
+{
+  StepInline();
+}
+
 // Used by thread mode.
 int RunCyclesThread(int cycles)
 {
@@ -94,7 +177,7 @@ int RunCyclesThread(int cycles)
       DSPCore_SetExternalInterrupt(false);
     }
 
-    Step();
+    StepInline();
     cycles--;
     if (cycles < 0)
       return 0;
@@ -114,7 +197,7 @@ int RunCyclesDebug(int cycles)
       DSPCore_SetState(DSPCORE_STEPPING);
       return cycles;
     }
-    Step();
+    StepInline();
     cycles--;
     if (cycles < 0)
       return 0;
@@ -136,7 +219,7 @@ int RunCyclesDebug(int cycles)
       // Idle skipping.
       if (DSPAnalyzer::code_flags[g_dsp.pc] & DSPAnalyzer::CODE_IDLE_SKIP)
         return 0;
-      Step();
+      StepInline();
       cycles--;
       if (cycles < 0)
         return 0;
@@ -150,7 +233,7 @@ int RunCyclesDebug(int cycles)
         DSPCore_SetState(DSPCORE_STEPPING);
         return cycles;
       }
-      Step();
+      StepInline();
       cycles--;
       if (cycles < 0)
         return 0;
@@ -169,7 +252,7 @@ int RunCycles(int cycles)
   {
     if (g_dsp.cr & CR_HALT)
       return 0;
-    Step();
+    StepInline();
     cycles--;
     if (cycles < 0)
       return 0;
@@ -186,7 +269,7 @@ int RunCycles(int cycles)
       // Idle skipping.
       if (DSPAnalyzer::code_flags[g_dsp.pc] & DSPAnalyzer::CODE_IDLE_SKIP)
         return 0;
-      Step();
+      StepInline();
       cycles--;
       if (cycles < 0)
         return 0;
@@ -195,7 +278,7 @@ int RunCycles(int cycles)
     // Now, lets run some more without idle skipping.
     for (int i = 0; i < 200; i++)
     {
-      Step();
+      StepInline();
       cycles--;
       if (cycles < 0)
         return 0;
@@ -12,6 +12,10 @@ namespace DSPInterpreter
 {
 void Step();
 
+// Step keeps what it decoded from IRAM and IROM. This throws it away, and must be called whenever
+// either of them changes.
+void ClearDecodedInstructions();
+
 // See: DspIntBranch.cpp
 void HandleLoop();
 
@@ -0,0 +1,162 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/DSP/DSPUCodeCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Common/Logging/Log.h"
+#include "Core/DSP/DSPAnalyzer.h"
+#include "Core/DSP/DSPCore.h"
+
+namespace
+{
+// An entry is an EntryHeader, followed by an AnalyzedAddress for every address with any analyzer
+// flags set, and then the start addresses of the compiled blocks.
+struct EntryHeader
+{
+  u32 num_addresses;
+  u32 num_blocks;
+};
+
+struct AnalyzedAddress
+{
+  u16 address;
+  u16 loop_start;
+  u16 flags;
+};
+
+size_t EntrySize(const EntryHeader& header)
+{
+  return sizeof(EntryHeader) + header.num_addresses * sizeof(AnalyzedAddress) +
+         header.num_blocks * sizeof(u16);
+}
+}  // namespace
+
+class DSPUCodeCache::Reader final : public LinearDiskCacheReader<Key, u8>
+{
+public:
+  explicit Reader(DSPUCodeCache* cache) : m_cache(cache) {}
+  void Read(const Key& key, const u8* value, u32 value_size) override
+  {
+    EntryHeader header;
+    if (value_size < sizeof(header))
+      return;
+    std::memcpy(&header, value, sizeof(header));
+    if (value_size != EntrySize(header))
+      return;
+
+    // Later entries replace earlier ones for the same key.
+    m_cache->m_entries[key].assign(value, value + value_size);
+  }
+
+private:
+  DSPUCodeCache* m_cache;
+};
+
+DSPUCodeCache::Key DSPUCodeCache::GetKey()
+{
+  return {GetMurmurHash3(reinterpret_cast<const u8*>(g_dsp.iram), DSP_IRAM_BYTE_SIZE, 0),
+          GetMurmurHash3(reinterpret_cast<const u8*>(g_dsp.irom), DSP_IROM_BYTE_SIZE, 0)};
+}
+
+void DSPUCodeCache::Open(const std::string& filename)
+{
+  Close();
+  Reader reader(this);
+  m_file.OpenAndRead(filename, reader);
+  m_open = true;
+  INFO_LOG(DSPLLE, "Loaded %zu ucodes from %s", m_entries.size(), filename.c_str());
+}
+
+void DSPUCodeCache::Close()
+{
+  if (m_open)
+    m_file.Close();
+  m_open = false;
+  m_entries.clear();
+}
+
+bool DSPUCodeCache::LoadAnalysis(const Key& key) const
+{
+  auto it = m_entries.find(key);
+  if (it == m_entries.end())
+    return false;
+
+  EntryHeader header;
+  std::memcpy(&header, it->second.data(), sizeof(header));
+  const u8* addresses = it->second.data() + sizeof(header);
+
+  DSPAnalyzer::code_flags.fill(0);
+  DSPAnalyzer::loop_starts.fill(0);
+  for (u32 i = 0; i < header.num_addresses; ++i)
+  {
+    AnalyzedAddress analyzed;
+    std::memcpy(&analyzed, addresses + i * sizeof(analyzed), sizeof(analyzed));
+    DSPAnalyzer::code_flags[analyzed.address] = static_cast<u8>(analyzed.flags);
+    DSPAnalyzer::loop_starts[analyzed.address] = analyzed.loop_start;
+  }
+  return true;
+}
+
+std::vector<u16> DSPUCodeCache::GetBlocks(const Key& key) const
+{
+  auto it = m_entries.find(key);
+  if (it == m_entries.end())
+    return {};
+
+  EntryHeader header;
+  std::memcpy(&header, it->second.data(), sizeof(header));
+  std::vector<u16> blocks(header.num_blocks);
+  std::memcpy(blocks.data(), it->second.data() + EntrySize(header) - blocks.size() * sizeof(u16),
+              blocks.size() * sizeof(u16));
+  return blocks;
+}
+
+void DSPUCodeCache::Store(const Key& key, const std::vector<u16>& blocks)
+{
+  // Keep the blocks from earlier runs too, which may have gone further.
+  const std::vector<u16> old_blocks = GetBlocks(key);
+  std::vector<u16> new_blocks(blocks);
+  std::sort(new_blocks.begin(), new_blocks.end());
+  std::vector<u16> merged_blocks;
+  std::set_union(old_blocks.begin(), old_blocks.end(), new_blocks.begin(), new_blocks.end(),
+                 std::back_inserter(merged_blocks));
+
+  std::vector<AnalyzedAddress> addresses;
+  for (size_t address = 0; address < DSPAnalyzer::code_flags.size(); ++address)
+  {
+    if (DSPAnalyzer::code_flags[address] == 0)
+      continue;
+    AnalyzedAddress analyzed = {};
+    analyzed.address = static_cast<u16>(address);
+    analyzed.loop_start = DSPAnalyzer::loop_starts[address];
+    analyzed.flags = DSPAnalyzer::code_flags[address];
+    addresses.push_back(analyzed);
+  }
+
+  EntryHeader header;
+  header.num_addresses = static_cast<u32>(addresses.size());
+  header.num_blocks = static_cast<u32>(merged_blocks.size());
+  std::vector<u8> entry(EntrySize(header));
+  std::memcpy(entry.data(), &header, sizeof(header));
+  u8* ptr = entry.data() + sizeof(header);
+  std::memcpy(ptr, addresses.data(), addresses.size() * sizeof(AnalyzedAddress));
+  ptr += addresses.size() * sizeof(AnalyzedAddress);
+  std::memcpy(ptr, merged_blocks.data(), merged_blocks.size() * sizeof(u16));
+
+  // Only write it out if there is something new, so the file doesn't grow with every upload.
+  std::vector<u8>& stored = m_entries[key];
+  if (stored == entry)
+    return;
+  stored = std::move(entry);
+  m_file.Append(key, stored.data(), static_cast<u32>(stored.size()));
+}
@@ -0,0 +1,58 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/LinearDiskCache.h"
+
+// Keeps what has been worked out about a ucode on disk: the results of DSPAnalyzer::Analyze, and
+// the addresses of the blocks the JIT compiled for it. When the same ucode is uploaded again, even
+// in another run, the analysis is taken from here and the blocks can be compiled right away
+// instead of the first time they run.
+//
+// Ucodes are told apart by hashing all of IRAM and IROM, since the analysis covers both.
+class DSPUCodeCache
+{
+public:
+  struct Key
+  {
+    u64 iram_hash;
+    u64 irom_hash;
+
+    bool operator<(const Key& other) const
+    {
+      return std::tie(iram_hash, irom_hash) < std::tie(other.iram_hash, other.irom_hash);
+    }
+  };
+
+  // The key for the code which is in instruction memory now.
+  static Key GetKey();
+
+  // Reads the entries stored in filename. New entries are appended to it.
+  void Open(const std::string& filename);
+  void Close();
+  bool IsOpen() const { return m_open; }
+
+  // Sets the results of DSPAnalyzer from the entry for key and returns true if there is one.
+  bool LoadAnalysis(const Key& key) const;
+  // The blocks compiled for the ucode last time, if any.
+  std::vector<u16> GetBlocks(const Key& key) const;
+  // Remembers the current results of DSPAnalyzer, which must be those for key, and the blocks
+  // compiled for the ucode.
+  void Store(const Key& key, const std::vector<u16>& blocks);
+
+private:
+  class Reader;
+
+  bool m_open = false;
+  // Serialized entries; see DSPUCodeCache.cpp for the layout.
+  std::map<Key, std::vector<u8>> m_entries;
+  LinearDiskCache<Key, u8> m_file;
+};
@@ -364,6 +364,21 @@ void DSPJitRegCache::FlushRegs()
   use_ctr = 0;
 }
 
+void DSPJitRegCache::FlushRegsForLink()
+{
+  FlushMemBackedRegs();
+  use_ctr = 0;
+}
+
+void DSPJitRegCache::EnterLinkedBlock()
+{
+  for (DynamicReg& reg : regs)
+  {
+    if (reg.host_reg != INVALID_REG)
+      reg.dirty = true;
+  }
+}
+
 static u64 ebp_store;
 
 void DSPJitRegCache::LoadRegs(bool emit)
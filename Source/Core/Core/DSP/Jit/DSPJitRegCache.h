@@ -100,6 +100,13 @@ public:
   // Prepare state so that another flushed DSPJitRegCache can take over
   void FlushRegs();
 
+  // Prepare state for jumping straight into another block. The statically allocated regs are
+  // left in their host regs without being written back, so the block has to start with
+  // EnterLinkedBlock.
+  void FlushRegsForLink();
+  // Where other blocks can jump to, the statically allocated regs may differ from memory.
+  void EnterLinkedBlock();
+
   void LoadRegs(bool emit = true);  // Load statically allocated regs from memory
   void SaveRegs();                  // Save statically allocated regs to memory
 
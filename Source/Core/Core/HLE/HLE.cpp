@@ -11,6 +11,7 @@
 #include "Core/Core.h"
 #include "Core/Debugger/Debugger_SymbolMap.h"
 #include "Core/HLE/HLE.h"
+#include "Core/HLE/HLE_Memory.h"
 #include "Core/HLE/HLE_Misc.h"
 #include "Core/HLE/HLE_OS.h"
 #include "Core/HW/Memmap.h"
@@ -65,6 +66,18 @@ static const SPatch OSPatches[] = {
     {"__write_console", HLE_OS::HLE_write_console, HLE_HOOK_REPLACE,
      HLE_TYPE_DEBUG},  // used by sysmenu (+more?)
 
+    // C library and cache maintenance
+    {"memcpy", HLE_Memory::HLE_memcpy, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"memmove", HLE_Memory::HLE_memmove, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"memset", HLE_Memory::HLE_memset, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"__copy_longs_aligned", HLE_Memory::HLE_copy_longs, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"__copy_longs_rev_aligned", HLE_Memory::HLE_copy_longs, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"__copy_longs_unaligned", HLE_Memory::HLE_copy_longs, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"__copy_longs_rev_unaligned", HLE_Memory::HLE_copy_longs, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"__fill_mem", HLE_Memory::HLE_fill_mem, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"DCFlushRange", HLE_Memory::HLE_DCFlushRange, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+    {"DCInvalidateRange", HLE_Memory::HLE_DCInvalidateRange, HLE_HOOK_REPLACE, HLE_TYPE_MEMORY},
+
     {"GeckoCodehandler", HLE_Misc::GeckoCodeHandlerICacheFlush, HLE_HOOK_START, HLE_TYPE_FIXED},
     {"GeckoHandlerReturnTrampoline", HLE_Misc::GeckoReturnTrampoline, HLE_HOOK_REPLACE,
      HLE_TYPE_FIXED},
@@ -112,11 +125,9 @@ void PatchFunctions()
     Symbol* symbol = g_symbolDB.GetSymbolFromName(OSPatches[i].m_szPatchName);
     if (symbol)
     {
-      for (u32 addr = symbol->address; addr < symbol->address + symbol->size; addr += 4)
-      {
-        s_original_instructions[addr] = i;
-        PowerPC::ppcState.iCache.Invalidate(addr);
-      }
+      // Only the entry, so that code which the hook leaves to run doesn't call it again.
+      s_original_instructions[symbol->address] = i;
+      PowerPC::ppcState.iCache.Invalidate(symbol->address);
       INFO_LOG(OSHLE, "Patching %s %08x", OSPatches[i].m_szPatchName, symbol->address);
     }
   }
@@ -140,6 +151,7 @@ void PatchFunctions()
 void Clear()
 {
   s_original_instructions.clear();
+  HLE_Memory::ClearStats();
 }
 
 void Execute(u32 _CurrentPC, u32 _Instruction)
@@ -147,15 +159,15 @@ void Execute(u32 _CurrentPC, u32 _Instruction)
   unsigned int FunctionIndex = _Instruction & 0xFFFFF;
   if (FunctionIndex > 0 && FunctionIndex < ArraySize(OSPatches))
   {
+    // A replacing function which doesn't set NPC has the original code run instead.
+    if (OSPatches[FunctionIndex].type == HLE_HOOK_REPLACE)
+      NPC = _CurrentPC;
     OSPatches[FunctionIndex].PatchFunction();
   }
   else
   {
     PanicAlert("HLE system tried to call an undefined HLE function %i.", FunctionIndex);
   }
-
-  // _dbg_assert_msg_(HLE,NPC == LR, "Broken HLE function (doesn't set NPC)",
-  // OSPatches[pos].m_szPatchName);
 }
 
 u32 GetFunctionIndex(u32 addr)
@@ -180,6 +192,9 @@ bool IsEnabled(int flags)
       PowerPC::GetMode() != MODE_INTERPRETER)
     return false;
 
+  if (flags == HLE::HLE_TYPE_MEMORY && !SConfig::GetInstance().bHLEMemoryFunctions)
+    return false;
+
   return true;
 }
 
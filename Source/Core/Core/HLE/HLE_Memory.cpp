@@ -0,0 +1,235 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/HLE/HLE_Memory.h"
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/BreakPoints.h"
+#include "Common/CommonTypes.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+
+namespace HLE_Memory
+{
+namespace
+{
+enum Function
+{
+  FUNC_MEMCPY,
+  FUNC_MEMMOVE,
+  FUNC_MEMSET,
+  FUNC_COPY_LONGS,
+  FUNC_FILL_MEM,
+  FUNC_DC_FLUSH_RANGE,
+  FUNC_DC_INVALIDATE_RANGE,
+  NUM_FUNCTIONS
+};
+
+const std::array<const char*, NUM_FUNCTIONS> s_function_names{{
+    "memcpy", "memmove", "memset", "__copy_longs", "__fill_mem", "DCFlushRange",
+    "DCInvalidateRange",
+}};
+
+struct FunctionStats
+{
+  u64 calls;
+  u64 bytes;
+};
+
+std::array<FunctionStats, NUM_FUNCTIONS> s_stats;
+u64 s_declined_calls;
+
+// Roughly what the library versions cost: the call and the size checks, then an unrolled loop
+// moving a cache line per iteration and a byte loop for the rest.
+constexpr u32 CALL_CYCLES = 12;
+constexpr u32 LINE_COPY_CYCLES = 18;
+constexpr u32 BYTE_COPY_CYCLES = 3;
+constexpr u32 LINE_FILL_CYCLES = 10;
+constexpr u32 BYTE_FILL_CYCLES = 2;
+// dcbf or dcbi, addi and bdnz.
+constexpr u32 LINE_CACHE_CYCLES = 3;
+
+constexpr u32 CACHE_LINE_SIZE = 32;
+
+// Returns a host pointer to the size bytes at address if they are all in MEM1 or MEM2 through
+// the current BATs, and the CPU would not see a memory check there.
+u8* GetRAMPointer(u32 address, u32 size)
+{
+  if (!UReg_MSR(MSR).DR)
+    return nullptr;
+
+  if (PowerPC::memchecks.HasAny() && PowerPC::memchecks.OverlapsMemoryRange(address, size))
+    return nullptr;
+
+  const u32 last = address + size - 1;
+  if (last < address)
+    return nullptr;
+
+  u32 physical = address;
+  if (!PowerPC::TranslateBatAddess(PowerPC::dbat_table, &physical))
+    return nullptr;
+
+  // Neighbouring BATs don't have to map neighbouring memory.
+  for (u32 chunk = (address >> PowerPC::BAT_INDEX_SHIFT) + 1;
+       chunk <= (last >> PowerPC::BAT_INDEX_SHIFT); chunk++)
+  {
+    const u32 chunk_address = chunk << PowerPC::BAT_INDEX_SHIFT;
+    u32 chunk_physical = chunk_address;
+    if (!PowerPC::TranslateBatAddess(PowerPC::dbat_table, &chunk_physical) ||
+        chunk_physical - physical != chunk_address - address)
+    {
+      return nullptr;
+    }
+  }
+
+  const u32 physical_last = physical + size - 1;
+  if (physical_last < physical)
+    return nullptr;
+
+  if (physical_last < Memory::REALRAM_SIZE)
+    return Memory::m_pRAM + physical;
+
+  if (Memory::m_pEXRAM && (physical >> 28) == 0x1 && (physical_last >> 28) == 0x1 &&
+      (physical_last & 0x0FFFFFFF) < Memory::EXRAM_SIZE)
+  {
+    return Memory::m_pEXRAM + (physical & Memory::EXRAM_MASK);
+  }
+
+  return nullptr;
+}
+
+void Charge(Function function, u32 size, u32 cycles)
+{
+  s_stats[function].calls++;
+  s_stats[function].bytes += size;
+  PowerPC::ppcState.downcount -= static_cast<int>(CALL_CYCLES + cycles);
+}
+
+// Copies like memmove, which is also what memcpy does for the overlapping copies some games make.
+// Returns false if either range is anywhere but in RAM, so that the library code makes the
+// accesses and takes any exceptions.
+bool Copy(Function function, u32 dst, u32 src, u32 size)
+{
+  u8* host_dst = GetRAMPointer(dst, size);
+  const u8* host_src = GetRAMPointer(src, size);
+  if (size && (!host_dst || !host_src))
+  {
+    s_declined_calls++;
+    return false;
+  }
+
+  Charge(function, size, (size / CACHE_LINE_SIZE) * LINE_COPY_CYCLES +
+                             (size % CACHE_LINE_SIZE) * BYTE_COPY_CYCLES);
+  if (size)
+    std::memmove(host_dst, host_src, size);
+  return true;
+}
+
+bool Fill(Function function, u32 dst, u8 value, u32 size)
+{
+  u8* host_dst = GetRAMPointer(dst, size);
+  if (size && !host_dst)
+  {
+    s_declined_calls++;
+    return false;
+  }
+
+  Charge(function, size, (size / CACHE_LINE_SIZE) * LINE_FILL_CYCLES +
+                             (size % CACHE_LINE_SIZE) * BYTE_FILL_CYCLES);
+  if (size)
+    std::memset(host_dst, value, size);
+  return true;
+}
+
+void InvalidateRange(Function function, u32 address, u32 size)
+{
+  // The library functions round the range out to whole cache lines.
+  u32 lines = 0;
+  if (size)
+    lines = ((address % CACHE_LINE_SIZE) + size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE;
+  Charge(function, size, lines * LINE_CACHE_CYCLES);
+
+  // Same heuristic as dcbf and dcbi in the interpreter, for the whole range at once.
+  if (lines)
+    JitInterface::InvalidateICache(address & ~(CACHE_LINE_SIZE - 1), lines * CACHE_LINE_SIZE,
+                                   false);
+}
+}  // namespace
+
+// void* memcpy(void* dst, const void* src, size_t n)
+void HLE_memcpy()
+{
+  if (Copy(FUNC_MEMCPY, GPR(3), GPR(4), GPR(5)))
+    NPC = LR;
+}
+
+// void* memmove(void* dst, const void* src, size_t n)
+void HLE_memmove()
+{
+  if (Copy(FUNC_MEMMOVE, GPR(3), GPR(4), GPR(5)))
+    NPC = LR;
+}
+
+// void* memset(void* dst, int value, size_t n)
+void HLE_memset()
+{
+  if (Fill(FUNC_MEMSET, GPR(3), static_cast<u8>(GPR(4)), GPR(5)))
+    NPC = LR;
+}
+
+// void __copy_longs_[rev_][un]aligned(void* dst, const void* src, size_t n)
+// The variants only differ in the direction and alignment they were picked for.
+void HLE_copy_longs()
+{
+  if (Copy(FUNC_COPY_LONGS, GPR(3), GPR(4), GPR(5)))
+    NPC = LR;
+}
+
+// void __fill_mem(void* dst, int value, size_t n)
+void HLE_fill_mem()
+{
+  if (Fill(FUNC_FILL_MEM, GPR(3), static_cast<u8>(GPR(4)), GPR(5)))
+    NPC = LR;
+}
+
+// void DCFlushRange(void* address, u32 size)
+void HLE_DCFlushRange()
+{
+  InvalidateRange(FUNC_DC_FLUSH_RANGE, GPR(3), GPR(4));
+  NPC = LR;
+}
+
+// void DCInvalidateRange(void* address, u32 size)
+void HLE_DCInvalidateRange()
+{
+  InvalidateRange(FUNC_DC_INVALIDATE_RANGE, GPR(3), GPR(4));
+  NPC = LR;
+}
+
+void GetCounters(std::vector<std::pair<std::string, u64>>* counters)
+{
+  for (size_t i = 0; i < s_stats.size(); i++)
+  {
+    if (!s_stats[i].calls)
+      continue;
+    const std::string name = std::string("HLE ") + s_function_names[i];
+    counters->emplace_back(name + " calls", s_stats[i].calls);
+    counters->emplace_back(name + " bytes", s_stats[i].bytes);
+  }
+  if (s_declined_calls)
+    counters->emplace_back("HLE memory functions outside of RAM", s_declined_calls);
+}
+
+void ClearStats()
+{
+  s_stats = {};
+  s_declined_calls = 0;
+}
+}
@@ -0,0 +1,28 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+namespace HLE_Memory
+{
+// The copies and fills leave NPC alone, which runs the original code, unless their ranges are all
+// in RAM.
+void HLE_memcpy();
+void HLE_memmove();
+void HLE_memset();
+void HLE_copy_longs();
+void HLE_fill_mem();
+void HLE_DCFlushRange();
+void HLE_DCInvalidateRange();
+
+// Calls and bytes moved per function since the last ClearStats().
+void GetCounters(std::vector<std::pair<std::string, u64>>* counters);
+void ClearStats();
+}
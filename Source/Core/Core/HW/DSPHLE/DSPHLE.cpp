@@ -11,6 +11,7 @@
 #include "Core/HW/DSPHLE/DSPHLE.h"
 #include "Core/HW/DSPHLE/UCodes/UCodes.h"
 #include "Core/HW/SystemTimers.h"
+#include "Core/SamplingProfiler.h"
 
 DSPHLE::DSPHLE()
 {
@@ -45,6 +46,7 @@ void DSPHLE::Shutdown()
 
 void DSPHLE::DSP_Update(int cycles)
 {
+  SamplingProfiler::ScopedSubsystem profiler_scope(SamplingProfiler::Subsystem::DSP);
   if (m_pUCode != nullptr)
     m_pUCode->Update();
 }
@@ -3,12 +3,18 @@
 // Refer to the license.txt file included.
 
 #include "Core/HW/DSPHLE/UCodes/AX.h"
+
+#include <algorithm>
+#include <iterator>
+
 #include "Common/ChunkFile.h"
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/FileUtil.h"
 #include "Common/Logging/Log.h"
 #include "Common/MathUtil.h"
+#include "Common/WorkerPool.h"
+#include "Core/ConfigManager.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DSPHLE/UCodes/AXStructs.h"
 
@@ -22,6 +28,13 @@ AXUCode::AXUCode(DSPHLE* dsphle, u32 crc) : UCodeInterface(dsphle, crc), m_cmdli
   DSP::GenerateDSPInterruptFromDSPEmu(DSP::INT_DSP);
 
   LoadResamplingCoefficients();
+
+  const int voice_threads = SConfig::GetInstance().iDSPHLEVoiceThreads;
+  if (voice_threads > 1)
+  {
+    INFO_LOG(DSPHLE, "Processing AX voices on %d threads", voice_threads);
+    m_voice_workers = std::make_unique<Common::WorkerPool>(voice_threads, "AX voice worker");
+  }
 }
 
 AXUCode::~AXUCode()
@@ -405,16 +418,11 @@ void AXUCode::ProcessPBList(u32 pb_addr)
   // 32KHz to 48KHz, but AX always process at 32KHz.
   const u32 spms = 32;
 
-  AXPB pb;
-
-  while (pb_addr)
-  {
-    AXBuffers buffers = {{m_samples_left, m_samples_right, m_samples_surround, m_samples_auxA_left,
-                          m_samples_auxA_right, m_samples_auxA_surround, m_samples_auxB_left,
-                          m_samples_auxB_right, m_samples_auxB_surround}};
-
-    ReadPB(pb_addr, pb);
+  const AXBuffers buffers = {{m_samples_left, m_samples_right, m_samples_surround,
+                              m_samples_auxA_left, m_samples_auxA_right, m_samples_auxA_surround,
+                              m_samples_auxB_left, m_samples_auxB_right, m_samples_auxB_surround}};
 
+  const auto process_pb = [this](AXPB& pb, AXBuffers mix_buffers) {
     u32 updates_addr = HILO_TO_32(pb.updates.data);
     u16* updates = (u16*)HLEMemory_Get_Pointer(updates_addr);
 
@@ -422,17 +430,52 @@ void AXUCode::ProcessPBList(u32 pb_addr)
     {
       ApplyUpdatesForMs(curr_ms, (u16*)&pb, pb.updates.num_updates, updates);
 
-      ProcessVoice(pb, buffers, spms, ConvertMixerControl(pb.mixer_control),
+      ProcessVoice(pb, mix_buffers, spms, ConvertMixerControl(pb.mixer_control),
                    m_coeffs_available ? m_coeffs : nullptr);
 
       // Forward the buffers
-      for (size_t i = 0; i < ArraySize(buffers.ptrs); ++i)
-        buffers.ptrs[i] += spms;
+      for (size_t i = 0; i < ArraySize(mix_buffers.ptrs); ++i)
+        mix_buffers.ptrs[i] += spms;
+    }
+  };
+
+  if (!m_voice_workers)
+  {
+    AXPB pb;
+    while (pb_addr)
+    {
+      ReadPB(pb_addr, pb);
+      process_pb(pb, buffers);
+      WritePB(pb_addr, pb);
+      pb_addr = HILO_TO_32(pb.next_pb);
     }
+    return;
+  }
+
+  // Read the whole list first. Updates can change the link to the next PB, but they don't depend
+  // on the voice processing, so applying them to a copy gives the same link.
+  std::vector<u32> pb_addrs;
+  std::vector<AXPB> pbs;
+  while (pb_addr)
+  {
+    AXPB pb;
+    ReadPB(pb_addr, pb);
+    pb_addrs.push_back(pb_addr);
+    pbs.push_back(pb);
 
-    WritePB(pb_addr, pb);
+    u16* updates = (u16*)HLEMemory_Get_Pointer(HILO_TO_32(pb.updates.data));
+    for (int curr_ms = 0; curr_ms < 5; ++curr_ms)
+      ApplyUpdatesForMs(curr_ms, (u16*)&pb, pb.updates.num_updates, updates);
     pb_addr = HILO_TO_32(pb.next_pb);
   }
+
+  u32 buffer_sizes[ArraySize(buffers.ptrs)];
+  std::fill(std::begin(buffer_sizes), std::end(buffer_sizes), 5 * spms);
+  ProcessPBsInParallel(*m_voice_workers, pbs, buffers, buffer_sizes, m_voice_mix_buffers,
+                       process_pb);
+
+  for (size_t i = 0; i < pbs.size(); ++i)
+    WritePB(pb_addrs[i], pbs[i]);
 }
 
 void AXUCode::MixAUXSamples(int aux_id, u32 write_addr, u32 read_addr)
@@ -12,9 +12,17 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "Core/HW/DSPHLE/UCodes/UCodes.h"
 
+namespace Common
+{
+class WorkerPool;
+}
+
 // We can't directly use the mixer_control field from the PB because it does
 // not mean the same in all AX versions. The AX UCode converts the
 // mixer_control value to an AXMixControl bitfield.
@@ -92,6 +100,11 @@ protected:
   bool m_coeffs_available;
   s16 m_coeffs[0x800];
 
+  // Threads the voices of a PB list are spread over, if enabled, and the buffers the threads
+  // other than the DSP thread mix to.
+  std::unique_ptr<Common::WorkerPool> m_voice_workers;
+  std::vector<int> m_voice_mix_buffers;
+
   void LoadResamplingCoefficients();
 
   // Copy a command list from memory to our temp buffer
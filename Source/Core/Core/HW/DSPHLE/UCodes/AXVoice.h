@@ -12,10 +12,16 @@
 #error AXVoice.h included without specifying version
 #endif
 
-#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
+#include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
+#include "Common/Intrinsics.h"
+#include "Common/Logging/Log.h"
 #include "Common/MathUtil.h"
+#include "Common/WorkerPool.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DSPHLE/UCodes/AX.h"
 #include "Core/HW/DSPHLE/UCodes/AXStructs.h"
@@ -111,99 +117,143 @@ void DumpPB(const PB_TYPE& pb)
 }
 #endif
 
-// Simulated accelerator state.
-static u32 acc_loop_addr, acc_end_addr;
-static u32* acc_cur_addr;
-static PB_TYPE* acc_pb;
-static bool acc_end_reached;
+// Simulated accelerator state. Every voice gets its own, so that voices can be processed on
+// several threads.
+struct AcceleratorState
+{
+  u32 loop_addr;
+  u32 end_addr;
+  u32* cur_addr;
+  PB_TYPE* pb;
+  bool end_reached;
+};
 
 // Sets up the simulated accelerator.
-void AcceleratorSetup(PB_TYPE* pb, u32* cur_addr)
+void AcceleratorSetup(AcceleratorState& acc, PB_TYPE* pb, u32* cur_addr)
 {
-  acc_pb = pb;
-  acc_loop_addr = HILO_TO_32(pb->audio_addr.loop_addr);
-  acc_end_addr = HILO_TO_32(pb->audio_addr.end_addr);
-  acc_cur_addr = cur_addr;
-  acc_end_reached = false;
+  acc.pb = pb;
+  acc.loop_addr = HILO_TO_32(pb->audio_addr.loop_addr);
+  acc.end_addr = HILO_TO_32(pb->audio_addr.end_addr);
+  acc.cur_addr = cur_addr;
+  acc.end_reached = false;
+}
+
+// Handles looping and disabling streams that reached the end address (this is
+// done by an exception raised by the accelerator on real hardware).
+void AcceleratorEndReached(AcceleratorState& acc)
+{
+  // loop back to loop_addr.
+  *acc.cur_addr = acc.loop_addr;
+
+  if (acc.pb->audio_addr.looping)
+  {
+    // Set the ADPCM infos to continue processing at loop_addr.
+    //
+    // For some reason, yn1 and yn2 aren't set if the voice is not of
+    // stream type. This is what the AX UCode does and I don't really
+    // know why.
+    acc.pb->adpcm.pred_scale = acc.pb->adpcm_loop_info.pred_scale;
+    if (!acc.pb->is_stream)
+    {
+      acc.pb->adpcm.yn1 = acc.pb->adpcm_loop_info.yn1;
+      acc.pb->adpcm.yn2 = acc.pb->adpcm_loop_info.yn2;
+    }
+  }
+  else
+  {
+    // Non looping voice reached the end -> running = 0.
+    acc.pb->running = 0;
+
+#ifdef AX_WII
+    // One of the few meaningful differences between AXGC and AXWii:
+    // while AXGC handles non looping voices ending by having 0000
+    // samples at the loop address, AXWii has the 0000 samples
+    // internally in DRAM and use an internal pointer to it (loop addr
+    // does not contain 0000 samples on AXWii!).
+    acc.end_reached = true;
+#endif
+  }
+}
+
+// How far past the end address the current address of an ADPCM voice gets.
+u8 GetADPCMStepSize(const AcceleratorState& acc)
+{
+  switch (acc.end_addr & 15)
+  {
+  case 0:  // Tom and Jerry
+    return 1;
+  case 1:  // Blazing Angels
+    return 0;
+  default:
+    return 2;
+  }
 }
 
 // Reads a sample from the simulated accelerator. Also handles looping and
-// disabling streams that reached the end (this is done by an exception raised
-// by the accelerator on real hardware).
-u16 AcceleratorGetSample()
+// disabling streams that reached the end.
+u16 AcceleratorGetSample(AcceleratorState& acc)
 {
   u16 ret;
   u8 step_size_bytes = 0;
 
-  // See below for explanations about acc_end_reached.
-  if (acc_end_reached)
+  // See below for explanations about acc.end_reached.
+  if (acc.end_reached)
     return 0;
 
-  switch (acc_pb->audio_addr.sample_format)
+  switch (acc.pb->audio_addr.sample_format)
   {
   case 0x00:  // ADPCM
   {
     // ADPCM decoding, not much to explain here.
-    if ((*acc_cur_addr & 15) == 0)
+    if ((*acc.cur_addr & 15) == 0)
     {
-      acc_pb->adpcm.pred_scale = DSP::ReadARAM((*acc_cur_addr & ~15) >> 1);
-      *acc_cur_addr += 2;
+      acc.pb->adpcm.pred_scale = DSP::ReadARAM((*acc.cur_addr & ~15) >> 1);
+      *acc.cur_addr += 2;
     }
 
-    switch (acc_end_addr & 15)
-    {
-    case 0:  // Tom and Jerry
-      step_size_bytes = 1;
-      break;
-    case 1:  // Blazing Angels
-      step_size_bytes = 0;
-      break;
-    default:
-      step_size_bytes = 2;
-      break;
-    }
+    step_size_bytes = GetADPCMStepSize(acc);
 
-    int scale = 1 << (acc_pb->adpcm.pred_scale & 0xF);
-    int coef_idx = (acc_pb->adpcm.pred_scale >> 4) & 0x7;
+    int scale = 1 << (acc.pb->adpcm.pred_scale & 0xF);
+    int coef_idx = (acc.pb->adpcm.pred_scale >> 4) & 0x7;
 
-    s32 coef1 = acc_pb->adpcm.coefs[coef_idx * 2 + 0];
-    s32 coef2 = acc_pb->adpcm.coefs[coef_idx * 2 + 1];
+    s32 coef1 = acc.pb->adpcm.coefs[coef_idx * 2 + 0];
+    s32 coef2 = acc.pb->adpcm.coefs[coef_idx * 2 + 1];
 
-    int temp = (*acc_cur_addr & 1) ? (DSP::ReadARAM(*acc_cur_addr >> 1) & 0xF) :
-                                     (DSP::ReadARAM(*acc_cur_addr >> 1) >> 4);
+    int temp = (*acc.cur_addr & 1) ? (DSP::ReadARAM(*acc.cur_addr >> 1) & 0xF) :
+                                     (DSP::ReadARAM(*acc.cur_addr >> 1) >> 4);
 
     if (temp >= 8)
       temp -= 16;
 
     int val =
-        (scale * temp) + ((0x400 + coef1 * acc_pb->adpcm.yn1 + coef2 * acc_pb->adpcm.yn2) >> 11);
+        (scale * temp) + ((0x400 + coef1 * acc.pb->adpcm.yn1 + coef2 * acc.pb->adpcm.yn2) >> 11);
     val = MathUtil::Clamp(val, -0x7FFF, 0x7FFF);
 
-    acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-    acc_pb->adpcm.yn1 = val;
-    *acc_cur_addr += 1;
+    acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+    acc.pb->adpcm.yn1 = val;
+    *acc.cur_addr += 1;
     ret = val;
     break;
   }
 
   case 0x0A:  // 16-bit PCM audio
-    ret = (DSP::ReadARAM(*acc_cur_addr * 2) << 8) | DSP::ReadARAM(*acc_cur_addr * 2 + 1);
-    acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-    acc_pb->adpcm.yn1 = ret;
+    ret = (DSP::ReadARAM(*acc.cur_addr * 2) << 8) | DSP::ReadARAM(*acc.cur_addr * 2 + 1);
+    acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+    acc.pb->adpcm.yn1 = ret;
     step_size_bytes = 2;
-    *acc_cur_addr += 1;
+    *acc.cur_addr += 1;
     break;
 
   case 0x19:  // 8-bit PCM audio
-    ret = DSP::ReadARAM(*acc_cur_addr) << 8;
-    acc_pb->adpcm.yn2 = acc_pb->adpcm.yn1;
-    acc_pb->adpcm.yn1 = ret;
+    ret = DSP::ReadARAM(*acc.cur_addr) << 8;
+    acc.pb->adpcm.yn2 = acc.pb->adpcm.yn1;
+    acc.pb->adpcm.yn1 = ret;
     step_size_bytes = 2;
-    *acc_cur_addr += 1;
+    *acc.cur_addr += 1;
     break;
 
   default:
-    ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc_pb->audio_addr.sample_format);
+    ERROR_LOG(DSPHLE, "Unknown sample format: %d", acc.pb->audio_addr.sample_format);
     return 0;
   }
 
@@ -211,49 +261,204 @@ u16 AcceleratorGetSample()
   //
   // On real hardware, this would raise an interrupt that is handled by the
   // UCode. We simulate what this interrupt does here.
-  if (*acc_cur_addr == (acc_end_addr + step_size_bytes - 1))
+  if (*acc.cur_addr == (acc.end_addr + step_size_bytes - 1))
+    AcceleratorEndReached(acc);
+
+  return ret;
+}
+
+// Same as calling AcceleratorGetSample <count> times for an ADPCM voice, but with the decoder
+// state kept in locals until the end address is reached.
+void AcceleratorGetADPCMSamples(AcceleratorState& acc, s16* samples, u32 count)
+{
+  const u32 end_addr = acc.end_addr + GetADPCMStepSize(acc) - 1;
+  u32 cur_addr = *acc.cur_addr;
+  u16 pred_scale = acc.pb->adpcm.pred_scale;
+  s32 yn1 = acc.pb->adpcm.yn1;
+  s32 yn2 = acc.pb->adpcm.yn2;
+
+  u32 i = 0;
+  for (; i < count && !acc.end_reached; ++i)
   {
-    // loop back to loop_addr.
-    *acc_cur_addr = acc_loop_addr;
+    // ADPCM decoding, not much to explain here.
+    if ((cur_addr & 15) == 0)
+    {
+      pred_scale = DSP::ReadARAM((cur_addr & ~15) >> 1);
+      cur_addr += 2;
+    }
+
+    const int scale = 1 << (pred_scale & 0xF);
+    const int coef_idx = (pred_scale >> 4) & 0x7;
+    const s32 coef1 = acc.pb->adpcm.coefs[coef_idx * 2 + 0];
+    const s32 coef2 = acc.pb->adpcm.coefs[coef_idx * 2 + 1];
+
+    const u8 byte = DSP::ReadARAM(cur_addr >> 1);
+    int temp = (cur_addr & 1) ? (byte & 0xF) : (byte >> 4);
+    if (temp >= 8)
+      temp -= 16;
 
-    if (acc_pb->audio_addr.looping)
+    const int val = MathUtil::Clamp((scale * temp) + ((0x400 + coef1 * yn1 + coef2 * yn2) >> 11),
+                                    -0x7FFF, 0x7FFF);
+    yn2 = yn1;
+    yn1 = val;
+    samples[i] = val;
+    cur_addr += 1;
+
+    if (cur_addr == end_addr)
     {
-      // Set the ADPCM infos to continue processing at loop_addr.
-      //
-      // For some reason, yn1 and yn2 aren't set if the voice is not of
-      // stream type. This is what the AX UCode does and I don't really
-      // know why.
-      acc_pb->adpcm.pred_scale = acc_pb->adpcm_loop_info.pred_scale;
-      if (!acc_pb->is_stream)
-      {
-        acc_pb->adpcm.yn1 = acc_pb->adpcm_loop_info.yn1;
-        acc_pb->adpcm.yn2 = acc_pb->adpcm_loop_info.yn2;
-      }
+      acc.pb->adpcm.pred_scale = pred_scale;
+      acc.pb->adpcm.yn1 = yn1;
+      acc.pb->adpcm.yn2 = yn2;
+      AcceleratorEndReached(acc);
+      cur_addr = *acc.cur_addr;
+      pred_scale = acc.pb->adpcm.pred_scale;
+      yn1 = acc.pb->adpcm.yn1;
+      yn2 = acc.pb->adpcm.yn2;
     }
+  }
+
+  *acc.cur_addr = cur_addr;
+  acc.pb->adpcm.pred_scale = pred_scale;
+  acc.pb->adpcm.yn1 = yn1;
+  acc.pb->adpcm.yn2 = yn2;
+  std::fill(samples + i, samples + count, 0);
+}
+
+// Same as calling AcceleratorGetSample <count> times for a PCM voice.
+template <bool pcm16>
+void AcceleratorGetPCMSamples(AcceleratorState& acc, s16* samples, u32 count)
+{
+  const u32 end_addr = acc.end_addr + 1;
+  u32 cur_addr = *acc.cur_addr;
+  s16 yn1 = acc.pb->adpcm.yn1;
+  s16 yn2 = acc.pb->adpcm.yn2;
+
+  u32 i = 0;
+  for (; i < count && !acc.end_reached; ++i)
+  {
+    u16 ret;
+    if (pcm16)
+      ret = (DSP::ReadARAM(cur_addr * 2) << 8) | DSP::ReadARAM(cur_addr * 2 + 1);
     else
+      ret = DSP::ReadARAM(cur_addr) << 8;
+    yn2 = yn1;
+    yn1 = ret;
+    samples[i] = ret;
+    cur_addr += 1;
+
+    if (cur_addr == end_addr)
     {
-      // Non looping voice reached the end -> running = 0.
-      acc_pb->running = 0;
+      acc.pb->adpcm.yn1 = yn1;
+      acc.pb->adpcm.yn2 = yn2;
+      AcceleratorEndReached(acc);
+      cur_addr = *acc.cur_addr;
+      yn1 = acc.pb->adpcm.yn1;
+      yn2 = acc.pb->adpcm.yn2;
+    }
+  }
 
-#ifdef AX_WII
-      // One of the few meaningful differences between AXGC and AXWii:
-      // while AXGC handles non looping voices ending by having 0000
-      // samples at the loop address, AXWii has the 0000 samples
-      // internally in DRAM and use an internal pointer to it (loop addr
-      // does not contain 0000 samples on AXWii!).
-      acc_end_reached = true;
+  *acc.cur_addr = cur_addr;
+  acc.pb->adpcm.yn1 = yn1;
+  acc.pb->adpcm.yn2 = yn2;
+  std::fill(samples + i, samples + count, 0);
+}
+
+// Decodes <count> samples from the simulated accelerator.
+void AcceleratorGetSamples(AcceleratorState& acc, s16* samples, u32 count)
+{
+  switch (acc.pb->audio_addr.sample_format)
+  {
+  case 0x00:  // ADPCM
+    AcceleratorGetADPCMSamples(acc, samples, count);
+    break;
+  case 0x0A:  // 16-bit PCM audio
+    AcceleratorGetPCMSamples<true>(acc, samples, count);
+    break;
+  case 0x19:  // 8-bit PCM audio
+    AcceleratorGetPCMSamples<false>(acc, samples, count);
+    break;
+  default:
+    for (u32 i = 0; i < count; ++i)
+      samples[i] = AcceleratorGetSample(acc);
+    break;
+  }
+}
+
+// The most input samples a voice is decoded into a buffer for at once. Ratios up to 8.0 fit,
+// anything higher is resampled sample by sample.
+constexpr u32 MAX_INPUT_SAMPLES = MAX_SAMPLES_PER_FRAME * 8;
+
+// Returns how many input samples ResampleAudio reads to resample <count> samples.
+u32 GetInputSampleCount(u32 count, u32 curr_pos, u32 ratio, int srctype)
+{
+  if (srctype != SRCTYPE_LINEAR && srctype != SRCTYPE_POLYPHASE)
+    return count;
+
+  u32 input_count = 0;
+  for (u32 i = 0; i < count; ++i)
+  {
+    curr_pos += ratio;
+    input_count += curr_pos >> 16;
+    curr_pos &= 0xFFFF;
+  }
+  return input_count;
+}
+
+// Interpolates output[i] between s0[i] and s1[i] at frac[i] / 0x10000, or takes s0[i] when
+// frac[i] is 0.
+void InterpolateLinear(s16* output, const s16* s0, const s16* s1, const u16* frac, u32 count)
+{
+  u32 i = 0;
+#ifdef _M_X86
+  // s0 * (0x10000 - frac) + s1 * frac doesn't fit into 16 bit factors, but it's the same as
+  // s0 * w0 + s1 * w1 + ((s0 + s1) << 15) with w1 = frac - 0x8000 and w0 = -w1.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(-0x8000);
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s0 + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1 + i));
+    const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i));
+    const __m128i w1 = _mm_xor_si128(f, bias);
+    const __m128i w0 = _mm_sub_epi16(zero, w1);
+
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), _mm_unpacklo_epi16(w0, w1));
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), _mm_unpackhi_epi16(w0, w1));
+    const __m128i sum_lo = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16),
+                                         _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16));
+    const __m128i sum_hi = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16),
+                                         _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16));
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_slli_epi32(sum_lo, 15)), 16);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_slli_epi32(sum_hi, 15)), 16);
+
+    const __m128i result = _mm_packs_epi32(lo, hi);
+    const __m128i no_frac = _mm_cmpeq_epi16(f, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                     _mm_or_si128(_mm_and_si128(no_frac, a), _mm_andnot_si128(no_frac, result)));
+  }
 #endif
+
+  for (; i < count; ++i)
+  {
+    // If frac is 0, we can simply take the first sample without any multiplying.
+    if (frac[i])
+    {
+      const u16 inv_frac = -frac[i];
+      output[i] = ((s0[i] * inv_frac) + (s1[i] * frac[i])) >> 16;
+    }
+    else
+    {
+      output[i] = s0[i];
     }
   }
-
-  return ret;
 }
 
-// Reads samples from the input callback, resamples them to <count> samples at
-// the wanted sample rate (computed from the ratio, see below).
+// Resamples <count> samples at the wanted sample rate from <input>, which holds the samples
+// GetInputSampleCount asked for.
 //
-// If srctype is SRCTYPE_POLYPHASE, coefficients need to be provided as well
-// (or the srctype will automatically be changed to LINEAR).
+// If srctype is SRCTYPE_POLYPHASE, the samples are resampled linearly as well.
+// TODO(delroth): find out why the polyphase resampling algorithm causes
+// audio glitches in Wii games with non integral ratios.
 //
 // Returns the current position after resampling (including fractional part).
 //
@@ -269,53 +474,54 @@ u16 AcceleratorGetSample()
 // We start getting samples not from sample 0, but 0.<curr_pos_frac>. This
 // avoids discontinuities in the audio stream, especially with very low ratios
 // which interpolate a lot of values between two "real" samples.
-u32 ResampleAudio(std::function<s16(u32)> input_callback, s16* output, u32 count, s16* last_samples,
-                  u32 curr_pos, u32 ratio, int srctype, const s16* coeffs)
+u32 ResampleAudio(const s16* input, s16* output, u32 count, s16* last_samples, u32 curr_pos,
+                  u32 ratio, int srctype)
 {
-  int read_samples_count = 0;
-
-  // TODO(delroth): find out why the polyphase resampling algorithm causes
-  // audio glitches in Wii games with non integral ratios.
-
-  // If DSP DROM coefficients are available, support polyphase resampling.
-  if (0)  // if (coeffs && srctype == SRCTYPE_POLYPHASE)
+  if (srctype != SRCTYPE_LINEAR && srctype != SRCTYPE_POLYPHASE)
   {
-    s16 temp[4];
-    u32 idx = 0;
-
-    temp[idx++ & 3] = last_samples[0];
-    temp[idx++ & 3] = last_samples[1];
-    temp[idx++ & 3] = last_samples[2];
-    temp[idx++ & 3] = last_samples[3];
-
-    for (u32 i = 0; i < count; ++i)
-    {
-      curr_pos += ratio;
-      while (curr_pos >= 0x10000)
-      {
-        temp[idx++ & 3] = input_callback(read_samples_count++);
-        curr_pos -= 0x10000;
-      }
+    // SRCTYPE_NEAREST: no sample rate conversion here, simply copy the samples.
+    memcpy(output, input, count * sizeof(s16));
+    memcpy(last_samples, output + count - 4, 4 * sizeof(u16));
+    return curr_pos;
+  }
 
-      u16 curr_pos_frac = ((curr_pos & 0xFFFF) >> 9) << 2;
-      const s16* c = &coeffs[curr_pos_frac];
+  // The input samples after the last four of the previous call, which are still used for the
+  // interpolation. They are stored back to the PB at the end.
+  const u32 input_count = GetInputSampleCount(count, curr_pos, ratio, srctype);
+  s16 history[4 + MAX_INPUT_SAMPLES];
+  memcpy(history, last_samples, 4 * sizeof(s16));
+  memcpy(history + 4, input, input_count * sizeof(s16));
+
+  // Gather the two samples each output sample is interpolated from, and how much of each.
+  s16 s0[MAX_SAMPLES_PER_FRAME];
+  s16 s1[MAX_SAMPLES_PER_FRAME];
+  u16 frac[MAX_SAMPLES_PER_FRAME];
+  u32 pos = 0;
+  for (u32 i = 0; i < count; ++i)
+  {
+    curr_pos += ratio;
+    pos += curr_pos >> 16;
+    curr_pos &= 0xFFFF;
 
-      s64 t0 = temp[idx++ & 3];
-      s64 t1 = temp[idx++ & 3];
-      s64 t2 = temp[idx++ & 3];
-      s64 t3 = temp[idx++ & 3];
+    s0[i] = history[pos];
+    s1[i] = history[pos + 1];
+    frac[i] = curr_pos;
+  }
+  InterpolateLinear(output, s0, s1, frac, count);
 
-      s64 samp = (t0 * c[0] + t1 * c[1] + t2 * c[2] + t3 * c[3]) >> 15;
+  memcpy(last_samples, history + input_count, 4 * sizeof(s16));
+  return curr_pos;
+}
 
-      output[i] = (s16)samp;
-    }
+// Same as above, but reads the samples one by one from the input callback, for ratios which
+// need more input samples than MAX_INPUT_SAMPLES.
+template <typename InputCallback>
+u32 ResampleAudioStreamed(InputCallback input_callback, s16* output, u32 count, s16* last_samples,
+                          u32 curr_pos, u32 ratio, int srctype)
+{
+  int read_samples_count = 0;
 
-    last_samples[3] = temp[--idx & 3];
-    last_samples[2] = temp[--idx & 3];
-    last_samples[1] = temp[--idx & 3];
-    last_samples[0] = temp[--idx & 3];
-  }
-  else if (srctype == SRCTYPE_LINEAR || srctype == SRCTYPE_POLYPHASE)
+  if (srctype == SRCTYPE_LINEAR || srctype == SRCTYPE_POLYPHASE)
   {
     // This is the circular buffer containing samples to use for the
     // interpolation. It is initialized with the values from the PB, and it
@@ -386,16 +592,29 @@ u32 ResampleAudio(std::function<s16(u32)> input_callback, s16* output, u32 count
 
 // Read <count> input samples from ARAM, decoding and converting rate
 // if required.
-void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count, const s16* coeffs)
+void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count)
 {
   u32 cur_addr = HILO_TO_32(pb.audio_addr.cur_addr);
-  AcceleratorSetup(&pb, &cur_addr);
-
-  if (coeffs)
-    coeffs += pb.coef_select * 0x200;
-  u32 curr_pos =
-      ResampleAudio([](u32) { return AcceleratorGetSample(); }, samples, count, pb.src.last_samples,
-                    pb.src.cur_addr_frac, HILO_TO_32(pb.src.ratio), pb.src_type, coeffs);
+  AcceleratorState acc;
+  AcceleratorSetup(acc, &pb, &cur_addr);
+
+  // Decode all the samples first, then resample them.
+  const u32 ratio = HILO_TO_32(pb.src.ratio);
+  const u32 input_count = GetInputSampleCount(count, pb.src.cur_addr_frac, ratio, pb.src_type);
+  u32 curr_pos;
+  if (input_count <= MAX_INPUT_SAMPLES)
+  {
+    s16 input[MAX_INPUT_SAMPLES];
+    AcceleratorGetSamples(acc, input, input_count);
+    curr_pos = ResampleAudio(input, samples, count, pb.src.last_samples, pb.src.cur_addr_frac,
+                             ratio, pb.src_type);
+  }
+  else
+  {
+    curr_pos =
+        ResampleAudioStreamed([&acc](u32) { return AcceleratorGetSample(acc); }, samples, count,
+                              pb.src.last_samples, pb.src.cur_addr_frac, ratio, pb.src_type);
+  }
   pb.src.cur_addr_frac = (curr_pos & 0xFFFF);
 
   // Update current position in the PB.
@@ -403,6 +622,55 @@ void GetInputSamples(PB_TYPE& pb, s16* samples, u16 count, const s16* coeffs)
   pb.audio_addr.cur_addr_lo = (u16)(cur_addr & 0xFFFF);
 }
 
+#ifdef _M_X86
+// Multiplies 8 samples by their volumes and clamps them like ScaleSamples.
+__m128i ScaleSamples8(__m128i samples, __m128i volumes)
+{
+  const __m128i lo = _mm_mullo_epi16(samples, volumes);
+  // The volumes are unsigned, so the signed product is off by samples << 16 for volumes with the
+  // top bit set.
+  const __m128i hi = _mm_add_epi16(_mm_mulhi_epi16(samples, volumes),
+                                   _mm_and_si128(samples, _mm_srai_epi16(volumes, 15)));
+  const __m128i products_lo = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+  const __m128i products_hi = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+  return _mm_max_epi16(_mm_packs_epi32(products_lo, products_hi), _mm_set1_epi16(-32767));
+}
+
+// The volumes of the next 8 samples.
+__m128i GetVolumes8(u16 volume, u16 volume_delta)
+{
+  alignas(16) u16 volumes[8];
+  for (int i = 0; i < 8; ++i)
+    volumes[i] = volume + i * volume_delta;
+  return _mm_load_si128(reinterpret_cast<const __m128i*>(volumes));
+}
+#endif
+
+// Multiplies the samples by a volume which is ramped by volume_delta every sample, and returns
+// the volume after the last one.
+u16 ScaleSamples(s16* output, const s16* input, u32 count, u16 volume, u16 volume_delta)
+{
+  u32 i = 0;
+#ifdef _M_X86
+  __m128i volumes = GetVolumes8(volume, volume_delta);
+  const __m128i volumes_delta = _mm_set1_epi16(volume_delta * 8);
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), ScaleSamples8(samples, volumes));
+    volumes = _mm_add_epi16(volumes, volumes_delta);
+  }
+  volume += i * volume_delta;
+#endif
+
+  for (; i < count; ++i)
+  {
+    output[i] = MathUtil::Clamp((input[i] * volume) >> 15, -32767, 32767);  // -32768 ?
+    volume += volume_delta;
+  }
+  return volume;
+}
+
 // Add samples to an output buffer, with optional volume ramping.
 void MixAdd(int* out, const s16* input, u32 count, u16* pvol, s16* dpop, bool ramp)
 {
@@ -415,18 +683,29 @@ void MixAdd(int* out, const s16* input, u32 count, u16* pvol, s16* dpop, bool ra
   if (!ramp)
     volume_delta = 0;
 
-  for (u32 i = 0; i < count; ++i)
-  {
-    s64 sample = input[i];
-    sample *= volume;
-    sample >>= 15;
-    sample = MathUtil::Clamp((s32)sample, -32767, 32767);  // -32768 ?
+  if (!count)
+    return;
 
-    out[i] += (s16)sample;
-    volume += volume_delta;
+  s16 samples[MAX_SAMPLES_PER_FRAME];
+  volume = ScaleSamples(samples, input, count, volume, volume_delta);
 
-    *dpop = (s16)sample;
+  u32 i = 0;
+#ifdef _M_X86
+  for (; i + 8 <= count; i += 8)
+  {
+    const __m128i scaled = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+    __m128i* out_lo = reinterpret_cast<__m128i*>(out + i);
+    __m128i* out_hi = reinterpret_cast<__m128i*>(out + i + 4);
+    _mm_storeu_si128(out_lo, _mm_add_epi32(_mm_loadu_si128(out_lo),
+                                           _mm_srai_epi32(_mm_unpacklo_epi16(scaled, scaled), 16)));
+    _mm_storeu_si128(out_hi, _mm_add_epi32(_mm_loadu_si128(out_hi),
+                                           _mm_srai_epi32(_mm_unpackhi_epi16(scaled, scaled), 16)));
   }
+#endif
+  for (; i < count; ++i)
+    out[i] += samples[i];
+
+  *dpop = samples[count - 1];
 }
 
 // Execute a low pass filter on the samples using one history value. Returns
@@ -449,15 +728,11 @@ void ProcessVoice(PB_TYPE& pb, const AXBuffers& buffers, u16 count, AXMixControl
 
   // Read input samples, performing sample rate conversion if needed.
   s16 samples[MAX_SAMPLES_PER_FRAME];
-  GetInputSamples(pb, samples, count, coeffs);
+  GetInputSamples(pb, samples, count);
 
   // Apply a global volume ramp using the volume envelope parameters.
-  for (u32 i = 0; i < count; ++i)
-  {
-    samples[i] = MathUtil::Clamp(((s32)samples[i] * pb.vol_env.cur_volume) >> 15, -32767,
-                                 32767);  // -32768 ?
-    pb.vol_env.cur_volume += pb.vol_env.cur_volume_delta;
-  }
+  pb.vol_env.cur_volume =
+      ScaleSamples(samples, samples, count, pb.vol_env.cur_volume, pb.vol_env.cur_volume_delta);
 
   // Optionally, execute a low pass filter
   // TODO: LPF code is currently broken, causing Super Monkey Ball sound
@@ -533,9 +808,8 @@ void ProcessVoice(PB_TYPE& pb, const AXBuffers& buffers, u16 count, AXMixControl
 
     // We use ratio 0x55555 == (5 * 65536 + 21845) / 65536 == 5.3333 which
     // is the nearest we can get to 96/18
-    u32 curr_pos = ResampleAudio([&samples](u32 i) { return samples[i]; }, wm_samples, wm_count,
-                                 pb.remote_src.last_samples, pb.remote_src.cur_addr_frac, 0x55555,
-                                 SRCTYPE_POLYPHASE, coeffs);
+    u32 curr_pos = ResampleAudio(samples, wm_samples, wm_count, pb.remote_src.last_samples,
+                                 pb.remote_src.cur_addr_frac, 0x55555, SRCTYPE_POLYPHASE);
     pb.remote_src.cur_addr_frac = curr_pos & 0xFFFF;
 
 // Mix to main[0-3] and aux[0-3]
@@ -572,4 +846,53 @@ void ProcessVoice(PB_TYPE& pb, const AXBuffers& buffers, u16 count, AXMixControl
 #endif
 }
 
+// Processes <pbs> on all the threads of <workers>, by calling process_pb(pb, buffers) for every
+// PB. Each thread mixes its share of the voices to its own buffers, which are added to <buffers>
+// at the end. Mixing only adds samples up, so the output is exactly the same as when processing
+// the voices one after the other.
+template <typename ProcessPB>
+void ProcessPBsInParallel(Common::WorkerPool& workers, std::vector<PB_TYPE>& pbs,
+                          const AXBuffers& buffers, const u32* buffer_sizes,
+                          std::vector<int>& thread_buffers, ProcessPB process_pb)
+{
+  const size_t NUM_BUFFERS = ArraySize(buffers.ptrs);
+  u32 thread_buffers_size = 0;
+  for (size_t i = 0; i < NUM_BUFFERS; ++i)
+    thread_buffers_size += buffer_sizes[i];
+
+  // The calling thread mixes to the output buffers directly.
+  const size_t num_threads = workers.GetNumThreads();
+  thread_buffers.assign(thread_buffers_size * (num_threads - 1), 0);
+  const auto get_thread_buffers = [&](size_t thread) {
+    if (thread == 0)
+      return buffers;
+
+    AXBuffers result;
+    int* ptr = &thread_buffers[thread_buffers_size * (thread - 1)];
+    for (size_t i = 0; i < NUM_BUFFERS; ++i)
+    {
+      result.ptrs[i] = ptr;
+      ptr += buffer_sizes[i];
+    }
+    return result;
+  };
+
+  // Voices are interleaved, as inactive ones tend to be next to each other.
+  workers.Run([&](size_t thread) {
+    const AXBuffers mix_buffers = get_thread_buffers(thread);
+    for (size_t i = thread; i < pbs.size(); i += num_threads)
+      process_pb(pbs[i], mix_buffers);
+  });
+
+  for (size_t thread = 1; thread < num_threads; ++thread)
+  {
+    const AXBuffers mix_buffers = get_thread_buffers(thread);
+    for (size_t i = 0; i < NUM_BUFFERS; ++i)
+    {
+      for (u32 j = 0; j < buffer_sizes[i]; ++j)
+        buffers.ptrs[i][j] += mix_buffers.ptrs[i][j];
+    }
+  }
+}
+
 }  // namespace
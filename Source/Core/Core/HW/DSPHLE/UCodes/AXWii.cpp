@@ -5,6 +5,11 @@
 #define AX_WII  // Used in AXVoice.
 
 #include "Core/HW/DSPHLE/UCodes/AXWii.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 #include "Common/ChunkFile.h"
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
@@ -433,17 +438,50 @@ void AXWiiUCode::ReinjectUpdatesFields(AXPBWii& pb, u16* num_updates, u32 update
 
 void AXWiiUCode::ProcessPBList(u32 pb_addr)
 {
+  const AXBuffers buffers = {{m_samples_left,      m_samples_right,      m_samples_surround,
+                              m_samples_auxA_left, m_samples_auxA_right, m_samples_auxA_surround,
+                              m_samples_auxB_left, m_samples_auxB_right, m_samples_auxB_surround,
+                              m_samples_auxC_left, m_samples_auxC_right, m_samples_auxC_surround,
+                              m_samples_wm0,       m_samples_aux0,       m_samples_wm1,
+                              m_samples_aux1,      m_samples_wm2,        m_samples_aux2,
+                              m_samples_wm3,       m_samples_aux3}};
+
+  // Old versions process voices ms per ms, and forward the Wiimote buffers past their end, which
+  // only works out when mixing to the real buffers.
+  if (m_voice_workers && !m_old_axwii)
+  {
+    std::vector<u32> pb_addrs;
+    std::vector<AXPBWii> pbs;
+    while (pb_addr)
+    {
+      AXPBWii pb;
+      ReadPB(pb_addr, pb);
+      pb_addrs.push_back(pb_addr);
+      pbs.push_back(pb);
+      pb_addr = HILO_TO_32(pb.next_pb);
+    }
+
+    // The main and AUX buffers hold 3 ms of 32 samples, the 8 Wiimote ones 3 ms of 6 samples.
+    u32 buffer_sizes[ArraySize(buffers.ptrs)];
+    std::fill(std::begin(buffer_sizes), std::end(buffer_sizes) - 8, 32 * 3);
+    std::fill(std::end(buffer_sizes) - 8, std::end(buffer_sizes), 6 * 3);
+    ProcessPBsInParallel(*m_voice_workers, pbs, buffers, buffer_sizes, m_voice_mix_buffers,
+                         [this](AXPBWii& pb, const AXBuffers& mix_buffers) {
+                           ProcessVoice(pb, mix_buffers, 96,
+                                        ConvertMixerControl(HILO_TO_32(pb.mixer_control)),
+                                        m_coeffs_available ? m_coeffs : nullptr);
+                         });
+
+    for (size_t i = 0; i < pbs.size(); ++i)
+      WritePB(pb_addrs[i], pbs[i]);
+    return;
+  }
+
   AXPBWii pb;
 
   while (pb_addr)
   {
-    AXBuffers buffers = {{m_samples_left,      m_samples_right,      m_samples_surround,
-                          m_samples_auxA_left, m_samples_auxA_right, m_samples_auxA_surround,
-                          m_samples_auxB_left, m_samples_auxB_right, m_samples_auxB_surround,
-                          m_samples_auxC_left, m_samples_auxC_right, m_samples_auxC_surround,
-                          m_samples_wm0,       m_samples_aux0,       m_samples_wm1,
-                          m_samples_aux1,      m_samples_wm2,        m_samples_aux2,
-                          m_samples_wm3,       m_samples_aux3}};
+    AXBuffers buffers_ms = buffers;
 
     ReadPB(pb_addr, pb);
 
@@ -455,12 +493,12 @@ void AXWiiUCode::ProcessPBList(u32 pb_addr)
       for (int curr_ms = 0; curr_ms < 3; ++curr_ms)
       {
         ApplyUpdatesForMs(curr_ms, (u16*)&pb, num_updates, updates);
-        ProcessVoice(pb, buffers, 32, ConvertMixerControl(HILO_TO_32(pb.mixer_control)),
+        ProcessVoice(pb, buffers_ms, 32, ConvertMixerControl(HILO_TO_32(pb.mixer_control)),
                      m_coeffs_available ? m_coeffs : nullptr);
 
         // Forward the buffers
-        for (size_t i = 0; i < ArraySize(buffers.ptrs); ++i)
-          buffers.ptrs[i] += 32;
+        for (size_t i = 0; i < ArraySize(buffers_ms.ptrs); ++i)
+          buffers_ms.ptrs[i] += 32;
       }
       ReinjectUpdatesFields(pb, num_updates, updates_addr);
     }
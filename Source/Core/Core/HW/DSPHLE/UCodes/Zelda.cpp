@@ -8,6 +8,7 @@
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
+#include "Common/SwapCopy.h"
 #include "Core/HW/DSPHLE/MailHandler.h"
 #include "Core/HW/DSPHLE/UCodes/GBA.h"
 #include "Core/HW/DSPHLE/UCodes/UCodes.h"
@@ -1297,8 +1298,7 @@ void ZeldaAudioRenderer::FetchVPB(u16 voice_id, VPB* vpb)
   size_t vpb_size = (m_flags & TINY_VPB) ? 0x80 : 0xC0;
 
   size_t base_idx = voice_id * vpb_size;
-  for (size_t i = 0; i < vpb_size; ++i)
-    vpb_words[i] = Common::swap16(ram_vpbs[base_idx + i]);
+  Common::CopySwapped(vpb_words, &ram_vpbs[base_idx], vpb_size);
 
   if (m_flags & TINY_VPB)
     vpb->Uncompress();
@@ -1316,8 +1316,7 @@ void ZeldaAudioRenderer::StoreVPB(u16 voice_id, VPB* vpb)
     vpb->Compress();
 
   // Only the first 0x80 words are transferred back - the rest is read-only.
-  for (size_t i = 0; i < vpb_size - 0x40; ++i)
-    ram_vpbs[base_idx + i] = Common::swap16(vpb_words[i]);
+  Common::CopySwapped(&ram_vpbs[base_idx], vpb_words, vpb_size - 0x40);
 }
 
 void ZeldaAudioRenderer::LoadInputSamples(MixingBuffer* buffer, VPB* vpb)
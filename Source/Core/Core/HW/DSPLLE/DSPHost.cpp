@@ -7,7 +7,6 @@
 #include "Common/Hash.h"
 #include "Common/Logging/Log.h"
 #include "Core/ConfigManager.h"
-#include "Core/DSP/DSPAnalyzer.h"
 #include "Core/DSP/DSPCore.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DSPLLE/DSPLLETools.h"
@@ -116,10 +115,7 @@ void CodeLoaded(const u8* ptr, int size)
 
   UpdateDebugger();
 
-  if (g_dsp_jit)
-    g_dsp_jit->ClearIRAM();
-
-  DSPAnalyzer::Analyze();
+  DSPCore_IRAMChanged();
 }
 
 void UpdateDebugger()
@@ -27,6 +27,7 @@
 #include "Core/Host.h"
 #include "Core/Movie.h"
 #include "Core/NetPlayProto.h"
+#include "Core/SamplingProfiler.h"
 
 static Common::Event dspEvent;
 static Common::Event ppcEvent;
@@ -79,6 +80,7 @@ void DSPLLE::DoState(PointerWrap& p)
 void DSPLLE::DSPThread(DSPLLE* dsp_lle)
 {
   Common::SetCurrentThreadName("DSP thread");
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::DSP);
 
   while (dsp_lle->m_bIsRunning.IsSet())
   {
@@ -148,6 +150,12 @@ static bool FillDSPInitOptions(DSPInitOptions* opts)
     opts->capture_logger = new PCAPDSPCaptureLogger(pcap_path);
   }
 
+  if (SConfig::GetInstance().bDSPUCodeCache && opts->core_type == DSPInitOptions::CORE_JIT)
+  {
+    File::CreateFullPath(File::GetUserPath(D_CACHE_IDX));
+    opts->ucode_cache_filename = File::GetUserPath(D_CACHE_IDX) + "dsplle-ucodes.cache";
+  }
+
   return true;
 }
 
@@ -279,6 +287,7 @@ void DSPLLE::DSP_WriteMailBoxLow(bool _CPUMailbox, u16 _uLowMail)
 
 void DSPLLE::DSP_Update(int cycles)
 {
+  SamplingProfiler::ScopedSubsystem profiler_scope(SamplingProfiler::Subsystem::DSP);
   int dsp_cycles = cycles / 6;
 
   if (dsp_cycles <= 0)
@@ -2,6 +2,7 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
 
 #include "Common/ChunkFile.h"
@@ -56,28 +57,27 @@ void ResetGatherPipe()
 
 static void UpdateGatherPipe()
 {
-  u32 cnt;
-  u8* curMem = Memory::GetPointer(ProcessorInterface::Fifo_CPUWritePointer);
-  for (cnt = 0; m_gatherPipeCount >= GATHER_PIPE_SIZE; cnt += GATHER_PIPE_SIZE)
+  const u32 bursts = m_gatherPipeCount / GATHER_PIPE_SIZE;
+  u32 cnt = 0;
+  while (cnt < bursts * GATHER_PIPE_SIZE)
   {
-    // copy the GatherPipe
-    memcpy(curMem, m_gatherPipe + cnt, GATHER_PIPE_SIZE);
-    m_gatherPipeCount -= GATHER_PIPE_SIZE;
-
-    // increase the CPUWritePointer
-    if (ProcessorInterface::Fifo_CPUWritePointer == ProcessorInterface::Fifo_CPUEnd)
-    {
-      ProcessorInterface::Fifo_CPUWritePointer = ProcessorInterface::Fifo_CPUBase;
-      curMem = Memory::GetPointer(ProcessorInterface::Fifo_CPUWritePointer);
-    }
+    // copy as many bursts as fit before the end of the FIFO at once. The burst at Fifo_CPUEnd
+    // is still written, and then the pointer wraps around.
+    u32& write_pointer = ProcessorInterface::Fifo_CPUWritePointer;
+    u32 size = bursts * GATHER_PIPE_SIZE - cnt;
+    if (write_pointer <= ProcessorInterface::Fifo_CPUEnd)
+      size = std::min(size, ProcessorInterface::Fifo_CPUEnd - write_pointer + GATHER_PIPE_SIZE);
+    memcpy(Memory::GetPointer(write_pointer), m_gatherPipe + cnt, size);
+    cnt += size;
+
+    if (write_pointer + size - GATHER_PIPE_SIZE == ProcessorInterface::Fifo_CPUEnd)
+      write_pointer = ProcessorInterface::Fifo_CPUBase;
     else
-    {
-      curMem += GATHER_PIPE_SIZE;
-      ProcessorInterface::Fifo_CPUWritePointer += GATHER_PIPE_SIZE;
-    }
-
-    CommandProcessor::GatherPipeBursted();
+      write_pointer += size;
   }
+  m_gatherPipeCount -= cnt;
+
+  CommandProcessor::GatherPipeBursted(bursts);
 
   // move back the spill bytes
   memmove(m_gatherPipe, m_gatherPipe + cnt, m_gatherPipeCount);
@@ -12,7 +12,11 @@ namespace GPFifo
 {
 enum
 {
-  GATHER_PIPE_SIZE = 32
+  GATHER_PIPE_SIZE = 32,
+  // How much JIT blocks write before sending the gather pipe to the FIFO with batching on.
+  // Every block exit sends it too, so the pipe never holds more than this plus a burst and one
+  // write.
+  GATHER_PIPE_BATCH_SIZE = GATHER_PIPE_SIZE * 8
 };
 
 // More room for the fastmodes
@@ -7,14 +7,23 @@
 // However, if a JITed instruction (for example lwz) wants to access a bad memory area that call
 // may be redirected here (for example to Read_U32()).
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
+#include "Common/MathUtil.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Core/ConfigManager.h"
 #include "Core/HW/AudioInterface.h"
 #include "Core/HW/DSP.h"
@@ -162,6 +171,40 @@ static PhysicalMemoryRegion physical_regions[] = {
 
 static std::vector<LogicalMemoryView> logical_mapped_entries;
 
+// How each logical page is mapped from the page table. This is looked up on every
+// page table translation, so it's a flat table over the whole address space.
+static std::vector<LogicalPageAccess> logical_page_access;
+// The mapped pages of each TLB set, which is what tlbie invalidates.
+static std::array<std::vector<u32>, HW_PAGE_INDEX_MASK + 1> logical_pages_in_set;
+static bool logical_pages_enabled = false;
+
+// Memory checks unmap logical memory in chunks of this size, which is the
+// view granularity on every host (Windows maps views at 64KB boundaries).
+static const u32 WATCHED_CHUNK_SIZE = 0x10000;
+
+static void ReportHugePages(u32 flags)
+{
+  size_t total = 0;
+  size_t huge = 0;
+  for (const PhysicalMemoryRegion& region : physical_regions)
+  {
+    if ((flags & region.flags) != region.flags)
+      continue;
+    total += region.size;
+    huge += Common::GetHugePageBytes(*region.out_pointer, region.size);
+  }
+
+  if (huge)
+  {
+    NOTICE_LOG(MEMMAP, "Huge pages: %zu of %zu MiB of emulated memory", huge >> 20, total >> 20);
+  }
+  else
+  {
+    WARN_LOG(MEMMAP, "Huge pages: none obtained for emulated memory, see "
+                     "/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+  }
+}
+
 void Init()
 {
   bool wii = SConfig::GetInstance().bWii;
@@ -174,6 +217,8 @@ void Init()
   bFakeVMEM = !wii && !bMMU;
 #endif
 
+  const bool huge_pages = SConfig::GetInstance().bHugePages;
+
   u32 flags = 0;
   if (wii)
     flags |= PhysicalMemoryRegion::WII_ONLY;
@@ -184,10 +229,13 @@ void Init()
   {
     if ((flags & region.flags) != region.flags)
       continue;
+    // Huge pages of the views have to be huge pages of the file too.
+    if (huge_pages)
+      mem_size = ROUND_UP(mem_size, static_cast<u32>(Common::HUGE_PAGE_SIZE));
     region.shm_position = mem_size;
     mem_size += region.size;
   }
-  g_arena.GrabSHMSegment(mem_size);
+  g_arena.GrabSHMSegment(mem_size, huge_pages);
   physical_base = MemArena::FindMemoryBase();
 
   for (PhysicalMemoryRegion& region : physical_regions)
@@ -209,19 +257,87 @@ void Init()
   logical_base = physical_base + 0x200000000;
 #endif
 
+  // Mapping single pages needs the host to have 4KB pages (Windows can only map
+  // views at 64KB granularity).
+#if !defined(_ARCH_32) && !defined(_WIN32)
+  logical_pages_enabled = bMMU && SConfig::GetInstance().bMMUFastmem &&
+                          SConfig::GetInstance().bFastmem && getpagesize() == HW_PAGE_SIZE;
+#endif
+  if (logical_pages_enabled)
+    logical_page_access.assign(1 << (32 - HW_PAGE_INDEX_SHIFT), LogicalPageAccess::None);
+
   if (wii)
     mmio_mapping = InitMMIOWii();
   else
     mmio_mapping = InitMMIO();
 
+  // This faults in all of the memory.
   Clear();
+  if (huge_pages)
+    ReportHugePages(flags);
 
   INFO_LOG(MEMMAP, "Memory system initialized. RAM at %p", m_pRAM);
   m_IsInitialized = true;
 }
 
+static void CreateLogicalView(u32 logical_address, u32 position, u32 size)
+{
+  void* mapped_pointer = g_arena.CreateView(position, size, logical_base + logical_address);
+  if (!mapped_pointer)
+  {
+    PanicAlert("MemoryMap_Setup: Failed finding a memory base.");
+    exit(0);
+  }
+  logical_mapped_entries.push_back({mapped_pointer, size});
+}
+
+// Maps [logical_address, logical_address + size) to the given arena position, leaving out chunks
+// with memory checks. Fastmem accesses to those fault and get backpatched to the memory functions,
+// which check for hits, while accesses to the rest of the range keep running at full speed.
+static void MapLogicalView(u32 logical_address, u32 position, u32 size)
+{
+  if (!PowerPC::memchecks.HasAny())
+  {
+    CreateLogicalView(logical_address, position, size);
+    return;
+  }
+
+  const u64 end = u64(logical_address) + size;
+  u64 run_start = logical_address;
+  for (u64 chunk = logical_address; chunk < end;)
+  {
+    const u64 chunk_end =
+        std::min(end, (chunk & ~u64(WATCHED_CHUNK_SIZE - 1)) + WATCHED_CHUNK_SIZE);
+    if (PowerPC::memchecks.OverlapsMemoryRange(u32(chunk), u32(chunk_end - chunk)))
+    {
+      if (run_start < chunk)
+      {
+        CreateLogicalView(u32(run_start), position + u32(run_start - logical_address),
+                          u32(chunk - run_start));
+      }
+      run_start = chunk_end;
+    }
+    chunk = chunk_end;
+  }
+  if (run_start < end)
+  {
+    CreateLogicalView(u32(run_start), position + u32(run_start - logical_address),
+                      u32(end - run_start));
+  }
+}
+
+bool IsWatchedLogicalChunk(u32 logical_address)
+{
+  return PowerPC::memchecks.HasAny() &&
+         PowerPC::memchecks.OverlapsMemoryRange(logical_address & ~(WATCHED_CHUNK_SIZE - 1),
+                                                WATCHED_CHUNK_SIZE);
+}
+
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
 {
+  // The new BATs may cover logical addresses which were mapped through the page table.
+  ClearLogicalPages();
+
   for (auto& entry : logical_mapped_entries)
   {
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
@@ -245,22 +361,95 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
         {
           // Found an overlapping region; map it.
           u32 position = physical_region.shm_position + intersection_start - mapping_address;
-          u8* base = logical_base + logical_address + intersection_start - translated_address;
-          u32 mapped_size = intersection_end - intersection_start;
-
-          void* mapped_pointer = g_arena.CreateView(position, mapped_size, base);
-          if (!mapped_pointer)
-          {
-            PanicAlert("MemoryMap_Setup: Failed finding a memory base.");
-            exit(0);
-          }
-          logical_mapped_entries.push_back({mapped_pointer, mapped_size});
+          MapLogicalView(logical_address + intersection_start - translated_address, position,
+                         intersection_end - intersection_start);
         }
       }
     }
   }
 }
 
+bool HasLogicalPages()
+{
+  return logical_pages_enabled;
+}
+
+LogicalPageAccess GetLogicalPageAccess(u32 logical_address)
+{
+  if (!logical_pages_enabled)
+    return LogicalPageAccess::None;
+  return logical_page_access[logical_address >> HW_PAGE_INDEX_SHIFT];
+}
+
+void MapLogicalPage(u32 logical_address, u32 physical_address, bool writeable)
+{
+  if (!logical_pages_enabled)
+    return;
+
+  const u32 page = logical_address >> HW_PAGE_INDEX_SHIFT;
+  u8* base = logical_base + (page << HW_PAGE_INDEX_SHIFT);
+  LogicalPageAccess& access = logical_page_access[page];
+  if (access != LogicalPageAccess::None)
+  {
+    if (writeable && access == LogicalPageAccess::ReadOnly)
+    {
+      Common::UnWriteProtectMemory(base, HW_PAGE_SIZE);
+      access = LogicalPageAccess::ReadWrite;
+    }
+    return;
+  }
+
+  // Leave watched pages unmapped, see MapLogicalView.
+  if (PowerPC::memchecks.HasAny() &&
+      PowerPC::memchecks.OverlapsMemoryRange(page << HW_PAGE_INDEX_SHIFT, HW_PAGE_SIZE))
+  {
+    return;
+  }
+
+  physical_address &= ~(HW_PAGE_SIZE - 1);
+  for (const auto& physical_region : physical_regions)
+  {
+    // Only RAM is mirrored; everything else keeps going through the slow path.
+    if (!*physical_region.out_pointer || physical_address < physical_region.physical_address ||
+        physical_address - physical_region.physical_address >= physical_region.size)
+    {
+      continue;
+    }
+
+    u32 position =
+        physical_region.shm_position + physical_address - physical_region.physical_address;
+    if (!g_arena.CreateView(position, HW_PAGE_SIZE, base))
+      return;
+    if (!writeable)
+      Common::WriteProtectMemory(base, HW_PAGE_SIZE);
+    access = writeable ? LogicalPageAccess::ReadWrite : LogicalPageAccess::ReadOnly;
+    logical_pages_in_set[page & HW_PAGE_INDEX_MASK].push_back(page);
+    return;
+  }
+}
+
+static void UnmapLogicalPages(std::vector<u32>* pages)
+{
+  for (u32 page : *pages)
+  {
+    g_arena.ReleaseView(logical_base + (page << HW_PAGE_INDEX_SHIFT), HW_PAGE_SIZE);
+    logical_page_access[page] = LogicalPageAccess::None;
+  }
+  pages->clear();
+}
+
+void InvalidateLogicalPages(u32 logical_address)
+{
+  UnmapLogicalPages(
+      &logical_pages_in_set[(logical_address >> HW_PAGE_INDEX_SHIFT) & HW_PAGE_INDEX_MASK]);
+}
+
+void ClearLogicalPages()
+{
+  for (std::vector<u32>& pages : logical_pages_in_set)
+    UnmapLogicalPages(&pages);
+}
+
 void DoState(PointerWrap& p)
 {
   bool wii = SConfig::GetInstance().bWii;
@@ -295,6 +484,10 @@ void Shutdown()
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
   }
   logical_mapped_entries.clear();
+  ClearLogicalPages();
+  logical_pages_enabled = false;
+  logical_page_access.clear();
+  logical_page_access.shrink_to_fit();
   g_arena.ReleaseSHMSegment();
   physical_base = nullptr;
   logical_base = nullptr;
@@ -9,6 +9,7 @@
 
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
+#include "Common/SwapCopy.h"
 #include "Core/PowerPC/PowerPC.h"
 
 // Global declarations
@@ -64,6 +65,26 @@ void Shutdown();
 void DoState(PointerWrap& p);
 
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table);
+// Whether the BAT mapped part of the logical view leaves out the memory around
+// logical_address because of memory checks.
+bool IsWatchedLogicalChunk(u32 logical_address);
+
+// With MMU fastmem, pages translated through the page table are mirrored into the
+// logical address space as well. Pages which aren't writeable yet (their C bit
+// isn't set) are mapped read-only, so the first write faults and sets it.
+enum class LogicalPageAccess : u8
+{
+  None,
+  ReadOnly,
+  ReadWrite,
+};
+
+bool HasLogicalPages();
+LogicalPageAccess GetLogicalPageAccess(u32 logical_address);
+void MapLogicalPage(u32 logical_address, u32 physical_address, bool writeable);
+// Unmaps all pages which share a TLB set with logical_address, like tlbie does.
+void InvalidateLogicalPages(u32 logical_address);
+void ClearLogicalPages();
 
 void Clear();
 
@@ -85,7 +106,7 @@ void Write_U64(const u64 var, const u32 address);
 void Write_U32_Swap(const u32 var, const u32 address);
 void Write_U64_Swap(const u64 var, const u32 address);
 
-// Templated functions for byteswapped copies.
+// Templated functions for byteswapped copies of u16 or u32 elements.
 template <typename T>
 void CopyFromEmuSwapped(T* data, u32 address, size_t size)
 {
@@ -94,8 +115,7 @@ void CopyFromEmuSwapped(T* data, u32 address, size_t size)
   if (src == nullptr)
     return;
 
-  for (size_t i = 0; i < size / sizeof(T); i++)
-    data[i] = Common::FromBigEndian(src[i]);
+  Common::CopySwapped(data, src, size / sizeof(T));
 }
 
 template <typename T>
@@ -106,7 +126,6 @@ void CopyToEmuSwapped(u32 address, const T* data, size_t size)
   if (dest == nullptr)
     return;
 
-  for (size_t i = 0; i < size / sizeof(T); i++)
-    dest[i] = Common::FromBigEndian(data[i]);
+  Common::CopySwapped(dest, data, size / sizeof(T));
 }
 }
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "Core/PowerPC/CachedInterpreter.h"
+#include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Core/ConfigManager.h"
@@ -10,7 +11,9 @@
 #include "Core/HLE/HLE.h"
 #include "Core/HW/CPU.h"
 #include "Core/PowerPC/Gekko.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
 #include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PPCTables.h"
 #include "Core/PowerPC/PowerPC.h"
 
 void CachedInterpreter::Init()
@@ -37,24 +40,8 @@ void CachedInterpreter::ExecuteOneBlock()
   const u8* normal_entry = JitBaseBlockCache::Dispatch();
   const Instruction* code = reinterpret_cast<const Instruction*>(normal_entry);
 
-  for (; code->type != Instruction::INSTRUCTION_ABORT; ++code)
-  {
-    switch (code->type)
-    {
-    case Instruction::INSTRUCTION_TYPE_COMMON:
-      code->common_callback(UGeckoInstruction(code->data));
-      break;
-
-    case Instruction::INSTRUCTION_TYPE_CONDITIONAL:
-      if (code->conditional_callback(code->data))
-        return;
-      break;
-
-    default:
-      ERROR_LOG(POWERPC, "Unknown CachedInterpreter Instruction: %d", code->type);
-      break;
-    }
-  }
+  while (code)
+    code = code->handler(code);
 }
 
 void CachedInterpreter::Run()
@@ -79,45 +66,483 @@ void CachedInterpreter::SingleStep()
   ExecuteOneBlock();
 }
 
-static void EndBlock(UGeckoInstruction data)
+using Instruction = CachedInterpreter::Instruction;
+
+static const Instruction* Abort(const Instruction* inst)
+{
+  return nullptr;
+}
+
+static const Instruction* InterpreterOp(const Instruction* inst)
+{
+  inst->interpreter_op(UGeckoInstruction(inst->data));
+  return inst + 1;
+}
+
+static const Instruction* EndBlock(const Instruction* inst)
 {
   PC = NPC;
-  PowerPC::ppcState.downcount -= data.hex;
+  PowerPC::ppcState.downcount -= inst->data;
+  return inst + 1;
+}
+
+// Ends the block after an HLE function which replaced the original code, and goes on with it if
+// the function left NPC alone.
+static const Instruction* EndBlockIfReplaced(const Instruction* inst)
+{
+  if (NPC == PC)
+  {
+    NPC = PC + 4;
+    return inst + 1;
+  }
+  PC = NPC;
+  PowerPC::ppcState.downcount -= inst->data;
+  return nullptr;
 }
 
-static void WritePC(UGeckoInstruction data)
+static const Instruction* WritePC(const Instruction* inst)
 {
-  PC = data.hex;
-  NPC = data.hex + 4;
+  PC = inst->data;
+  NPC = inst->data + 4;
+  return inst + 1;
 }
 
-static void WriteBrokenBlockNPC(UGeckoInstruction data)
+static const Instruction* WriteBrokenBlockNPC(const Instruction* inst)
 {
-  NPC = data.hex;
+  NPC = inst->data;
+  return inst + 1;
 }
 
-static bool CheckFPU(u32 data)
+static const Instruction* CheckFPU(const Instruction* inst)
 {
   UReg_MSR& msr = (UReg_MSR&)MSR;
   if (!msr.FP)
   {
     PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
     PowerPC::CheckExceptions();
-    PowerPC::ppcState.downcount -= data;
-    return true;
+    PowerPC::ppcState.downcount -= inst->data;
+    return nullptr;
   }
-  return false;
+  return inst + 1;
 }
 
-static bool CheckDSI(u32 data)
+static const Instruction* CheckDSI(const Instruction* inst)
 {
   if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
   {
     PowerPC::CheckExceptions();
-    PowerPC::ppcState.downcount -= data;
-    return true;
+    PowerPC::ppcState.downcount -= inst->data;
+    return nullptr;
+  }
+  return inst + 1;
+}
+
+// Same as Interpreter::Helper_UpdateCRx.
+static void UpdateCR(int field, u32 value)
+{
+  u64 cr_val = static_cast<u64>(static_cast<s64>(static_cast<s32>(value)));
+  cr_val = (cr_val & ~(1ull << 61)) | (static_cast<u64>(GetXER_SO()) << 61);
+  PowerPC::ppcState.cr_val[field] = cr_val;
+}
+
+static const Instruction* LoadImmediate(const Instruction* inst)
+{
+  rGPR[inst->d] = inst->imm;
+  return inst + 1;
+}
+
+static const Instruction* AddImmediate(const Instruction* inst)
+{
+  rGPR[inst->d] = rGPR[inst->a] + inst->imm;
+  return inst + 1;
+}
+
+static const Instruction* OrImmediate(const Instruction* inst)
+{
+  rGPR[inst->d] = rGPR[inst->a] | inst->imm;
+  return inst + 1;
+}
+
+static const Instruction* Add(const Instruction* inst)
+{
+  rGPR[inst->d] = rGPR[inst->a] + rGPR[inst->b];
+  return inst + 1;
+}
+
+static const Instruction* Or(const Instruction* inst)
+{
+  rGPR[inst->d] = rGPR[inst->a] | rGPR[inst->b];
+  return inst + 1;
+}
+
+// rlwinm, with the rotation in b and the mask in imm.
+static void RotateAndMask(const Instruction* inst)
+{
+  rGPR[inst->d] = _rotl(rGPR[inst->a], inst->b) & inst->imm;
+}
+
+static const Instruction* Rlwinm(const Instruction* inst)
+{
+  RotateAndMask(inst);
+  return inst + 1;
+}
+
+static const Instruction* RlwinmRc(const Instruction* inst)
+{
+  RotateAndMask(inst);
+  UpdateCR(0, rGPR[inst->d]);
+  return inst + 1;
+}
+
+// data rlwinms in a row, none of them with Rc.
+static const Instruction* RlwinmChain(const Instruction* inst)
+{
+  const Instruction* end = inst + inst->data;
+  for (; inst != end; ++inst)
+    RotateAndMask(inst);
+  return end;
+}
+
+static u32 EffectiveAddress(const Instruction* inst)
+{
+  return (inst->a ? rGPR[inst->a] : 0) + inst->imm;
+}
+
+static void LoadWord(const Instruction* inst)
+{
+  u32 value = PowerPC::Read_U32(EffectiveAddress(inst));
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[inst->d] = value;
+}
+
+static const Instruction* Lwz(const Instruction* inst)
+{
+  LoadWord(inst);
+  return inst + 1;
+}
+
+static const Instruction* Stw(const Instruction* inst)
+{
+  PowerPC::Write_U32(rGPR[inst->d], EffectiveAddress(inst));
+  return inst + 1;
+}
+
+// bc at the address in imm. The interpreter's bcx also detects idle loops.
+static const Instruction* BranchConditional(const Instruction* inst)
+{
+  PC = inst->imm;
+  NPC = inst->imm + 4;
+  Interpreter::bcx(UGeckoInstruction(inst->data));
+  return inst + 1;
+}
+
+enum class Comparison
+{
+  Signed,
+  Unsigned,
+  SignedImmediate,
+  UnsignedImmediate,
+};
+
+template <Comparison comparison>
+static void Compare(const Instruction* inst)
+{
+  const u32 a = rGPR[inst->a];
+
+  // Like Interpreter::cmpi, this looks at the difference.
+  if (comparison == Comparison::SignedImmediate)
+  {
+    UpdateCR(inst->crf, a - inst->imm);
+    return;
+  }
+
+  const u32 b = comparison == Comparison::UnsignedImmediate ? inst->imm : rGPR[inst->b];
+  bool less, greater;
+  if (comparison == Comparison::Signed)
+  {
+    less = static_cast<s32>(a) < static_cast<s32>(b);
+    greater = static_cast<s32>(a) > static_cast<s32>(b);
+  }
+  else
+  {
+    less = a < b;
+    greater = a > b;
+  }
+
+  int flags = less ? 0x8 : greater ? 0x4 : 0x2;
+  if (GetXER_SO())
+    flags |= 0x1;
+  SetCRField(inst->crf, flags);
+}
+
+template <Comparison comparison>
+static const Instruction* CompareOp(const Instruction* inst)
+{
+  Compare<comparison>(inst);
+  return inst + 1;
+}
+
+// A compare followed by a bc and the EndBlock of the block.
+template <Comparison comparison>
+static const Instruction* CompareAndBranch(const Instruction* inst)
+{
+  Compare<comparison>(inst);
+  return EndBlock(BranchConditional(inst + 1));
+}
+
+// An lwz followed by a compare, a bc and the EndBlock of the block.
+template <Comparison comparison>
+static const Instruction* LoadCompareAndBranch(const Instruction* inst)
+{
+  LoadWord(inst);
+  Compare<comparison>(inst + 1);
+  return EndBlock(BranchConditional(inst + 2));
+}
+
+struct CompareHandlers
+{
+  Instruction::Handler compare;
+  Instruction::Handler compare_and_branch;
+  Instruction::Handler load_compare_and_branch;
+};
+
+template <Comparison comparison>
+static constexpr CompareHandlers GetCompareHandlers()
+{
+  return {CompareOp<comparison>, CompareAndBranch<comparison>, LoadCompareAndBranch<comparison>};
+}
+
+static constexpr CompareHandlers s_compare_handlers[] = {
+    GetCompareHandlers<Comparison::Signed>(), GetCompareHandlers<Comparison::Unsigned>(),
+    GetCompareHandlers<Comparison::SignedImmediate>(),
+    GetCompareHandlers<Comparison::UnsignedImmediate>(),
+};
+
+static const CompareHandlers* FindCompareHandlers(Instruction::Handler handler)
+{
+  for (const CompareHandlers& handlers : s_compare_handlers)
+  {
+    if (handlers.compare == handler)
+      return &handlers;
   }
-  return false;
+  return nullptr;
+}
+
+// Decodes op if it has its own handler. The JIT debugging options which turn off parts of
+// the JIT make ops fall back to the interpreter here as well.
+static bool Decode(const PPCAnalyst::CodeOp& op, Instruction* out)
+{
+  const SConfig& config = SConfig::GetInstance();
+  if (config.bJITOff)
+    return false;
+
+  const UGeckoInstruction inst = op.inst;
+  const bool integer = !config.bJITIntegerOff;
+  Instruction decoded{};
+  switch (inst.OPCD)
+  {
+  case 10:  // cmpli
+    if (integer)
+    {
+      decoded.handler = CompareOp<Comparison::UnsignedImmediate>;
+      decoded.a = inst.RA;
+      decoded.imm = inst.UIMM;
+      decoded.crf = inst.CRFD;
+    }
+    break;
+
+  case 11:  // cmpi
+    if (integer)
+    {
+      decoded.handler = CompareOp<Comparison::SignedImmediate>;
+      decoded.a = inst.RA;
+      decoded.imm = inst.SIMM_16;
+      decoded.crf = inst.CRFD;
+    }
+    break;
+
+  case 14:  // addi
+  case 15:  // addis
+    if (integer)
+    {
+      decoded.handler = inst.RA ? AddImmediate : LoadImmediate;
+      decoded.d = inst.RD;
+      decoded.a = inst.RA;
+      decoded.imm = inst.OPCD == 15 ? static_cast<u32>(inst.SIMM_16) << 16 : inst.SIMM_16;
+    }
+    break;
+
+  case 16:  // bcx
+    if (!config.bJITBranchOff)
+    {
+      decoded.handler = BranchConditional;
+      decoded.imm = op.address;
+      decoded.data = inst.hex;
+    }
+    break;
+
+  case 21:  // rlwinmx
+    if (integer)
+    {
+      decoded.handler = inst.Rc ? RlwinmRc : Rlwinm;
+      decoded.d = inst.RA;
+      decoded.a = inst.RS;
+      decoded.b = inst.SH;
+      decoded.imm = Helper_Mask(inst.MB, inst.ME);
+    }
+    break;
+
+  case 24:  // ori
+  case 25:  // oris
+    if (integer)
+    {
+      decoded.handler = OrImmediate;
+      decoded.d = inst.RA;
+      decoded.a = inst.RS;
+      decoded.imm = inst.OPCD == 25 ? inst.UIMM << 16 : inst.UIMM;
+    }
+    break;
+
+  case 31:
+    if (!integer || inst.Rc)
+      break;
+    switch (inst.SUBOP10)
+    {
+    case 0:   // cmp
+    case 32:  // cmpl
+      decoded.handler =
+          inst.SUBOP10 == 0 ? CompareOp<Comparison::Signed> : CompareOp<Comparison::Unsigned>;
+      decoded.a = inst.RA;
+      decoded.b = inst.RB;
+      decoded.crf = inst.CRFD;
+      break;
+
+    case 266:  // addx without OE
+      decoded.handler = Add;
+      decoded.d = inst.RD;
+      decoded.a = inst.RA;
+      decoded.b = inst.RB;
+      break;
+
+    case 444:  // orx
+      decoded.handler = Or;
+      decoded.d = inst.RA;
+      decoded.a = inst.RS;
+      decoded.b = inst.RB;
+      break;
+    }
+    break;
+
+  case 32:  // lwz
+  case 36:  // stw
+    if (!config.bJITLoadStoreOff && !(inst.OPCD == 32 && config.bJITLoadStorelwzOff))
+    {
+      decoded.handler = inst.OPCD == 32 ? Lwz : Stw;
+      decoded.d = inst.RD;
+      decoded.a = inst.RA;
+      decoded.imm = inst.SIMM_16;
+    }
+    break;
+  }
+
+  if (!decoded.handler)
+    return false;
+  *out = decoded;
+  return true;
+}
+
+Instruction& CachedInterpreter::Emit(Instruction::Handler handler, u32 data)
+{
+  m_code.emplace_back();
+  Instruction& inst = m_code.back();
+  inst.handler = handler;
+  inst.data = data;
+  return inst;
+}
+
+void CachedInterpreter::EmitInterpreterOp(Interpreter::Instruction op, UGeckoInstruction inst)
+{
+  Emit(InterpreterOp, inst.hex).interpreter_op = op;
+}
+
+bool CachedInterpreter::EmitDecodedOp(const PPCAnalyst::CodeOp& op, bool write_pc)
+{
+  Instruction decoded;
+  if (!Decode(op, &decoded))
+    return false;
+
+  // Branches write PC themselves.
+  if (write_pc && decoded.handler != BranchConditional)
+    Emit(WritePC, op.address);
+  m_code.push_back(decoded);
+  return true;
+}
+
+u32 CachedInterpreter::EmitFusedOps(const PPCAnalyst::CodeOp* ops, u32 num_ops)
+{
+  Instruction first;
+  if (!Decode(ops[0], &first))
+    return 0;
+
+  // Ops can't be fused into the op before them if they need to be run on their own.
+  auto decode_follower = [&](u32 i, Instruction* decoded) {
+    return i < num_ops && !ops[i].skip && HLE::GetFunctionIndex(ops[i].address) == 0 &&
+           Decode(ops[i], decoded);
+  };
+
+  Instruction next;
+  if (first.handler == Rlwinm)
+  {
+    const size_t start = m_code.size();
+    m_code.push_back(first);
+    u32 count = 1;
+    while (decode_follower(count, &next) && next.handler == Rlwinm)
+    {
+      js.downcountAmount += ops[count].opinfo->numCycles;
+      m_code.push_back(next);
+      count++;
+    }
+    if (count < 2)
+    {
+      m_code.pop_back();
+      return 0;
+    }
+
+    m_code[start].handler = RlwinmChain;
+    m_code[start].data = count;
+    return count;
+  }
+
+  // Loads, compares and branches which end the block.
+  Instruction compare;
+  const CompareHandlers* handlers = nullptr;
+  u32 count;
+  if (first.handler == Lwz)
+  {
+    if (!decode_follower(1, &compare))
+      return 0;
+    handlers = FindCompareHandlers(compare.handler);
+    first.handler = handlers ? handlers->load_compare_and_branch : nullptr;
+    count = 3;
+  }
+  else
+  {
+    compare = first;
+    handlers = FindCompareHandlers(compare.handler);
+    first.handler = handlers ? handlers->compare_and_branch : nullptr;
+    count = 2;
+  }
+  if (!handlers || !decode_follower(count - 1, &next) || next.handler != BranchConditional)
+    return 0;
+
+  m_code.push_back(first);
+  if (count == 3)
+    m_code.push_back(compare);
+  m_code.push_back(next);
+  for (u32 i = 1; i < count; i++)
+    js.downcountAmount += ops[i].opinfo->numCycles;
+  Emit(EndBlock, js.downcountAmount);
+  return count;
 }
 
 void CachedInterpreter::Jit(u32 address)
@@ -167,14 +592,10 @@ void CachedInterpreter::Jit(u32 address)
         int flags = HLE::GetFunctionFlagsByIndex(function);
         if (HLE::IsEnabled(flags))
         {
-          m_code.emplace_back(WritePC, ops[i].address);
-          m_code.emplace_back(Interpreter::HLEFunction, ops[i].inst);
+          Emit(WritePC, ops[i].address);
+          EmitInterpreterOp(Interpreter::HLEFunction, function);
           if (type == HLE::HLE_HOOK_REPLACE)
-          {
-            m_code.emplace_back(EndBlock, js.downcountAmount);
-            m_code.emplace_back();
-            break;
-          }
+            Emit(EndBlockIfReplaced, js.downcountAmount);
         }
       }
     }
@@ -187,26 +608,39 @@ void CachedInterpreter::Jit(u32 address)
 
       if (check_fpu)
       {
-        m_code.emplace_back(WritePC, ops[i].address);
-        m_code.emplace_back(CheckFPU, js.downcountAmount);
+        Emit(WritePC, ops[i].address);
+        Emit(CheckFPU, js.downcountAmount);
         js.firstFPInstructionFound = true;
       }
 
-      if (endblock || memcheck)
-        m_code.emplace_back(WritePC, ops[i].address);
-      m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
+      if (!memcheck)
+      {
+        const u32 fused = EmitFusedOps(&ops[i], code_block.m_num_instructions - i);
+        if (fused != 0)
+        {
+          i += fused - 1;
+          continue;
+        }
+      }
+
+      if (!EmitDecodedOp(ops[i], endblock || memcheck))
+      {
+        if (endblock || memcheck)
+          Emit(WritePC, ops[i].address);
+        EmitInterpreterOp(GetInterpreterOp(ops[i].inst), ops[i].inst);
+      }
       if (memcheck)
-        m_code.emplace_back(CheckDSI, js.downcountAmount);
+        Emit(CheckDSI, js.downcountAmount);
       if (endblock)
-        m_code.emplace_back(EndBlock, js.downcountAmount);
+        Emit(EndBlock, js.downcountAmount);
     }
   }
   if (code_block.m_broken)
   {
-    m_code.emplace_back(WriteBrokenBlockNPC, nextPC);
-    m_code.emplace_back(EndBlock, js.downcountAmount);
+    Emit(WriteBrokenBlockNPC, nextPC);
+    Emit(EndBlock, js.downcountAmount);
   }
-  m_code.emplace_back();
+  Emit(Abort);
 
   b->codeSize = (u32)(GetCodePtr() - b->checkedEntry);
   b->originalSize = code_block.m_num_instructions;
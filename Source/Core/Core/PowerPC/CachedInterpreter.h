@@ -8,6 +8,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 
 class CachedInterpreter : public JitBase, JitBaseBlockCache
@@ -30,34 +31,41 @@ public:
   const char* GetName() override { return "Cached Interpreter"; }
   void WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest) override {}
   const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
-private:
+
+  // Blocks are compiled to arrays of Instructions. Each handler runs its instruction and returns
+  // the next one to run, or nullptr to leave the block.
+  //
+  // Common instructions have their own handlers, with the register indices and immediates
+  // decoded when the block is compiled. Everything else calls the interpreter. Handlers of
+  // fused sequences (superinstructions) run the instructions following them as well.
   struct Instruction
   {
-    typedef void (*CommonCallback)(UGeckoInstruction);
-    typedef bool (*ConditionalCallback)(u32 data);
-
-    Instruction() : type(INSTRUCTION_ABORT){};
-    Instruction(const CommonCallback c, UGeckoInstruction i)
-        : common_callback(c), data(i.hex), type(INSTRUCTION_TYPE_COMMON){};
-    Instruction(const ConditionalCallback c, u32 d)
-        : conditional_callback(c), data(d), type(INSTRUCTION_TYPE_CONDITIONAL){};
+    using Handler = const Instruction* (*)(const Instruction* inst);
 
+    Handler handler;
     union {
-      const CommonCallback common_callback;
-      const ConditionalCallback conditional_callback;
+      Interpreter::Instruction interpreter_op;
+      struct
+      {
+        u32 imm;
+        u8 d;
+        u8 a;
+        u8 b;
+        u8 crf;
+      };
     };
     u32 data;
-    enum
-    {
-      INSTRUCTION_ABORT,
-      INSTRUCTION_TYPE_COMMON,
-      INSTRUCTION_TYPE_CONDITIONAL,
-    } type;
   };
 
+private:
   const u8* GetCodePtr() { return (u8*)(m_code.data() + m_code.size()); }
   void ExecuteOneBlock();
 
+  Instruction& Emit(Instruction::Handler handler, u32 data = 0);
+  void EmitInterpreterOp(Interpreter::Instruction op, UGeckoInstruction inst);
+  bool EmitDecodedOp(const PPCAnalyst::CodeOp& op, bool write_pc);
+  u32 EmitFusedOps(const PPCAnalyst::CodeOp* ops, u32 num_ops);
+
   std::vector<Instruction> m_code;
   PPCAnalyst::CodeBuffer code_buffer;
 };
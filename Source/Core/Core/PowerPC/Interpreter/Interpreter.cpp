@@ -109,7 +109,7 @@ int Interpreter::SingleStepInner()
       if (HLE::IsEnabled(flags))
       {
         HLEFunction(function);
-        if (type == HLE::HLE_HOOK_START)
+        if (type == HLE::HLE_HOOK_START || NPC == PC)
         {
           // Run the original.
           function = 0;
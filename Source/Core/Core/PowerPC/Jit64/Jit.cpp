@@ -2,8 +2,12 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <map>
 #include <string>
+#include <vector>
 
 // for the PROFILER stuff
 #ifdef _WIN32
@@ -11,10 +15,12 @@
 #endif
 
 #include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemoryUtil.h"
 #include "Common/StringUtil.h"
 #include "Common/x64ABI.h"
+#include "Core/ConfigManager.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/HLE/HLE.h"
@@ -217,6 +223,7 @@ void Jit64::Init()
   EnableBlockLink();
 
   jo.optimizeGatherPipe = true;
+  jo.batchGatherPipe = SConfig::GetInstance().bBatchGatherPipe;
   jo.accurateSinglePrecision = true;
   UpdateMemoryOptions();
   js.fastmemLoadStore = nullptr;
@@ -238,6 +245,14 @@ void Jit64::Init()
   if (m_enable_blr_optimization)
     AllocStack();
 
+  // Tier 0 doesn't know about breakpoints, so it's off while debugging.
+  m_tiering.Init(SConfig::GetInstance().bJITTiered && !SConfig::GetInstance().bEnableDebugging);
+  // Stepping changes how blocks are analyzed, so don't profile while debugging either.
+  m_traces.Init(SConfig::GetInstance().bJITTraces && !SConfig::GetInstance().bEnableDebugging);
+  m_idle_loops.Init(SConfig::GetInstance().bJITIdleLoops);
+  m_binding_stats = BindingStats();
+  m_return_stack_stats = ReturnStackStats();
+
   blocks.Init();
   asm_routines.Init(m_stack ? (m_stack + STACK_SIZE) : nullptr);
 
@@ -245,7 +260,11 @@ void Jit64::Init()
   // them.
   // it'll crash because the farcode functions get cleared on JIT clears.
   farcode.Init(jo.memcheck ? FARCODE_SIZE_MMU : FARCODE_SIZE);
+  if (SConfig::GetInstance().bHugePages)
+    UseHugePagesForCode();
   Clear();
+  m_code_regions.Init(GetWritableCodePtr(), CODE_SIZE, farcode.GetWritableCodePtr(),
+                      jo.memcheck ? FARCODE_SIZE_MMU : FARCODE_SIZE);
 
   code_block.m_stats = &js.st;
   code_block.m_gpa = &js.gpa;
@@ -253,6 +272,22 @@ void Jit64::Init()
   EnableOptimization();
 }
 
+void Jit64::UseHugePagesForCode()
+{
+  const size_t total = CODE_SIZE + (jo.memcheck ? FARCODE_SIZE_MMU : FARCODE_SIZE) +
+                       (jo.memcheck ? TRAMPOLINE_CODE_SIZE_MMU : TRAMPOLINE_CODE_SIZE);
+  const size_t huge = UseHugePages() + farcode.UseHugePages() + trampolines.UseHugePages();
+  if (huge)
+  {
+    NOTICE_LOG(DYNA_REC, "Huge pages: %zu of %zu MiB of JIT code", huge >> 20, total >> 20);
+  }
+  else
+  {
+    WARN_LOG(DYNA_REC, "Huge pages: none obtained for JIT code, see "
+                       "/sys/kernel/mm/transparent_hugepage/enabled");
+  }
+}
+
 void Jit64::ClearCache()
 {
   blocks.Clear();
@@ -261,6 +296,67 @@ void Jit64::ClearCache()
   ClearCodeSpace();
   Clear();
   UpdateMemoryOptions();
+  m_tiering.Clear();
+  m_traces.Clear();
+  m_code_regions.Clear();
+}
+
+void Jit64::EvictCodeRegion(int code_region)
+{
+  const JitCodeRegions::Region& r = m_code_regions.GetRegion(code_region);
+  const int num_blocks = blocks.DestroyBlocksInCodeRange(r.near_start, r.near_end);
+  ClearBackpatchInfo(r.near_start, r.near_end);
+  // Trampolines of the evicted blocks stay around until the next full clear,
+  // but nothing jumps to them anymore.
+  memset(r.near_start, 0xCC, r.near_end - r.near_start);
+  memset(r.far_start, 0xCC, r.far_end - r.far_start);
+  m_code_regions.OnEvicted(code_region, num_blocks);
+}
+
+void Jit64::OnTimesliceEnded()
+{
+  const int block_num = blocks.GetICache()[(PC >> 2) & JitBaseBlockCache::iCache_Mask];
+  const JitBlock* b = blocks.GetBlock(block_num);
+  if (b->invalid || b->effectiveAddress != PC)
+    return;
+
+  const int code_region = m_code_regions.FindRegion(b->normalEntry);
+  if (code_region >= 0)
+    m_code_regions.MarkExecuted(code_region);
+}
+
+Jit64::HostCode Jit64::GetHostCodeType(const u8* ptr)
+{
+  u8* host_code = const_cast<u8*>(ptr);
+  if (IsInSpace(host_code))
+    return HostCode::Blocks;
+  if (farcode.IsInSpace(host_code) || trampolines.IsInSpace(host_code))
+    return HostCode::FarCode;
+  if (asm_routines.IsInSpace(host_code))
+    return HostCode::Routines;
+  return HostCode::None;
+}
+
+void Jit64::GetProfileCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  m_tiering.GetCounters(counters);
+  m_traces.GetCounters(counters);
+  m_code_regions.GetCounters(counters);
+  m_idle_loops.GetCounters(counters);
+
+  counters->emplace_back("Blocks taking bound registers", m_binding_stats.bound_blocks);
+  counters->emplace_back("Bound exits", m_binding_stats.bound_exits);
+  counters->emplace_back("Bound exit registers", m_binding_stats.passed_registers);
+  counters->emplace_back("Bound exit dirty registers", m_binding_stats.passed_dirty_registers);
+  counters->emplace_back("Bound exit stored registers", m_binding_stats.stored_registers);
+
+  const ReturnStackStats& ras = m_return_stack_stats;
+  counters->emplace_back("Calls pushing a return address", ras.calls);
+  counters->emplace_back("Returns", ras.returns);
+  counters->emplace_back("Predicted returns", ras.predicted_returns);
+  counters->emplace_back("Return prediction hit rate (%)",
+                         ras.returns ? ras.predicted_returns * 100 / ras.returns : 0);
+  counters->emplace_back("Returns through the dispatcher", ras.returns - ras.predicted_returns);
 }
 
 void Jit64::Shutdown()
@@ -272,6 +368,14 @@ void Jit64::Shutdown()
   trampolines.Shutdown();
   asm_routines.Shutdown();
   farcode.Shutdown();
+
+  const std::string& game_id = SConfig::GetInstance().m_strGameID;
+  if (m_idle_loops.IsEnabled() && !game_id.empty())
+  {
+    File::CreateFullPath(File::GetUserPath(D_LOGS_IDX));
+    m_idle_loops.WriteReport(File::GetUserPath(D_LOGS_IDX) + game_id + "-idleloops.txt");
+  }
+  m_idle_loops.Shutdown();
 }
 
 void Jit64::FallBackToInterpreter(UGeckoInstruction inst)
@@ -379,6 +483,8 @@ void Jit64::WriteExit(u32 destination, bool bl, u32 after)
 
   if (bl)
   {
+    if (Profiler::g_ProfileBlocks)
+      WriteProfileCount(&m_return_stack_stats.calls, RSCRATCH2);
     MOV(32, R(RSCRATCH2), Imm32(after));
     PUSH(RSCRATCH2);
   }
@@ -388,6 +494,108 @@ void Jit64::WriteExit(u32 destination, bool bl, u32 after)
   JustWriteExit(destination, bl, after);
 }
 
+void Jit64::WriteProfileCount(u64* counter, X64Reg scratch)
+{
+  MOV(64, R(scratch), ImmPtr(counter));
+  ADD(64, MatR(scratch), Imm8(1));
+}
+
+u64 Jit64::GetEntryBinding(u32 destination, u64* dirty)
+{
+  *dirty = 0;
+  // Anything Cleanup() emits would clobber caller-saved host registers.
+  if (!jo.enableBlocklink || (jo.optimizeGatherPipe && js.fifoBytesSinceCheck > 0) ||
+      MMCR0.Hex || MMCR1.Hex)
+  {
+    return 0;
+  }
+
+  const JitBlock* block = js.curBlock;
+  if (destination != js.blockStart)
+  {
+    int block_num = blocks.GetBlockNumberFromStartAddress(destination, MSR);
+    if (block_num < 0)
+      return 0;
+    block = blocks.GetBlock(block_num);
+  }
+  *dirty = block->entryDirty;
+  return block->entryBinding;
+}
+
+void Jit64::FlushAndWriteExit(u32 destination, FlushMode mode)
+{
+  u64 dirty;
+  const u64 binding = GetEntryBinding(destination, &dirty);
+  const BitSet32 bound_gprs(static_cast<u32>(binding));
+  const BitSet32 bound_fprs(static_cast<u32>(binding >> 32));
+  const BitSet32 dirty_gprs(static_cast<u32>(dirty));
+  const BitSet32 dirty_fprs(static_cast<u32>(dirty >> 32));
+
+  gpr.Flush(mode, ~bound_gprs);
+  fpr.Flush(mode, ~bound_fprs);
+  if (!binding)
+  {
+    WriteExit(destination);
+    return;
+  }
+
+  // The destination doesn't have to load the registers which are already in host registers. It
+  // takes the ones outside of its dirty set as clean, so those are stored here first. The others
+  // are overwritten by the destination before it can exit, so storing them isn't needed at all.
+  const BitSet32 stored_gprs = gpr.GetDirtyRegs(bound_gprs & ~dirty_gprs);
+  const BitSet32 stored_fprs = fpr.GetDirtyRegs(bound_fprs & ~dirty_fprs);
+  const u32 avoided_loads =
+      gpr.GetBoundRegs(bound_gprs).Count() + fpr.GetBoundRegs(bound_fprs).Count();
+  const u32 avoided_stores =
+      gpr.GetDirtyRegs(dirty_gprs).Count() + fpr.GetDirtyRegs(dirty_fprs).Count();
+  m_binding_stats.bound_exits++;
+  m_binding_stats.passed_registers += bound_gprs.Count() + bound_fprs.Count();
+  m_binding_stats.passed_dirty_registers += avoided_stores;
+  m_binding_stats.stored_registers += stored_gprs.Count() + stored_fprs.Count();
+
+  gpr.MoveToBinding(bound_gprs);
+  fpr.MoveToBinding(bound_fprs);
+  gpr.StoreBinding(bound_gprs, stored_gprs);
+  fpr.StoreBinding(bound_fprs, stored_fprs);
+
+  if (Profiler::g_ProfileBlocks)
+  {
+    MOV(64, R(RSCRATCH), ImmPtr(&js.curBlock->avoidedLoads));
+    ADD(64, MatR(RSCRATCH), Imm8(avoided_loads));
+    MOV(64, R(RSCRATCH), ImmPtr(&js.curBlock->avoidedStores));
+    ADD(64, MatR(RSCRATCH), Imm8(avoided_stores));
+  }
+
+  // The bound entry doesn't check the downcount, so do it here. The fallback
+  // relies on the flags, like the checked entry of the destination does.
+  SUB(32, PPCSTATE(downcount), Imm32(js.downcountAmount));
+  FixupBranch timing = J_CC(CC_LE, true);
+
+  // Until this is linked to a block taking the same binding, store the
+  // registers and take the normal exit.
+  JitBlock::LinkData linkData;
+  linkData.exitAddress = destination;
+  linkData.linkStatus = false;
+  linkData.binding = binding;
+  linkData.dirty = dirty;
+  linkData.exitPtrs = GetWritableCodePtr();
+  FixupBranch unlinked = J(true);
+  SetJumpTarget(timing);
+  SetJumpTarget(unlinked);
+  linkData.bindingFallback = GetCodePtr();
+  js.curBlock->linkData.push_back(linkData);
+
+  gpr.StoreBinding(bound_gprs, dirty_gprs);
+  fpr.StoreBinding(bound_fprs, dirty_fprs);
+  JustWriteExit(destination, false, 0);
+
+  if (mode == FLUSH_ALL)
+  {
+    gpr.Discard(bound_gprs);
+    fpr.Discard(bound_fprs);
+  }
+}
+
 void Jit64::JustWriteExit(u32 destination, bool bl, u32 after)
 {
   // If nobody has taken care of this yet (this can be removed when all branches are done)
@@ -421,6 +629,8 @@ void Jit64::WriteExitDestInRSCRATCH(bool bl, u32 after)
 
   if (bl)
   {
+    if (Profiler::g_ProfileBlocks)
+      WriteProfileCount(&m_return_stack_stats.calls, RSCRATCH2);
     MOV(32, R(RSCRATCH2), Imm32(after));
     PUSH(RSCRATCH2);
   }
@@ -440,6 +650,8 @@ void Jit64::WriteExitDestInRSCRATCH(bool bl, u32 after)
 
 void Jit64::WriteBLRExit()
 {
+  if (Profiler::g_ProfileBlocks)
+    WriteProfileCount(&m_return_stack_stats.returns, RSCRATCH2);
   if (!m_enable_blr_optimization)
   {
     WriteExitDestInRSCRATCH();
@@ -452,6 +664,9 @@ void Jit64::WriteBLRExit()
   MOV(32, R(RSCRATCH2), Imm32(js.downcountAmount));
   CMP(64, R(RSCRATCH), MDisp(RSP, 8));
   J_CC(CC_NE, asm_routines.dispatcherMispredictedBLR);
+  // The caller's code after the CALL relies on the flags of the SUB.
+  if (Profiler::g_ProfileBlocks)
+    WriteProfileCount(&m_return_stack_stats.predicted_returns, RSCRATCH);
   SUB(32, PPCSTATE(downcount), R(RSCRATCH2));
   RET();
 }
@@ -468,6 +683,45 @@ void Jit64::WriteRfiExitDestInRSCRATCH()
   JMP(asm_routines.dispatcher, true);
 }
 
+bool Jit64::WriteIdleLoopExit(u32 branch_address, FlushMode mode)
+{
+  const PPCAnalyst::IdleLoopType type = m_idle_loop.type;
+  if (m_idle_loop.branch_address != branch_address ||
+      (type != PPCAnalyst::IdleLoopType::Poll && type != PPCAnalyst::IdleLoopType::Delay))
+  {
+    return false;
+  }
+
+  gpr.Flush(mode);
+  fpr.Flush(mode);
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  // Loads through registers only make the loop idle if they read RAM.
+  std::vector<FixupBranch> not_ram;
+  for (const PPCAnalyst::IdleLoopLoad& load : m_idle_loop.loads)
+  {
+    MOV(32, R(ABI_PARAM1), Imm32(load.offset));
+    if (load.base >= 0)
+      ADD(32, R(ABI_PARAM1), PPCSTATE(gpr[load.base]));
+    if (load.index >= 0)
+      ADD(32, R(ABI_PARAM1), PPCSTATE(gpr[load.index]));
+    ABI_CallFunction(PowerPC::HostIsRAMAddress);
+    TEST(8, R(ABI_RETURN), R(ABI_RETURN));
+    not_ram.push_back(J_CC(CC_Z, true));
+  }
+  if (Profiler::g_ProfileBlocks)
+    WriteProfileCount(m_idle_loops.GetSkipCounter(), RSCRATCH);
+  if (type == PPCAnalyst::IdleLoopType::Poll)
+    ABI_CallFunction(CoreTiming::Idle);
+  else
+    ABI_CallFunctionC(JitIdleLoops::SkipDelayLoop, js.downcountAmount);
+  for (FixupBranch branch : not_ram)
+    SetJumpTarget(branch);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+  WriteExceptionExit();
+  return true;
+}
+
 void Jit64::WriteExceptionExit()
 {
   Cleanup();
@@ -540,11 +794,26 @@ void Jit64::Jit(u32 em_address)
 #endif
   }
 
-  if (IsAlmostFull() || farcode.IsAlmostFull() || trampolines.IsAlmostFull() || blocks.IsFull() ||
-      SConfig::GetInstance().bJITNoBlockCache)
+  if (trampolines.IsAlmostFull() || SConfig::GetInstance().bJITNoBlockCache)
   {
     ClearCache();
   }
+  else if (m_code_regions.IsAlmostFull(GetCodePtr(), farcode.GetCodePtr()))
+  {
+    // Only the code executed least recently gets recompiled.
+    const int code_region = m_code_regions.GetOldestRegion();
+    EvictCodeRegion(code_region);
+    m_code_regions.SwitchToRegion(code_region);
+    SetCodePtr(m_code_regions.GetRegion(code_region).near_start);
+    farcode.SetCodePtr(m_code_regions.GetRegion(code_region).far_start);
+  }
+
+  if (blocks.IsFull())
+  {
+    EvictCodeRegion(m_code_regions.GetOldestRegion());
+    if (blocks.IsFull())
+      ClearCache();
+  }
 
   int blockSize = code_buffer.GetSize();
 
@@ -572,6 +841,9 @@ void Jit64::Jit(u32 em_address)
     }
   }
 
+  if (m_traces.IsEnabled())
+    analyzer.SetFollowedBranches(m_traces.GetFollowedBranches(em_address));
+
   // Analyze the block, collect all instructions it is made of (including inlining,
   // if that is enabled), reorder instructions for optimal performance, and join joinable
   // instructions.
@@ -592,6 +864,22 @@ void Jit64::Jit(u32 em_address)
   blocks.FinalizeBlock(block_num, jo.enableBlocklink, DoJit(em_address, &code_buffer, b, nextPC));
 }
 
+void Jit64::OnHotBlock(Jit64* jit64, u32 address)
+{
+  jit64->m_traces.FinishProfiling(address);
+  // Recompile the block, either as a trace or at least without the profiling code.
+  jit64->GetBlockCache()->InvalidateICache(address, 4, true);
+}
+
+bool Jit64::ExecuteColdBlock(u32 em_address, u32 msr_bits)
+{
+  if (!m_tiering.ShouldInterpret(em_address, msr_bits))
+    return false;
+
+  JitTiering::RunBlockInInterpreter();
+  return true;
+}
+
 const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC)
 {
   js.firstFPInstructionFound = false;
@@ -599,6 +887,9 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   js.blockStart = em_address;
   js.fifoBytesSinceCheck = 0;
   js.mustCheckFifo = false;
+  // With batching, the gather pipe is only sent to the FIFO every few bursts and on block exits.
+  const int fifo_check_bytes =
+      jo.batchGatherPipe ? GPFifo::GATHER_PIPE_BATCH_SIZE : GPFifo::GATHER_PIPE_SIZE;
   js.curBlock = b;
   js.numLoadStoreInst = 0;
   js.numFloatingPointInst = 0;
@@ -628,16 +919,23 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
     ABI_PopRegistersAndAdjustStack({}, 0);
   }
 
-  // Conditionally add profiling code.
-  if (Profiler::g_ProfileBlocks)
+  // Blocks which are profiled for traces get recompiled once they are hot.
+  m_profile_branches = m_traces.ShouldProfile(em_address);
+  if (m_profile_branches)
   {
     MOV(64, R(RSCRATCH), Imm64((u64)&b->runCount));
     ADD(32, MatR(RSCRATCH), Imm8(1));
-    b->ticCounter = 0;
-    b->ticStart = 0;
-    b->ticStop = 0;
-    // get start tic
-    PROFILER_QUERY_PERFORMANCE_COUNTER(&b->ticStart);
+    CMP(32, MatR(RSCRATCH), Imm32(JitTraces::HOT_BLOCK_THRESHOLD));
+    FixupBranch hot = J_CC(CC_AE, true);
+
+    SwitchToFarCode();
+    SetJumpTarget(hot);
+    MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+    ABI_PushRegistersAndAdjustStack({}, 0);
+    ABI_CallFunctionPC(OnHotBlock, this, js.blockStart);
+    ABI_PopRegistersAndAdjustStack({}, 0);
+    JMP(asm_routines.dispatcherNoCheck, true);
+    SwitchToNearCode();
   }
 #if defined(_DEBUG) || defined(DEBUGFAST) || defined(NAN_CHECK)
   // should help logged stack-traces become more accurate
@@ -690,12 +988,61 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
     }
   }
 
+  // The checks above read ppcState, so registers can't be passed to blocks
+  // which have them.
+  bool has_entry_checks = !js.constantGqr.empty();
   if (js.noSpeculativeConstantsAddresses.find(js.blockStart) ==
       js.noSpeculativeConstantsAddresses.end())
   {
-    IntializeSpeculativeConstants();
+    has_entry_checks |= IntializeSpeculativeConstants();
+  }
+
+  // Linked blocks may enter after the registers they pass in host registers
+  // would have been loaded.
+  u64 entry_dirty = 0;
+  const u64 binding =
+      has_entry_checks || m_profile_branches ? 0 : ChooseEntryBinding(&entry_dirty);
+  gpr.LoadBinding(BitSet32(static_cast<u32>(binding)), BitSet32(static_cast<u32>(entry_dirty)));
+  fpr.LoadBinding(BitSet32(static_cast<u32>(binding >> 32)),
+                  BitSet32(static_cast<u32>(entry_dirty >> 32)));
+  b->entryBinding = binding;
+  b->entryDirty = entry_dirty;
+  b->boundEntry = binding ? GetCodePtr() : nullptr;
+  if (binding)
+    m_binding_stats.bound_blocks++;
+
+  const bool is_trace =
+      std::any_of(ops, ops + code_block.m_num_instructions,
+                  [](const PPCAnalyst::CodeOp& op) { return op.followTaken; });
+  if (is_trace)
+  {
+    MOV(64, R(RSCRATCH), ImmPtr(m_traces.GetTraceEntriesCounter()));
+    ADD(64, MatR(RSCRATCH), Imm8(1));
+  }
+
+  // Conditionally add profiling code.
+  if (Profiler::g_ProfileBlocks)
+  {
+    // Blocks profiled for traces already count their runs.
+    if (!m_profile_branches)
+    {
+      MOV(64, R(RSCRATCH), Imm64((u64)&b->runCount));
+      ADD(32, MatR(RSCRATCH), Imm8(1));
+    }
+    b->ticCounter = 0;
+    b->ticStart = 0;
+    b->ticStop = 0;
+    // get start tic
+    PROFILER_VPUSH;
+    PROFILER_QUERY_PERFORMANCE_COUNTER(&b->ticStart);
+    PROFILER_VPOP;
   }
 
+  // Single stepping has to run every iteration.
+  m_idle_loop = CPU::GetState() != CPU::CPU_STEPPING ?
+                    m_idle_loops.Analyze(code_block, *code_buf) :
+                    PPCAnalyst::IdleLoop();
+
   // Translate instructions
   for (u32 i = 0; i < code_block.m_num_instructions; i++)
   {
@@ -730,7 +1077,7 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
         js.fifoWriteAddresses.find(ops[i].address) != js.fifoWriteAddresses.end();
 
     // Gather pipe writes using an immediate address are explicitly tracked.
-    if (jo.optimizeGatherPipe && (js.fifoBytesSinceCheck >= 32 || js.mustCheckFifo))
+    if (jo.optimizeGatherPipe && (js.fifoBytesSinceCheck >= fifo_check_bytes || js.mustCheckFifo))
     {
       js.fifoBytesSinceCheck = 0;
       js.mustCheckFifo = false;
@@ -781,10 +1128,15 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
           HLEFunction(function);
           if (type == HLE::HLE_HOOK_REPLACE)
           {
+            // The original code runs after all if the function left NPC alone.
             MOV(32, R(RSCRATCH), PPCSTATE(npc));
+            CMP(32, R(RSCRATCH), Imm32(ops[i].address));
+            FixupBranch original = J_CC(CC_E, true);
+            const int downcount = js.downcountAmount;
             js.downcountAmount += js.st.numCycles;
             WriteExitDestInRSCRATCH();
-            break;
+            js.downcountAmount = downcount;
+            SetJumpTarget(original);
           }
         }
       }
@@ -924,15 +1276,26 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   }
 
   if (code_block.m_broken)
-  {
-    gpr.Flush();
-    fpr.Flush();
-    WriteExit(nextPC);
-  }
+    FlushAndWriteExit(nextPC, FLUSH_ALL);
 
   b->codeSize = (u32)(GetCodePtr() - start);
   b->originalSize = code_block.m_num_instructions;
 
+  // A trace isn't contiguous in memory; tell the block cache which ranges it covers.
+  if (is_trace)
+  {
+    for (u32 i = 0; i < code_block.m_num_instructions; i++)
+    {
+      const u32 physical_address = PowerPC::JitCache_TranslateAddress(ops[i].address).address;
+      auto& ranges = b->physicalRanges;
+      if (!ranges.empty() && ranges.back().first + ranges.back().second == physical_address)
+        ranges.back().second += 4;
+      else
+        ranges.emplace_back(physical_address, 4);
+    }
+    m_traces.AddTrace(code_block.m_num_instructions);
+  }
+
 #ifdef JIT_LOG_X86
   LogGeneratedX86(code_block.m_num_instructions, code_buf, start, b);
 #endif
@@ -973,7 +1336,7 @@ void Jit64::EnableOptimization()
   analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CARRY_MERGE);
 }
 
-void Jit64::IntializeSpeculativeConstants()
+bool Jit64::IntializeSpeculativeConstants()
 {
   // If the block depends on an input register which looks like a gather pipe or MMIO related
   // constant, guess that it is actually a constant input, and specialize the block based on this
@@ -1007,4 +1370,46 @@ void Jit64::IntializeSpeculativeConstants()
       gpr.SetImmediate32(i, compileTimeValue, false);
     }
   }
+  return target != nullptr;
+}
+
+u64 Jit64::ChooseEntryBinding(u64* dirty)
+{
+  *dirty = 0;
+  if (!jo.enableBlocklink)
+    return 0;
+
+  // Take the inputs of the block which it reads most often.
+  std::array<int, 32> gpr_reads{};
+  std::array<int, 32> fpr_reads{};
+  for (u32 i = 0; i < code_block.m_num_instructions; i++)
+  {
+    for (int reg : code_buffer.codebuffer[i].regsIn)
+      gpr_reads[reg]++;
+    for (int reg : code_buffer.codebuffer[i].fregsIn)
+      fpr_reads[reg]++;
+  }
+
+  auto choose = [](BitSet32 inputs, const std::array<int, 32>& reads, size_t max_count) {
+    std::vector<int> candidates;
+    for (int reg : inputs)
+      candidates.push_back(reg);
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&reads](int a, int b) { return reads[a] > reads[b]; });
+    candidates.resize(std::min(candidates.size(), max_count));
+    BitSet32 chosen;
+    for (int reg : candidates)
+      chosen[reg] = true;
+    return chosen;
+  };
+  const BitSet32 gprs = choose(code_block.m_gpr_inputs, gpr_reads, MAX_BOUND_GPRS);
+  const BitSet32 fprs = choose(code_block.m_fpr_inputs, fpr_reads, MAX_BOUND_FPRS);
+
+  // Linked blocks can pass the registers which the block overwrites before it can exit without
+  // storing them, as their values never need to reach ppcState. The others are taken clean.
+  const BitSet32 dirty_gprs = gprs & code_block.m_gpr_overwritten;
+  const BitSet32 dirty_fprs = fprs & code_block.m_fpr_overwritten;
+  *dirty = static_cast<u64>(dirty_fprs.m_val) << 32 | dirty_gprs.m_val;
+
+  return static_cast<u64>(fprs.m_val) << 32 | gprs.m_val;
 }
@@ -25,6 +25,10 @@
 #include "Core/PowerPC/Jit64/JitRegCache.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitCodeRegions.h"
+#include "Core/PowerPC/JitCommon/JitIdleLoops.h"
+#include "Core/PowerPC/JitCommon/JitTiering.h"
+#include "Core/PowerPC/JitCommon/JitTraces.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 
 class Jit64 : public Jitx86Base
@@ -32,6 +36,7 @@ class Jit64 : public Jitx86Base
 private:
   void AllocStack();
   void FreeStack();
+  void UseHugePagesForCode();
 
   GPRRegCache gpr;
   FPURegCache fpr;
@@ -45,6 +50,53 @@ private:
   bool m_cleanup_after_stackfault;
   u8* m_stack;
 
+  JitTiering m_tiering;
+  JitTraces m_traces;
+  JitCodeRegions m_code_regions;
+  JitIdleLoops m_idle_loops;
+  // Whether the block being compiled counts its runs and taken branches.
+  bool m_profile_branches = false;
+  // The loop of the block being compiled, if it can be skipped.
+  PPCAnalyst::IdleLoop m_idle_loop;
+
+  static void OnHotBlock(Jit64* jit64, u32 address);
+
+  // Destroys the blocks in a code region and poisons its code.
+  void EvictCodeRegion(int code_region);
+
+  // Upper bounds on how many registers a block takes in host registers from
+  // linked blocks. They're the first ones of the allocation order, which are
+  // callee-saved for GPRs.
+  static constexpr int MAX_BOUND_GPRS = 4;
+  static constexpr int MAX_BOUND_FPRS = 2;
+
+  struct BindingStats
+  {
+    u64 bound_blocks = 0;
+    u64 bound_exits = 0;
+    // Per pass through the exits.
+    u64 passed_registers = 0;
+    u64 passed_dirty_registers = 0;
+    // Dirty registers the destination takes as clean, which are stored first.
+    u64 stored_registers = 0;
+  };
+  BindingStats m_binding_stats;
+
+  // Counted by the generated code while profiling blocks.
+  struct ReturnStackStats
+  {
+    // bl, bcl and bctrl, which push their return address.
+    u64 calls = 0;
+    u64 returns = 0;
+    // Returns which went straight back to the caller instead of the dispatcher.
+    u64 predicted_returns = 0;
+  };
+  ReturnStackStats m_return_stack_stats;
+  void WriteProfileCount(u64* counter, Gen::X64Reg scratch);
+
+  u64 ChooseEntryBinding(u64* dirty);
+  u64 GetEntryBinding(u32 destination, u64* dirty);
+
 public:
   Jit64() : code_buffer(32000) {}
   ~Jit64() {}
@@ -60,22 +112,31 @@ public:
 
   bool HandleStackFault() override;
 
+  bool CanTrapMemChecks() const override { return true; }
+
   // Jit!
 
   void Jit(u32 em_address) override;
+  bool ExecuteColdBlock(u32 em_address, u32 msr_bits) override;
   const u8* DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC);
 
   BitSet32 CallerSavedRegistersInUse() const;
   BitSet8 ComputeStaticGQRs(const PPCAnalyst::CodeBlock&) const;
 
-  void IntializeSpeculativeConstants();
+  // Returns true if any checks were emitted.
+  bool IntializeSpeculativeConstants();
 
   JitBlockCache* GetBlockCache() override { return &blocks; }
   void Trace();
 
   void ClearCache() override;
+  // Notes which code region is executing.
+  void OnTimesliceEnded() override;
+
+  void GetProfileCounters(std::vector<std::pair<std::string, u64>>* counters) const override;
 
   const CommonAsmRoutines* GetAsmRoutines() override { return &asm_routines; }
+  HostCode GetHostCodeType(const u8* ptr) override;
   const char* GetName() override { return "JIT64"; }
   // Run!
   void Run() override;
@@ -84,6 +145,14 @@ public:
   // Utilities for use by opcodes
 
   void WriteExit(u32 destination, bool bl = false, u32 after = 0);
+  // Flushes the register caches and exits to destination. If the block there
+  // takes registers from linked blocks, they're passed in host registers
+  // instead of going through ppcState.
+  void FlushAndWriteExit(u32 destination, FlushMode mode);
+  // If the branch at branch_address closes an idle loop, flushes the register
+  // caches, skips ahead and exits to the start of the loop. Returns false if
+  // the branch has to be compiled normally.
+  bool WriteIdleLoopExit(u32 branch_address, FlushMode mode);
   void JustWriteExit(u32 destination, bool bl, u32 after);
   void WriteExitDestInRSCRATCH(bool bl = false, u32 after = 0);
   void WriteBLRExit();
@@ -104,9 +173,13 @@ public:
   Gen::OpArg ExtractFromReg(int reg, int offset);
   void AndWithMask(Gen::X64Reg reg, u32 mask);
   bool CheckMergedBranch(int crf);
-  void DoMergedBranch();
+  void DoMergedBranch(FlushMode mode);
   void DoMergedBranchCondition();
   void DoMergedBranchImmediate(s64 val);
+  // Counts a taken conditional branch while profiling a block for traces.
+  void WriteTakenBranchProfile(u32 branch_address);
+  // Leaves a trace on the cold side of a followed branch.
+  void WriteTraceSideExit(u32 destination);
 
   // Reads a given bit of a given CR register part.
   void GetCRFieldBit(int field, int bit, Gen::X64Reg out, bool negate = false);
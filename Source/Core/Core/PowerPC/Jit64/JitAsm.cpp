@@ -51,6 +51,7 @@ void Jit64AsmRoutineManager::Generate()
   const u8* outerLoop = GetCodePtr();
   ABI_PushRegistersAndAdjustStack({}, 0);
   ABI_CallFunction(CoreTiming::Advance);
+  ABI_CallFunction(JitBase::TimesliceEnded);
   ABI_PopRegistersAndAdjustStack({}, 0);
   FixupBranch skipToRealDispatch =
       J(SConfig::GetInstance().bEnableDebugging);  // skip the sync and compare first time
@@ -156,6 +157,13 @@ void Jit64AsmRoutineManager::Generate()
   ABI_PushRegistersAndAdjustStack({}, 0);
   ABI_CallFunction(JitBase::Dispatch);
   ABI_PopRegistersAndAdjustStack({}, 0);
+  // A null result means the block was run by tier 0 and used up some of the
+  // downcount, so go through the full dispatcher again.
+  TEST(64, R(ABI_RETURN), R(ABI_RETURN));
+  FixupBranch compiled = J_CC(CC_NZ);
+  CMP(32, PPCSTATE(downcount), Imm8(0));
+  JMP(dispatcher, true);
+  SetJumpTarget(compiled);
   //  JMPptr(R(ABI_RETURN));
   JMP(dispatcherNoCheck, true);
 
@@ -6,6 +6,7 @@
 #include <cinttypes>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include "Common/Assert.h"
 #include "Common/BitSet.h"
@@ -351,6 +352,105 @@ void RegCache::StoreFromRegister(size_t i, FlushMode mode)
   }
 }
 
+X64Reg RegCache::GetBindingXReg(BitSet32 binding, size_t preg)
+{
+  size_t count;
+  const X64Reg* order = GetAllocationOrder(&count);
+  const size_t index = (binding & BitSet32((1u << preg) - 1)).Count();
+  _assert_msg_(DYNA_REC, index < count, "Register binding too large");
+  return order[index];
+}
+
+void RegCache::LoadBinding(BitSet32 binding, BitSet32 dirty)
+{
+  for (int preg : binding)
+  {
+    _assert_msg_(DYNA_REC, !regs[preg].away, "Bound register %i already cached", preg);
+    X64Reg xr = GetBindingXReg(binding, preg);
+    LoadRegister(preg, xr);
+    xregs[xr].free = false;
+    xregs[xr].ppcReg = preg;
+    xregs[xr].dirty = dirty[preg];
+    regs[preg].away = true;
+    regs[preg].location = ::Gen::R(xr);
+  }
+}
+
+void RegCache::MoveToBinding(BitSet32 binding)
+{
+  struct Move
+  {
+    X64Reg dst;
+    OpArg src;
+  };
+  std::vector<Move> pending;
+  for (int preg : binding)
+  {
+    X64Reg xr = GetBindingXReg(binding, preg);
+    if (!regs[preg].location.IsSimpleReg(xr))
+      pending.push_back({xr, regs[preg].location});
+  }
+
+  // This is a parallel move: a host register can only be overwritten once
+  // nothing else still needs to be moved out of it.
+  while (!pending.empty())
+  {
+    auto ready = std::find_if(pending.begin(), pending.end(), [&pending](const Move& move) {
+      return std::none_of(pending.begin(), pending.end(),
+                          [&move](const Move& other) { return other.src.IsSimpleReg(move.dst); });
+    });
+    if (ready == pending.end())
+    {
+      // Only cycles are left; break one up through the scratch register.
+      X64Reg scratch = GetScratchX();
+      MoveToX(scratch, pending.front().src);
+      pending.front().src = ::Gen::R(scratch);
+      continue;
+    }
+    MoveToX(ready->dst, ready->src);
+    pending.erase(ready);
+  }
+}
+
+void RegCache::StoreBinding(BitSet32 binding, BitSet32 regs_to_store)
+{
+  for (int preg : GetDirtyRegs(regs_to_store))
+    MoveFromX(GetDefaultLocation(preg), GetBindingXReg(binding, preg));
+}
+
+BitSet32 RegCache::GetDirtyRegs(BitSet32 regs_to_check) const
+{
+  BitSet32 result;
+  for (int preg : regs_to_check)
+  {
+    const PPCCachedReg& reg = regs[preg];
+    if (reg.away && (!reg.location.IsSimpleReg() || xregs[reg.location.GetSimpleReg()].dirty))
+      result[preg] = true;
+  }
+  return result;
+}
+
+BitSet32 RegCache::GetBoundRegs(BitSet32 regs_to_check) const
+{
+  BitSet32 result;
+  for (int preg : regs_to_check)
+  {
+    if (IsBound(preg))
+      result[preg] = true;
+  }
+  return result;
+}
+
+void RegCache::Discard(BitSet32 regs_to_discard)
+{
+  for (int preg : regs_to_discard)
+  {
+    DiscardRegContentsIfCached(preg);
+    regs[preg].away = false;
+    regs[preg].location = GetDefaultLocation(preg);
+  }
+}
+
 void GPRRegCache::LoadRegister(size_t preg, X64Reg newLoc)
 {
   emit->MOV(32, ::Gen::R(newLoc), regs[preg].location);
@@ -361,6 +461,21 @@ void GPRRegCache::StoreRegister(size_t preg, const OpArg& newLoc)
   emit->MOV(32, newLoc, regs[preg].location);
 }
 
+void GPRRegCache::MoveToX(X64Reg dst, const OpArg& src)
+{
+  emit->MOV(32, ::Gen::R(dst), src);
+}
+
+void GPRRegCache::MoveFromX(const OpArg& dst, X64Reg src)
+{
+  emit->MOV(32, dst, ::Gen::R(src));
+}
+
+X64Reg GPRRegCache::GetScratchX() const
+{
+  return RSCRATCH;
+}
+
 void FPURegCache::LoadRegister(size_t preg, X64Reg newLoc)
 {
   emit->MOVAPD(newLoc, regs[preg].location);
@@ -371,6 +486,21 @@ void FPURegCache::StoreRegister(size_t preg, const OpArg& newLoc)
   emit->MOVAPD(newLoc, regs[preg].location.GetSimpleReg());
 }
 
+void FPURegCache::MoveToX(X64Reg dst, const OpArg& src)
+{
+  emit->MOVAPD(dst, src);
+}
+
+void FPURegCache::MoveFromX(const OpArg& dst, X64Reg src)
+{
+  emit->MOVAPD(dst, src);
+}
+
+X64Reg FPURegCache::GetScratchX() const
+{
+  return XMM0;
+}
+
 void RegCache::Flush(FlushMode mode, BitSet32 regsToFlush)
 {
   for (size_t i = 0; i < xregs.size(); i++)
@@ -47,6 +47,12 @@ protected:
   virtual BitSet32 GetRegUtilization() = 0;
   virtual BitSet32 CountRegsIn(size_t preg, u32 lookahead) = 0;
 
+  // Raw moves used when passing registers between blocks.
+  virtual void MoveToX(Gen::X64Reg dst, const Gen::OpArg& src) = 0;
+  virtual void MoveFromX(const Gen::OpArg& dst, Gen::X64Reg src) = 0;
+  // A register outside of the allocation order which can be clobbered at exits.
+  virtual Gen::X64Reg GetScratchX() const = 0;
+
   Gen::XEmitter* emit;
 
   float ScoreRegister(Gen::X64Reg xreg);
@@ -79,6 +85,28 @@ public:
   }
 
   void Flush(FlushMode mode = FLUSH_ALL, BitSet32 regsToFlush = BitSet32::AllTrue(32));
+
+  // Register bindings pass guest registers between linked blocks in host
+  // registers. The n-th lowest guest register of a binding lives in the n-th
+  // host register of the allocation order.
+  Gen::X64Reg GetBindingXReg(BitSet32 binding, size_t preg);
+  // Emits code to load the registers of a binding from ppcState at a block
+  // entry. Those in dirty are marked dirty, as linked blocks don't store them.
+  void LoadBinding(BitSet32 binding, BitSet32 dirty);
+  // Emits code to move the registers of a binding into their host registers
+  // at an exit, without changing the state of the cache. All other registers
+  // must have been flushed already.
+  void MoveToBinding(BitSet32 binding);
+  // Emits code storing the dirty registers of regs_to_store, out of a binding
+  // moved by MoveToBinding, back to ppcState.
+  void StoreBinding(BitSet32 binding, BitSet32 regs_to_store);
+  // Returns the registers of regs which aren't in sync with ppcState.
+  BitSet32 GetDirtyRegs(BitSet32 regs) const;
+  // Returns the registers of regs which are in host registers.
+  BitSet32 GetBoundRegs(BitSet32 regs) const;
+  // Forgets about the given registers without storing them, e.g. after they
+  // were passed to another block.
+  void Discard(BitSet32 regs);
   void Flush(PPCAnalyst::CodeOp* op) { Flush(); }
   int SanityCheck() const;
   void KillImmediate(size_t preg, bool doLoad, bool makeDirty);
@@ -159,6 +187,9 @@ class GPRRegCache final : public RegCache
 public:
   void StoreRegister(size_t preg, const Gen::OpArg& newLoc) override;
   void LoadRegister(size_t preg, Gen::X64Reg newLoc) override;
+  void MoveToX(Gen::X64Reg dst, const Gen::OpArg& src) override;
+  void MoveFromX(const Gen::OpArg& dst, Gen::X64Reg src) override;
+  Gen::X64Reg GetScratchX() const override;
   Gen::OpArg GetDefaultLocation(size_t reg) const override;
   const Gen::X64Reg* GetAllocationOrder(size_t* count) override;
   void SetImmediate32(size_t preg, u32 immValue, bool dirty = true);
@@ -171,6 +202,9 @@ class FPURegCache final : public RegCache
 public:
   void StoreRegister(size_t preg, const Gen::OpArg& newLoc) override;
   void LoadRegister(size_t preg, Gen::X64Reg newLoc) override;
+  void MoveToX(Gen::X64Reg dst, const Gen::OpArg& src) override;
+  void MoveFromX(const Gen::OpArg& dst, Gen::X64Reg src) override;
+  Gen::X64Reg GetScratchX() const override;
   const Gen::X64Reg* GetAllocationOrder(size_t* count) override;
   Gen::OpArg GetDefaultLocation(size_t reg) const override;
   BitSet32 GetRegUtilization() override;
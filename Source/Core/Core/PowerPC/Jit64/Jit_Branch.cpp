@@ -76,9 +76,6 @@ void Jit64::bx(UGeckoInstruction inst)
     return;
   }
 
-  gpr.Flush();
-  fpr.Flush();
-
   u32 destination;
   if (inst.AA)
     destination = SignExt26(inst.LI << 2);
@@ -90,6 +87,8 @@ void Jit64::bx(UGeckoInstruction inst)
 #endif
   if (destination == js.compilerPC)
   {
+    gpr.Flush();
+    fpr.Flush();
     ABI_PushRegistersAndAdjustStack({}, 0);
     ABI_CallFunction(CoreTiming::Idle);
     ABI_PopRegistersAndAdjustStack({}, 0);
@@ -97,7 +96,17 @@ void Jit64::bx(UGeckoInstruction inst)
     WriteExceptionExit();
     return;
   }
-  WriteExit(destination, inst.LK, js.compilerPC + 4);
+
+  if (inst.LK)
+  {
+    gpr.Flush();
+    fpr.Flush();
+    WriteExit(destination, true, js.compilerPC + 4);
+  }
+  else if (!WriteIdleLoopExit(js.compilerPC, FLUSH_ALL))
+  {
+    FlushAndWriteExit(destination, FLUSH_ALL);
+  }
 }
 
 // TODO - optimize to hell and beyond
@@ -127,6 +136,19 @@ void Jit64::bcx(UGeckoInstruction inst)
         JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !(inst.BO_2 & BO_BRANCH_IF_TRUE));
   }
 
+  // In a trace, the taken side continues inline.
+  if (js.op->followTaken)
+  {
+    SwitchToFarCode();
+    if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
+      SetJumpTarget(pConditionDontBranch);
+    if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
+      SetJumpTarget(pCTRDontBranch);
+    WriteTraceSideExit(js.compilerPC + 4);
+    SwitchToNearCode();
+    return;
+  }
+
   if (inst.LK)
     MOV(32, PPCSTATE_LR, Imm32(js.compilerPC + 4));
 
@@ -136,9 +158,22 @@ void Jit64::bcx(UGeckoInstruction inst)
   else
     destination = js.compilerPC + SignExt16(inst.BD << 2);
 
-  gpr.Flush(FLUSH_MAINTAIN_STATE);
-  fpr.Flush(FLUSH_MAINTAIN_STATE);
-  WriteExit(destination, inst.LK, js.compilerPC + 4);
+  if (m_profile_branches &&
+      ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0 || (inst.BO & BO_DONT_CHECK_CONDITION) == 0))
+  {
+    WriteTakenBranchProfile(js.compilerPC);
+  }
+
+  if (inst.LK)
+  {
+    gpr.Flush(FLUSH_MAINTAIN_STATE);
+    fpr.Flush(FLUSH_MAINTAIN_STATE);
+    WriteExit(destination, true, js.compilerPC + 4);
+  }
+  else if (!WriteIdleLoopExit(js.compilerPC, FLUSH_MAINTAIN_STATE))
+  {
+    FlushAndWriteExit(destination, FLUSH_MAINTAIN_STATE);
+  }
 
   if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
     SetJumpTarget(pConditionDontBranch);
@@ -261,3 +296,16 @@ void Jit64::bclrx(UGeckoInstruction inst)
     WriteExit(js.compilerPC + 4);
   }
 }
+
+void Jit64::WriteTakenBranchProfile(u32 branch_address)
+{
+  MOV(64, R(RSCRATCH), ImmPtr(m_traces.GetTakenCounter(js.blockStart, branch_address)));
+  ADD(32, MatR(RSCRATCH), Imm8(1));
+}
+
+void Jit64::WriteTraceSideExit(u32 destination)
+{
+  MOV(64, R(RSCRATCH), ImmPtr(m_traces.GetSideExitCounter()));
+  ADD(64, MatR(RSCRATCH), Imm8(1));
+  FlushAndWriteExit(destination, FLUSH_MAINTAIN_STATE);
+}
@@ -245,6 +245,13 @@ void Jit64::fmaddXX(UGeckoInstruction inst)
       inst.OPCD == 4 || (!cpu_info.bAtom && single && jit->js.op->fprIsDuplicated[a] &&
                          jit->js.op->fprIsDuplicated[b] && jit->js.op->fprIsDuplicated[c]);
 
+  // If both factors are singles, a*c is exact in double precision, so a fused multiply-add rounds
+  // exactly like a multiply followed by an add. This doesn't hold for nmadd/nmsub, which negate
+  // the sum before rounding it instead of after (that matters for directed rounding).
+  bool exact_product = single && jit->js.op->fprIsSingle[a] && jit->js.op->fprIsSingle[c] &&
+                       inst.SUBOP5 != 30 && inst.SUBOP5 != 31;
+  bool use_fma = cpu_info.bFMA && (!Core::g_want_determinism || exact_product);
+
   fpr.Lock(a, b, c, d);
 
   switch (inst.SUBOP5)
@@ -260,7 +267,7 @@ void Jit64::fmaddXX(UGeckoInstruction inst)
       Force25BitPrecision(XMM1, R(XMM1), XMM0);
     break;
   default:
-    bool special = inst.SUBOP5 == 30 && (!cpu_info.bFMA || Core::g_want_determinism);
+    bool special = inst.SUBOP5 == 30 && !use_fma;
     X64Reg tmp1 = special ? XMM0 : XMM1;
     X64Reg tmp2 = special ? XMM1 : XMM0;
     if (single && round_input)
@@ -275,11 +282,13 @@ void Jit64::fmaddXX(UGeckoInstruction inst)
   // be extra careful and don't use FMA, even if in theory it might be okay.
   // Note that FMA isn't necessarily less correct (it may actually be closer to correct) compared
   // to what the Gekko does here; in deterministic mode, the important thing is multiple Dolphin
-  // instances on different computers giving identical results.
-  if (cpu_info.bFMA && !Core::g_want_determinism)
+  // instances on different computers giving identical results. The exception is an exact product,
+  // where both give the same result.
+  if (use_fma)
   {
     // Statistics suggests b is a lot less likely to be unbound in practice, so
     // if we have to pick one of a or b to bind, let's make it b.
+    // The 132 forms also pick the same NaN operand as the multiply and add below.
     fpr.BindToRegister(b, true, false);
     switch (inst.SUBOP5)
     {
@@ -319,16 +328,15 @@ void Jit64::fmaddXX(UGeckoInstruction inst)
   {
     // We implement nmsub a little differently ((b - a*c) instead of -(a*c - b)), so handle it
     // separately.
-    MOVAPD(XMM1, fpr.R(b));
     if (packed)
     {
       MULPD(XMM0, fpr.R(a));
-      SUBPD(XMM1, R(XMM0));
+      avx_op(&XEmitter::VSUBPD, &XEmitter::SUBPD, XMM1, fpr.R(b), R(XMM0));
     }
     else
     {
       MULSD(XMM0, fpr.R(a));
-      SUBSD(XMM1, R(XMM0));
+      avx_op(&XEmitter::VSUBSD, &XEmitter::SUBSD, XMM1, fpr.R(b), R(XMM0), false);
     }
   }
   else
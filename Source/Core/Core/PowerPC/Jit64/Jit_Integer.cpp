@@ -352,24 +352,39 @@ bool Jit64::CheckMergedBranch(int crf)
           (next.BI >> 2) == crf);
 }
 
-void Jit64::DoMergedBranch()
+void Jit64::DoMergedBranch(FlushMode mode)
 {
   // Code that handles successful PPC branching.
   const UGeckoInstruction& next = js.op[1].inst;
   const u32 nextPC = js.op[1].address;
   if (next.OPCD == 16)  // bcx
   {
-    if (next.LK)
-      MOV(32, M(&LR), Imm32(nextPC + 4));
+    if (m_profile_branches)
+      WriteTakenBranchProfile(nextPC);
 
     u32 destination;
     if (next.AA)
       destination = SignExt16(next.BD << 2);
     else
       destination = nextPC + SignExt16(next.BD << 2);
-    WriteExit(destination, next.LK, nextPC + 4);
+
+    if (next.LK)
+    {
+      gpr.Flush(mode);
+      fpr.Flush(mode);
+      MOV(32, M(&LR), Imm32(nextPC + 4));
+      WriteExit(destination, true, nextPC + 4);
+    }
+    else if (!WriteIdleLoopExit(nextPC, mode))
+    {
+      FlushAndWriteExit(destination, mode);
+    }
+    return;
   }
-  else if ((next.OPCD == 19) && (next.SUBOP10 == 528))  // bcctrx
+
+  gpr.Flush(mode);
+  fpr.Flush(mode);
+  if ((next.OPCD == 19) && (next.SUBOP10 == 528))  // bcctrx
   {
     if (next.LK)
       MOV(32, M(&LR), Imm32(nextPC + 4));
@@ -413,10 +428,17 @@ void Jit64::DoMergedBranchCondition()
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     pDontBranch = J(true);
 
-  gpr.Flush(FLUSH_MAINTAIN_STATE);
-  fpr.Flush(FLUSH_MAINTAIN_STATE);
+  // In a trace, the taken side continues inline.
+  if (js.op[1].followTaken)
+  {
+    SwitchToFarCode();
+    SetJumpTarget(pDontBranch);
+    WriteTraceSideExit(nextPC + 4);
+    SwitchToNearCode();
+    return;
+  }
 
-  DoMergedBranch();
+  DoMergedBranch(FLUSH_MAINTAIN_STATE);
 
   SetJumpTarget(pDontBranch);
 
@@ -449,11 +471,19 @@ void Jit64::DoMergedBranchImmediate(s64 val)
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     branch = false;
 
-  if (branch)
+  if (js.op[1].followTaken)
   {
-    gpr.Flush();
-    fpr.Flush();
-    DoMergedBranch();
+    // In a trace, the taken side continues inline.
+    if (!branch)
+    {
+      gpr.Flush();
+      fpr.Flush();
+      WriteTraceSideExit(nextPC + 4);
+    }
+  }
+  else if (branch)
+  {
+    DoMergedBranch(FLUSH_ALL);
   }
   else if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE))
   {
@@ -181,18 +181,24 @@ void Jit64::lXXx(UGeckoInstruction inst)
   }
   else
   {
-    if ((inst.OPCD != 31) && gpr.R(a).IsImm() && !jo.memcheck)
+    // With memory checks on, the load can raise an exception, so the update has to wait until
+    // after it.
+    if ((inst.OPCD != 31) && gpr.R(a).IsImm())
     {
       u32 val = gpr.R(a).Imm32() + inst.SIMM_16;
       opAddress = Imm32(val);
-      if (update)
+      if (update && jo.memcheck)
+        storeAddress = true;
+      else if (update)
         gpr.SetImmediate32(a, val);
     }
-    else if ((inst.OPCD == 31) && gpr.R(a).IsImm() && gpr.R(b).IsImm() && !jo.memcheck)
+    else if ((inst.OPCD == 31) && gpr.R(a).IsImm() && gpr.R(b).IsImm())
     {
       u32 val = gpr.R(a).Imm32() + gpr.R(b).Imm32();
       opAddress = Imm32(val);
-      if (update)
+      if (update && jo.memcheck)
+        storeAddress = true;
+      else if (update)
         gpr.SetImmediate32(a, val);
     }
     else
@@ -204,8 +210,10 @@ void Jit64::lXXx(UGeckoInstruction inst)
       if (use_constant_offset)
         offset = inst.OPCD == 31 ? gpr.R(b).SImm32() : (s32)inst.SIMM_16;
       // Depending on whether we have an immediate and/or update, find the optimum way to calculate
-      // the load address.
-      if ((update || use_constant_offset) && !jo.memcheck)
+      // the load address. With memory checks on, a is only used directly when the load can't
+      // change it.
+      if ((update && !jo.memcheck) ||
+          (use_constant_offset && !update && (!jo.memcheck || a != d)))
       {
         gpr.BindToRegister(a, true, update);
         opAddress = gpr.R(a);
@@ -249,7 +257,7 @@ void Jit64::lXXx(UGeckoInstruction inst)
 
   BitSet32 registersInUse = CallerSavedRegistersInUse();
   // We need to save the (usually scratch) address register for the update.
-  if (update && storeAddress)
+  if (update && storeAddress && !opAddress.IsImm())
     registersInUse[RSCRATCH2] = true;
 
   SafeLoadToReg(gpr.RX(d), opAddress, accessSize, loadOffset, registersInUse, signExtend);
@@ -457,7 +457,9 @@ void QuantizedMemoryRoutines::GenQuantizedLoad(bool single, EQuantizeType type,
 
   bool extend = single && (type == QUANTIZE_S8 || type == QUANTIZE_S16);
 
-  if (jit->jo.memcheck)
+  // The routines generated AOT outlive changes to the memory options, and a memory check added
+  // later leaves the chunk around it unmapped, so they have to check the address.
+  if (jit->jo.memcheck || !isInline)
   {
     BitSet32 regsToSave = QUANTIZED_REGS_TO_SAVE_LOAD;
     int flags =
@@ -580,8 +582,10 @@ void QuantizedMemoryRoutines::GenQuantizedLoadFloat(bool single, bool isInline)
 {
   int size = single ? 32 : 64;
   bool extend = false;
+  // See GenQuantizedLoad.
+  bool safe_load = jit->jo.memcheck || !isInline;
 
-  if (jit->jo.memcheck)
+  if (safe_load)
   {
     BitSet32 regsToSave = QUANTIZED_REGS_TO_SAVE;
     int flags =
@@ -591,7 +595,7 @@ void QuantizedMemoryRoutines::GenQuantizedLoadFloat(bool single, bool isInline)
 
   if (single)
   {
-    if (jit->jo.memcheck)
+    if (safe_load)
     {
       MOVD_xmm(XMM0, R(RSCRATCH_EXTRA));
     }
@@ -616,7 +620,7 @@ void QuantizedMemoryRoutines::GenQuantizedLoadFloat(bool single, bool isInline)
     // for a good reason, or merely because no game does this.
     // If we find something that actually does do this, maybe this should be changed. How
     // much of a performance hit would it be?
-    if (jit->jo.memcheck)
+    if (safe_load)
     {
       ROL(64, R(RSCRATCH_EXTRA), Imm8(32));
       MOVQ_xmm(XMM0, R(RSCRATCH_EXTRA));
@@ -605,13 +605,22 @@ const u8* JitIL::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
         int flags = HLE::GetFunctionFlagsByIndex(function);
         if (HLE::IsEnabled(flags))
         {
-          HLEFunction(function);
           if (type == HLE::HLE_HOOK_REPLACE)
           {
+            // The original code runs after all if the function left NPC alone.
+            ABI_CallFunctionCC(HLE::Execute, ops[i].address, function);
             MOV(32, R(EAX), PPCSTATE(npc));
+            CMP(32, R(EAX), Imm32(ops[i].address));
+            FixupBranch original = J_CC(CC_E, true);
+            const int downcount = jit->js.downcountAmount;
             jit->js.downcountAmount += jit->js.st.numCycles;
             WriteExitDestInOpArg(R(EAX));
-            break;
+            jit->js.downcountAmount = downcount;
+            SetJumpTarget(original);
+          }
+          else
+          {
+            HLEFunction(function);
           }
         }
       }
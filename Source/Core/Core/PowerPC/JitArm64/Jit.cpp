@@ -43,6 +43,7 @@ void JitArm64::Init()
   AddChildCodeSpace(&farcode, child_code_size);
   jo.enableBlocklink = true;
   jo.optimizeGatherPipe = true;
+  jo.batchGatherPipe = SConfig::GetInstance().bBatchGatherPipe;
   UpdateMemoryOptions();
   gpr.Init(this);
   fpr.Init(this);
@@ -418,6 +419,9 @@ const u8* JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitB
   js.blockStart = em_address;
   js.fifoBytesSinceCheck = 0;
   js.mustCheckFifo = false;
+  // With batching, the gather pipe is only sent to the FIFO every few bursts and on block exits.
+  const int fifo_check_bytes =
+      jo.batchGatherPipe ? GPFifo::GATHER_PIPE_BATCH_SIZE : GPFifo::GATHER_PIPE_SIZE;
   js.downcountAmount = 0;
   js.skipInstructions = 0;
   js.curBlock = b;
@@ -505,7 +509,7 @@ const u8* JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitB
     bool gatherPipeIntCheck =
         jit->js.fifoWriteAddresses.find(ops[i].address) != jit->js.fifoWriteAddresses.end();
 
-    if (jo.optimizeGatherPipe && (js.fifoBytesSinceCheck >= 32 || js.mustCheckFifo))
+    if (jo.optimizeGatherPipe && (js.fifoBytesSinceCheck >= fifo_check_bytes || js.mustCheckFifo))
     {
       js.fifoBytesSinceCheck = 0;
       js.mustCheckFifo = false;
@@ -15,6 +15,7 @@
 #include "Common/x64Emitter.h"
 #include "Core/HW/Memmap.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/PowerPC.h"
 
 using namespace Gen;
 
@@ -29,7 +30,14 @@ bool Jitx86Base::HandleFault(uintptr_t access_address, SContext* ctx)
     return BackPatch((u32)(access_address - (uintptr_t)Memory::physical_base), ctx);
   if (access_address >= (uintptr_t)Memory::logical_base &&
       access_address < (uintptr_t)Memory::logical_base + 0x100010000)
-    return BackPatch((u32)(access_address - (uintptr_t)Memory::logical_base), ctx);
+  {
+    u32 em_address = (u32)(access_address - (uintptr_t)Memory::logical_base);
+    // Pages translated through the page table get mapped on their first access. Retry the
+    // access once they are, instead of patching it to the slow path for good.
+    if (IsInSpace((u8*)ctx->CTX_PC) && PowerPC::HandleLogicalPageFault(em_address))
+      return true;
+    return BackPatch(em_address, ctx);
+  }
 
   return false;
 }
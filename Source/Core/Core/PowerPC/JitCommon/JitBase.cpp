@@ -87,7 +87,8 @@ bool JitBase::MergeAllowedNextInstructions(int count)
 void JitBase::UpdateMemoryOptions()
 {
   bool any_watchpoints = PowerPC::memchecks.HasAny();
-  jo.fastmem = SConfig::GetInstance().bFastmem && !any_watchpoints;
+  bool trap_watchpoints = any_watchpoints && CanTrapMemChecks() && SConfig::GetInstance().bFastmem;
+  jo.fastmem = SConfig::GetInstance().bFastmem && (!any_watchpoints || trap_watchpoints);
   jo.memcheck = SConfig::GetInstance().bMMU || any_watchpoints;
-  jo.alwaysUseMemFuncs = any_watchpoints;
+  jo.alwaysUseMemFuncs = any_watchpoints && !trap_watchpoints;
 }
@@ -9,7 +9,10 @@
 //#define JIT_LOG_FPR     // Enables logging of the PPC floating point regs
 
 #include <map>
+#include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/x64Emitter.h"
@@ -66,6 +69,7 @@ protected:
   {
     bool enableBlocklink;
     bool optimizeGatherPipe;
+    bool batchGatherPipe;
     bool accurateSinglePrecision;
     bool fastmem;
     bool memcheck;
@@ -125,6 +129,10 @@ protected:
   bool MergeAllowedNextInstructions(int count);
 
   void UpdateMemoryOptions();
+  // Whether fastmem accesses to watched memory can fault into the memory functions, so that
+  // memory checks don't have to turn fastmem off. Watched memory is left out of the logical
+  // view, but untranslated accesses still have to use the memory functions.
+  virtual bool CanTrapMemChecks() const { return false; }
 
 public:
   // This should probably be removed from public:
@@ -132,12 +140,35 @@ public:
   JitState js;
 
   static const u8* Dispatch() { return jit->GetBlockCache()->Dispatch(); };
+  static void TimesliceEnded() { jit->OnTimesliceEnded(); }
+  void SetAnalysisCache(PPCAnalyst::AnalysisCache* cache) { analyzer.SetCache(cache); }
   virtual JitBaseBlockCache* GetBlockCache() = 0;
 
   virtual void Jit(u32 em_address) = 0;
 
+  // Gives the JIT a chance to execute a block which isn't in the block cache
+  // without compiling it. Returns true if the block was executed.
+  virtual bool ExecuteColdBlock(u32 em_address, u32 msr_bits) { return false; }
+  // Called by the dispatcher whenever a timeslice has ended, with PC being
+  // the next block to run.
+  virtual void OnTimesliceEnded() {}
+  // Appends JIT specific event counters to the profiling results.
+  virtual void GetProfileCounters(std::vector<std::pair<std::string, u64>>* counters) const {}
+
   virtual const CommonAsmRoutinesBase* GetAsmRoutines() = 0;
 
+  enum class HostCode
+  {
+    None,
+    Blocks,
+    Routines,
+    FarCode,
+  };
+  // Tells which of the JIT's code the host code at ptr is part of. The
+  // sampling profiler calls this from a signal handler, so it must not
+  // allocate or lock.
+  virtual HostCode GetHostCodeType(const u8* ptr) { return HostCode::None; }
+
   virtual bool HandleFault(uintptr_t access_address, SContext* ctx) = 0;
   virtual bool HandleStackFault() { return false; }
 };
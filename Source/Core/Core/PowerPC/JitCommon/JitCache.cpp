@@ -9,9 +9,10 @@
 // performance hit, it's not enabled by default, but it's useful for
 // locating performance issues.
 
+#include <algorithm>
 #include <cstring>
-#include <map>
 #include <utility>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/JitRegister.h"
@@ -30,14 +31,64 @@ using namespace Gen;
 
 static CoreTiming::EventType* s_clear_jit_cache_thread_safe;
 
+static_assert(BlockStartMap::NUM_SLOTS >= 2 * JitBaseBlockCache::MAX_NUM_BLOCKS,
+              "The block start map must not fill up");
+static_assert(BlockStartMap::NUM_SLOTS == 1 << (32 - 14), "The hash must cover all slots");
+
+BlockStartMap::BlockStartMap() : m_slots(new Slot[NUM_SLOTS])
+{
+  Clear();
+}
+
+void BlockStartMap::Insert(u32 address, int block_num)
+{
+  u32 i = Hash(address);
+  while (m_slots[i].address != address && m_slots[i].address != EMPTY)
+    i = (i + 1) & SLOT_MASK;
+  m_slots[i] = {address, block_num};
+}
+
+void BlockStartMap::Erase(u32 address)
+{
+  u32 i = Hash(address);
+  while (m_slots[i].address != address)
+  {
+    if (m_slots[i].address == EMPTY)
+      return;
+    i = (i + 1) & SLOT_MASK;
+  }
+
+  // Move later entries of the probe sequence into the hole, so that lookups don't have to skip
+  // over deleted slots.
+  for (u32 j = (i + 1) & SLOT_MASK; m_slots[j].address != EMPTY; j = (j + 1) & SLOT_MASK)
+  {
+    // Entries which hash into the hole or before it can fill it.
+    const u32 home = Hash(m_slots[j].address);
+    if (((j - home) & SLOT_MASK) >= ((j - i) & SLOT_MASK))
+    {
+      m_slots[i] = m_slots[j];
+      i = j;
+    }
+  }
+  m_slots[i].address = EMPTY;
+}
+
+void BlockStartMap::Clear()
+{
+  std::fill(m_slots.get(), m_slots.get() + NUM_SLOTS, Slot{EMPTY, 0});
+}
+
 static void ClearCacheThreadSafe(u64 userdata, s64 cyclesdata)
 {
+  // This is scheduled when memory checks change. The logical memory view
+  // leaves out watched pages, so rebuild it along with the code.
+  PowerPC::DBATUpdated();
   JitInterface::ClearCache();
 }
 
 bool JitBaseBlockCache::IsFull() const
 {
-  return GetNumBlocks() >= MAX_NUM_BLOCKS - 1;
+  return GetNumBlocks() >= MAX_NUM_BLOCKS - 1 && free_blocks.empty();
 }
 
 void JitBaseBlockCache::Init()
@@ -47,6 +98,7 @@ void JitBaseBlockCache::Init()
 
   iCache.fill(0);
   Clear();
+  EnableHostCodeLookup(SConfig::GetInstance().bSamplingProfiler);
 }
 
 void JitBaseBlockCache::Shutdown()
@@ -73,10 +125,13 @@ void JitBaseBlockCache::Clear()
     DestroyBlock(i, false);
   }
   links_to.clear();
-  block_map.clear();
+  block_range_map.clear();
+  start_block_map.Clear();
+  host_code_map.clear();
 
   valid_block.ClearAll();
 
+  free_blocks.clear();
   num_blocks = 1;
   blocks[0].msrBits = 0xFFFFFFFF;
   blocks[0].invalid = true;
@@ -105,46 +160,68 @@ int JitBaseBlockCache::GetNumBlocks() const
 
 int JitBaseBlockCache::AllocateBlock(u32 em_address)
 {
-  JitBlock& b = blocks[num_blocks];
+  int block_num = num_blocks;
+  if (num_blocks >= MAX_NUM_BLOCKS - 1 && !free_blocks.empty())
+  {
+    block_num = free_blocks.back();
+    free_blocks.pop_back();
+  }
+  else
+  {
+    num_blocks++;  // commit the current block
+  }
+
+  JitBlock& b = blocks[block_num];
   b.invalid = false;
   b.effectiveAddress = em_address;
   b.physicalAddress = PowerPC::JitCache_TranslateAddress(em_address).address;
   b.msrBits = MSR & JitBlock::JIT_CACHE_MSR_MASK;
+  b.boundEntry = nullptr;
+  b.entryBinding = 0;
+  b.entryDirty = 0;
+  b.avoidedLoads = 0;
+  b.avoidedStores = 0;
   b.linkData.clear();
-  num_blocks++;  // commit the current block
-  return num_blocks - 1;
+  b.physicalRanges.clear();
+  return block_num;
 }
 
 void JitBaseBlockCache::FinalizeBlock(int block_num, bool block_link, const u8* code_ptr)
 {
   JitBlock& b = blocks[block_num];
-  if (start_block_map.count(b.physicalAddress))
+  const int old_block_num = start_block_map.Find(b.physicalAddress);
+  if (old_block_num != -1)
   {
     // We already have a block at this address; invalidate the old block.
     // This should be very rare. This will only happen if the same block
     // is called both with DR/IR enabled or disabled.
     WARN_LOG(DYNA_REC, "Invalidating compiled block at same address %08x", b.physicalAddress);
-    int old_block_num = start_block_map[b.physicalAddress];
-    const JitBlock& old_b = blocks[old_block_num];
-    block_map.erase(
-        std::make_pair(old_b.physicalAddress + 4 * old_b.originalSize - 1, old_b.physicalAddress));
     DestroyBlock(old_block_num, true);
   }
-  start_block_map[b.physicalAddress] = block_num;
+  start_block_map.Insert(b.physicalAddress, block_num);
   FastLookupEntryForAddress(b.effectiveAddress) = block_num;
 
-  u32 pAddr = b.physicalAddress;
+  // JITs which don't form traces leave the range to us.
+  if (b.physicalRanges.empty())
+    b.physicalRanges.emplace_back(b.physicalAddress, 4 * b.originalSize);
 
-  for (u32 block = pAddr / 32; block <= (pAddr + (b.originalSize - 1) * 4) / 32; ++block)
-    valid_block.Set(block);
+  for (const auto& range : b.physicalRanges)
+  {
+    for (u32 block = range.first / 32; block <= (range.first + range.second - 1) / 32; ++block)
+      valid_block.Set(block);
+  }
 
-  block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
+  AddBlockToRangeMap(block_num);
+  if (host_code_lookup)
+    host_code_map[b.checkedEntry] = block_num;
 
   if (block_link)
   {
     for (const auto& e : b.linkData)
     {
-      links_to.emplace(e.exitAddress, block_num);
+      std::vector<int>& sources = links_to[e.exitAddress];
+      if (std::find(sources.begin(), sources.end(), block_num) == sources.end())
+        sources.push_back(block_num);
     }
 
     LinkBlock(block_num);
@@ -153,6 +230,47 @@ void JitBaseBlockCache::FinalizeBlock(int block_num, bool block_link, const u8*
   JitRegister::Register(b.checkedEntry, b.codeSize, "JIT_PPC_%08x", b.physicalAddress);
 }
 
+void JitBaseBlockCache::AddBlockToRangeMap(int block_num)
+{
+  for (const auto& range : blocks[block_num].physicalRanges)
+  {
+    u32 start = range.first & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    u32 end = (range.first + range.second - 1) & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    for (u64 addr = start; addr <= end; addr += BLOCK_RANGE_MAP_ELEMENTS)
+    {
+      std::vector<int>& numbers = block_range_map[static_cast<u32>(addr)];
+      if (std::find(numbers.begin(), numbers.end(), block_num) == numbers.end())
+        numbers.push_back(block_num);
+    }
+  }
+}
+
+void JitBaseBlockCache::RemoveBlockFromRangeMap(int block_num)
+{
+  for (const auto& range : blocks[block_num].physicalRanges)
+  {
+    u32 start = range.first & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    u32 end = (range.first + range.second - 1) & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    for (u64 addr = start; addr <= end; addr += BLOCK_RANGE_MAP_ELEMENTS)
+    {
+      auto it = block_range_map.find(static_cast<u32>(addr));
+      if (it == block_range_map.end())
+        continue;
+
+      // The order within a macro block doesn't matter, so swap and pop.
+      std::vector<int>& numbers = it->second;
+      auto entry = std::find(numbers.begin(), numbers.end(), block_num);
+      if (entry != numbers.end())
+      {
+        *entry = numbers.back();
+        numbers.pop_back();
+      }
+      if (numbers.empty())
+        block_range_map.erase(it);
+    }
+  }
+}
+
 int JitBaseBlockCache::GetBlockNumberFromStartAddress(u32 addr, u32 msr)
 {
   u32 translated_addr = addr;
@@ -166,10 +284,9 @@ int JitBaseBlockCache::GetBlockNumberFromStartAddress(u32 addr, u32 msr)
     translated_addr = translated.address;
   }
 
-  auto map_result = start_block_map.find(translated_addr);
-  if (map_result == start_block_map.end())
+  const int block_num = start_block_map.Find(translated_addr);
+  if (block_num == -1)
     return -1;
-  int block_num = map_result->second;
   const JitBlock& b = blocks[block_num];
   if (b.invalid)
     return -1;
@@ -180,11 +297,33 @@ int JitBaseBlockCache::GetBlockNumberFromStartAddress(u32 addr, u32 msr)
   return block_num;
 }
 
-void JitBaseBlockCache::MoveBlockIntoFastCache(u32 addr, u32 msr)
+int JitBaseBlockCache::GetBlockNumberFromHostAddress(const u8* ptr) const
+{
+  auto it = host_code_map.upper_bound(ptr);
+  if (it == host_code_map.begin())
+    return -1;
+  --it;
+
+  const JitBlock& b = blocks[it->second];
+  if (ptr >= b.checkedEntry + b.codeSize)
+    return -1;
+  return it->second;
+}
+
+void JitBaseBlockCache::EnableHostCodeLookup(bool enable)
+{
+  host_code_lookup = enable;
+  if (!enable)
+    host_code_map.clear();
+}
+
+bool JitBaseBlockCache::MoveBlockIntoFastCache(u32 addr, u32 msr)
 {
   int block_num = GetBlockNumberFromStartAddress(addr, msr);
   if (block_num < 0)
   {
+    if (jit->ExecuteColdBlock(addr, msr))
+      return false;
     Jit(addr);
   }
   else
@@ -192,6 +331,7 @@ void JitBaseBlockCache::MoveBlockIntoFastCache(u32 addr, u32 msr)
     FastLookupEntryForAddress(addr) = block_num;
     LinkBlock(block_num);
   }
+  return true;
 }
 
 const u8* JitBaseBlockCache::Dispatch()
@@ -201,7 +341,10 @@ const u8* JitBaseBlockCache::Dispatch()
   while (blocks[block_num].effectiveAddress != PC ||
          blocks[block_num].msrBits != (MSR & JitBlock::JIT_CACHE_MSR_MASK))
   {
-    MoveBlockIntoFastCache(PC, MSR & JitBlock::JIT_CACHE_MSR_MASK);
+    // The JIT may have run the code itself instead of compiling it. Return
+    // to the dispatcher, which rechecks the downcount before going on.
+    if (!MoveBlockIntoFastCache(PC, MSR & JitBlock::JIT_CACHE_MSR_MASK))
+      return nullptr;
     block_num = FastLookupEntryForAddress(PC);
   }
 
@@ -243,24 +386,28 @@ void JitBaseBlockCache::LinkBlock(int i)
 {
   LinkBlockExits(i);
   const JitBlock& b = blocks[i];
-  auto ppp = links_to.equal_range(b.effectiveAddress);
+  auto sources = links_to.find(b.effectiveAddress);
+  if (sources == links_to.end())
+    return;
 
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  for (int source : sources->second)
   {
-    const JitBlock& b2 = blocks[iter->second];
+    const JitBlock& b2 = blocks[source];
     if (b.msrBits == b2.msrBits)
-      LinkBlockExits(iter->second);
+      LinkBlockExits(source);
   }
 }
 
 void JitBaseBlockCache::UnlinkBlock(int i)
 {
   JitBlock& b = blocks[i];
-  auto ppp = links_to.equal_range(b.effectiveAddress);
+  auto sources = links_to.find(b.effectiveAddress);
+  if (sources == links_to.end())
+    return;
 
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  for (int source : sources->second)
   {
-    JitBlock& sourceBlock = blocks[iter->second];
+    JitBlock& sourceBlock = blocks[source];
     if (sourceBlock.msrBits != b.msrBits)
       continue;
 
@@ -290,23 +437,58 @@ void JitBaseBlockCache::DestroyBlock(int block_num, bool invalidate)
     return;
   }
   b.invalid = true;
-  start_block_map.erase(b.physicalAddress);
+  start_block_map.Erase(b.physicalAddress);
   FastLookupEntryForAddress(b.effectiveAddress) = 0;
+  RemoveBlockFromRangeMap(block_num);
+  if (host_code_lookup)
+  {
+    auto host_code = host_code_map.find(b.checkedEntry);
+    if (host_code != host_code_map.end() && host_code->second == block_num)
+      host_code_map.erase(host_code);
+  }
 
   UnlinkBlock(block_num);
 
-  // Delete linking addresses
-  auto it = links_to.equal_range(b.effectiveAddress);
-  while (it.first != it.second)
+  // Delete linking addresses. The exits are unlinked as well: blr can still
+  // return into the code after a bl of this block, and it must not jump on to
+  // a block which might be gone by then.
+  for (auto& e : b.linkData)
   {
-    if (it.first->second == block_num)
-      it.first = links_to.erase(it.first);
-    else
-      it.first++;
+    if (e.linkStatus)
+    {
+      WriteLinkBlock(e, nullptr);
+      e.linkStatus = false;
+    }
+
+    auto sources = links_to.find(e.exitAddress);
+    if (sources == links_to.end())
+      continue;
+
+    std::vector<int>& numbers = sources->second;
+    numbers.erase(std::remove(numbers.begin(), numbers.end(), block_num), numbers.end());
+    if (numbers.empty())
+      links_to.erase(sources);
   }
 
   // Raise an signal if we are going to call this block again
   WriteDestroyBlock(b);
+
+  free_blocks.push_back(block_num);
+}
+
+int JitBaseBlockCache::DestroyBlocksInCodeRange(const u8* start, const u8* end)
+{
+  int destroyed = 0;
+  for (int i = 1; i < num_blocks; i++)
+  {
+    const JitBlock& b = blocks[i];
+    if (!b.invalid && b.normalEntry >= start && b.normalEntry < end)
+    {
+      DestroyBlock(i, true);
+      destroyed++;
+    }
+  }
+  return destroyed;
 }
 
 void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool forced)
@@ -327,16 +509,46 @@ void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool for
   }
 
   // destroy JIT blocks
-  // !! this works correctly under assumption that any two overlapping blocks end at the same
-  // address
-  if (destroy_block)
+  if (destroy_block && length != 0)
   {
-    auto it = block_map.lower_bound(std::make_pair(pAddr, 0));
-    while (it != block_map.end() && it->first.second < pAddr + length)
+    // Collect every block overlapping the range first, as destroying a block
+    // modifies the macro blocks we are iterating over.
+    std::vector<int> overlapping;
+    const u32 start = pAddr & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    const u64 end = (static_cast<u64>(pAddr) + length - 1) & ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
+    const u64 num_macro_blocks = (end - start) / BLOCK_RANGE_MAP_ELEMENTS + 1;
+    auto collect = [&](const std::vector<int>& numbers) {
+      for (int block_num : numbers)
+      {
+        if (blocks[block_num].OverlapsPhysicalRange(pAddr, length))
+          overlapping.push_back(block_num);
+      }
+    };
+
+    if (num_macro_blocks <= block_range_map.size())
     {
-      DestroyBlock(it->second, true);
-      it = block_map.erase(it);
+      for (u64 addr = start; addr <= end; addr += BLOCK_RANGE_MAP_ELEMENTS)
+      {
+        auto it = block_range_map.find(static_cast<u32>(addr));
+        if (it != block_range_map.end())
+          collect(it->second);
+      }
     }
+    else
+    {
+      // Huge ranges (e.g. a full invalidation) touch fewer entries by walking the map itself.
+      for (const auto& entry : block_range_map)
+      {
+        if (entry.first >= start && entry.first <= end)
+          collect(entry.second);
+      }
+    }
+
+    // Blocks spanning several macro blocks were collected more than once.
+    std::sort(overlapping.begin(), overlapping.end());
+    overlapping.erase(std::unique(overlapping.begin(), overlapping.end()), overlapping.end());
+    for (int block_num : overlapping)
+      DestroyBlock(block_num, true);
 
     // If the code was actually modified, we need to clear the relevant entries from the
     // FIFO write address cache, so we don't end up with FIFO checks in places they shouldn't
@@ -353,10 +565,25 @@ void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool for
   }
 }
 
+const u8* JitBaseBlockCache::GetLinkTarget(const JitBlock::LinkData& source,
+                                           const JitBlock* dest, const u8* dispatcher)
+{
+  // Exits passing registers can only enter a block expecting the same binding,
+  // with the same registers dirty. Everything else goes through the fallback,
+  // which stores the registers.
+  if (source.binding)
+  {
+    const bool matches =
+        dest && dest->entryBinding == source.binding && dest->entryDirty == source.dirty;
+    return matches ? dest->boundEntry : source.bindingFallback;
+  }
+  return dest ? dest->checkedEntry : dispatcher;
+}
+
 void JitBlockCache::WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest)
 {
   u8* location = source.exitPtrs;
-  const u8* address = dest ? dest->checkedEntry : jit->GetAsmRoutines()->dispatcher;
+  const u8* address = GetLinkTarget(source, dest, jit->GetAsmRoutines()->dispatcher);
   XEmitter emit(location);
   if (*location == 0xE8)
   {
@@ -8,6 +8,8 @@
 #include <bitset>
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -33,6 +35,15 @@ struct JitBlock
   const u8* checkedEntry;
   // The normal entry point for the block, returned by Dispatch().
   const u8* normalEntry;
+  // Entry point for linked blocks which pass the registers in entryBinding
+  // in host registers instead of ppcState; nullptr if entryBinding is 0.
+  const u8* boundEntry;
+  // Backend specific description of the registers this block expects at
+  // boundEntry. 0 means the block has no such entry point.
+  u64 entryBinding;
+  // The registers of entryBinding which the block takes as they are. The
+  // others must have been stored to ppcState by the linked block.
+  u64 entryDirty;
 
   // The effective address (PC) for the beginning of the block.
   u32 effectiveAddress;
@@ -40,7 +51,7 @@ struct JitBlock
   u32 msrBits;
   // The physical address of the code represented by this block.
   // Various maps in the cache are indexed by this (start_block_map,
-  // block_map, and valid_block in particular). This is useful because of
+  // block_range_map, and valid_block in particular). This is useful because of
   // of the way the instruction cache works on PowerPC.
   u32 physicalAddress;
   // The number of bytes of JIT'ed code contained in this block. Mostly
@@ -50,6 +61,31 @@ struct JitBlock
   // useful for logging.
   u32 originalSize;
   int runCount;  // for profiling.
+  // Register loads and stores skipped by taking bound exits out of this
+  // block; only counted while profiling. A store counts as skipped when the
+  // destination overwrites the register before it can exit.
+  u64 avoidedLoads;
+  u64 avoidedStores;
+
+  // The physical ranges of PPC code this block was compiled from, as
+  // (start, size in bytes). Usually this is the single range starting at
+  // physicalAddress, but traces continue at branch targets elsewhere.
+  std::vector<std::pair<u32, u32>> physicalRanges;
+
+  // Returns true if the PPC code of this block overlaps the physical range
+  // [address, address + length).
+  bool OverlapsPhysicalRange(u32 address, u32 length) const
+  {
+    for (const auto& range : physicalRanges)
+    {
+      if (static_cast<u64>(range.first) < static_cast<u64>(address) + length &&
+          static_cast<u64>(range.first) + range.second > address)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
 
   // Whether this struct refers to a valid block. This is mostly useful as
   // a debugging aid.
@@ -63,6 +99,11 @@ struct JitBlock
     u8* exitPtrs;  // to be able to rewrite the exit jump
     u32 exitAddress;
     bool linkStatus;  // is it already linked?
+    // For exits which pass registers to the next block, the binding they
+    // were compiled for, and where to go if the destination doesn't match it.
+    u64 binding = 0;
+    u64 dirty = 0;
+    const u8* bindingFallback = nullptr;
   };
   std::vector<LinkData> linkData;
 
@@ -105,6 +146,48 @@ public:
   bool Test(u32 bit) { return (m_valid_block[bit / 32] & (1u << (bit % 32))) != 0; }
 };
 
+// Open-addressing hash table from the physical start address of a block to its number, with linear
+// probing. Blocks start on word boundaries, so an address with the low bits set marks empty slots.
+class BlockStartMap
+{
+public:
+  // Twice as many as there can be blocks, so that probe sequences stay short.
+  static constexpr u32 NUM_SLOTS = 0x40000;
+
+  BlockStartMap();
+
+  // Returns -1 if no block starts at address.
+  int Find(u32 address) const
+  {
+    for (u32 i = Hash(address);; i = (i + 1) & SLOT_MASK)
+    {
+      if (m_slots[i].address == address)
+        return m_slots[i].block_num;
+      if (m_slots[i].address == EMPTY)
+        return -1;
+    }
+  }
+
+  // Replaces the block starting at address, if there is one.
+  void Insert(u32 address, int block_num);
+  void Erase(u32 address);
+  void Clear();
+
+private:
+  static constexpr u32 SLOT_MASK = NUM_SLOTS - 1;
+  static constexpr u32 EMPTY = 0xFFFFFFFF;
+
+  struct Slot
+  {
+    u32 address;
+    int block_num;
+  };
+
+  static u32 Hash(u32 address) { return ((address >> 2) * 0x9E3779B1) >> 14; }
+
+  std::unique_ptr<Slot[]> m_slots;
+};
+
 class JitBaseBlockCache
 {
 public:
@@ -117,19 +200,31 @@ private:
   // Note: blocks[0] must not be used as it is referenced as invalid block in iCache.
   std::array<JitBlock, MAX_NUM_BLOCKS> blocks;  // number -> JitBlock
   int num_blocks;
+  // Numbers of destroyed blocks. They're only handed out again once the end
+  // of the array is reached, so a block which got destroyed while running
+  // doesn't immediately share its profiling data with a new one.
+  std::vector<int> free_blocks;
 
   // links_to hold all exit points of all valid blocks in a reverse way.
   // It is used to query all blocks which links to an address.
-  std::multimap<u32, int> links_to;  // destination_PC -> number
+  std::unordered_map<u32, std::vector<int>> links_to;  // destination_PC -> numbers
 
-  // Map indexed by the physical memory location.
-  // It is used to invalidate blocks based on memory location.
-  std::map<std::pair<u32, u32>, u32> block_map;  // (end_addr, start_addr) -> number
+  // Range of overlapping code indexed by a masked physical address.
+  // This is used for invalidation of memory regions. The range is grouped
+  // in macro blocks of BLOCK_RANGE_MAP_ELEMENTS bytes, so an invalidation only
+  // has to look at the few blocks sharing its macro blocks.
+  static constexpr u32 BLOCK_RANGE_MAP_ELEMENTS = 0x100;
+  std::unordered_map<u32, std::vector<int>> block_range_map;  // masked_addr -> numbers
 
   // Map indexed by the physical address of the entry point.
   // This is used to query the block based on the current PC in a slow way.
-  // TODO: This is redundant with block_map, and both should be a multimap.
-  std::map<u32, u32> start_block_map;  // start_addr -> number
+  BlockStartMap start_block_map;  // start_addr -> number
+
+  // Map indexed by the host code of the block, to find the block some host
+  // code belongs to. Only kept up to date while host_code_lookup is set, as
+  // only the sampling profiler needs it.
+  std::map<const u8*, int> host_code_map;  // checkedEntry -> number
+  bool host_code_lookup = false;
 
   // This bitsets shows which cachelines overlap with any blocks.
   // It is used to provide a fast way to query if no icache invalidation is needed.
@@ -145,7 +240,11 @@ private:
 
   void DestroyBlock(int block_num, bool invalidate);
 
-  void MoveBlockIntoFastCache(u32 em_address, u32 msr);
+  void AddBlockToRangeMap(int block_num);
+  void RemoveBlockFromRangeMap(int block_num);
+
+  // Returns false if the JIT executed the block instead of providing one.
+  bool MoveBlockIntoFastCache(u32 em_address, u32 msr);
 
   // Fast but risky block lookup based on iCache.
   int& FastLookupEntryForAddress(u32 address) { return iCache[(address >> 2) & iCache_Mask]; }
@@ -166,6 +265,10 @@ public:
 
   bool IsFull() const;
 
+  // Destroys every block whose code starts in [start, end), so the code
+  // space there can be reused. Returns the number of destroyed blocks.
+  int DestroyBlocksInCodeRange(const u8* start, const u8* end);
+
   // Code Cache
   JitBlock* GetBlock(int block_num);
   JitBlock* GetBlocks() { return blocks.data(); }
@@ -176,15 +279,27 @@ public:
   // This function shall be used if FastLookupEntryForAddress() failed.
   int GetBlockNumberFromStartAddress(u32 em_address, u32 msr);
 
+  // Returns the block whose code contains ptr, or -1. This doesn't allocate,
+  // so the sampling profiler can use it while the CPU thread runs JIT code.
+  // Blocks are only found when they were finalized with the lookup enabled.
+  int GetBlockNumberFromHostAddress(const u8* ptr) const;
+  void EnableHostCodeLookup(bool enable);
+
   // Get the normal entry for the block associated with the current program
   // counter. This will JIT code if necessary. (This is the reference
   // implementation; high-performance JITs will want to use a custom
-  // assembly version.)
+  // assembly version.) Returns nullptr if the JIT chose to run the code at the
+  // current PC without compiling it; the caller has to dispatch again.
   const u8* Dispatch();
 
   void InvalidateICache(u32 address, const u32 length, bool forced);
 
   u32* GetBlockBitSet() const { return valid_block.m_valid_block.get(); }
+
+  // Where the exit should jump once it's linked to dest, or unlinked if dest
+  // is nullptr.
+  static const u8* GetLinkTarget(const JitBlock::LinkData& source, const JitBlock* dest,
+                                 const u8* dispatcher);
 };
 
 // x86 BlockCache
@@ -0,0 +1,96 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitCodeRegions.h"
+
+#include "Common/CommonTypes.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/SystemTimers.h"
+
+void JitCodeRegions::Init(u8* near_code, size_t near_size, u8* far_code, size_t far_size)
+{
+  const size_t near_region_size = near_size / NUM_REGIONS;
+  const size_t far_region_size = far_size / NUM_REGIONS;
+  for (int i = 0; i < NUM_REGIONS; i++)
+  {
+    Region& region = m_regions[i];
+    region.near_start = near_code + near_region_size * i;
+    region.near_end = region.near_start + near_region_size;
+    region.far_start = far_code + far_region_size * i;
+    region.far_end = region.far_start + far_region_size;
+  }
+
+  m_stats = Stats();
+  m_stats_since = static_cast<s64>(CoreTiming::GetTicks());
+  Clear();
+  // Starting up isn't worth counting.
+  m_stats.clears = 0;
+}
+
+void JitCodeRegions::Clear()
+{
+  m_last_executed.fill(0);
+  m_current_region = 0;
+  m_stats.clears++;
+}
+
+int JitCodeRegions::FindRegion(const u8* ptr) const
+{
+  for (int i = 0; i < NUM_REGIONS; i++)
+  {
+    if (ptr >= m_regions[i].near_start && ptr < m_regions[i].near_end)
+      return i;
+  }
+  return -1;
+}
+
+bool JitCodeRegions::IsAlmostFull(const u8* near_ptr, const u8* far_ptr) const
+{
+  const Region& region = m_regions[m_current_region];
+  return static_cast<size_t>(region.near_end - near_ptr) < MIN_SPACE_LEFT ||
+         static_cast<size_t>(region.far_end - far_ptr) < MIN_SPACE_LEFT;
+}
+
+int JitCodeRegions::GetOldestRegion() const
+{
+  int oldest = -1;
+  for (int i = 0; i < NUM_REGIONS; i++)
+  {
+    if (i != m_current_region && (oldest < 0 || m_last_executed[i] < m_last_executed[oldest]))
+      oldest = i;
+  }
+  return oldest;
+}
+
+void JitCodeRegions::OnEvicted(int region, int num_blocks)
+{
+  m_last_executed[region] = -1;
+  m_stats.evictions++;
+  m_stats.evicted_blocks += num_blocks;
+}
+
+void JitCodeRegions::SwitchToRegion(int region)
+{
+  m_current_region = region;
+  MarkExecuted(region);
+}
+
+void JitCodeRegions::MarkExecuted(int region)
+{
+  m_last_executed[region] = static_cast<s64>(CoreTiming::GetTicks());
+}
+
+void JitCodeRegions::GetCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  // Rates are per minute of emulated time.
+  const u64 elapsed = static_cast<u64>(static_cast<s64>(CoreTiming::GetTicks()) - m_stats_since);
+  const u64 ticks_per_minute = u64(SystemTimers::GetTicksPerSecond()) * 60;
+  auto per_minute = [&](u64 count) { return elapsed ? count * ticks_per_minute / elapsed : 0; };
+
+  counters->emplace_back("Code cache clears", m_stats.clears);
+  counters->emplace_back("Code cache clears per minute", per_minute(m_stats.clears));
+  counters->emplace_back("Code region evictions", m_stats.evictions);
+  counters->emplace_back("Code region evictions per minute", per_minute(m_stats.evictions));
+  counters->emplace_back("Evicted blocks", m_stats.evicted_blocks);
+}
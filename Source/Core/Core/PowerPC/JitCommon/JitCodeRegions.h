@@ -0,0 +1,78 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Partial eviction of the code cache.
+//
+// The near and far code spaces are split into NUM_REGIONS regions each, and
+// region i of the near code only has far code in region i of the far code.
+// Blocks are compiled into the current region. Once it runs out of space,
+// the region which was executed least recently is evicted and becomes the
+// current one, so only the blocks living there have to be recompiled instead
+// of the whole cache.
+//
+// Which regions are executing is sampled whenever a timeslice ends, as
+// linked blocks never go through the dispatcher.
+class JitCodeRegions
+{
+public:
+  static constexpr int NUM_REGIONS = 8;
+  // Space which has to be left in a region to start a block in it. This
+  // should be bigger than the biggest block ever.
+  static constexpr size_t MIN_SPACE_LEFT = 0x10000;
+
+  struct Stats
+  {
+    u64 clears = 0;
+    u64 evictions = 0;
+    u64 evicted_blocks = 0;
+  };
+
+  struct Region
+  {
+    u8* near_start;
+    u8* near_end;
+    u8* far_start;
+    u8* far_end;
+  };
+
+  void Init(u8* near_code, size_t near_size, u8* far_code, size_t far_size);
+  // Called when the whole cache gets cleared; starts over in the first region.
+  void Clear();
+
+  int GetCurrentRegion() const { return m_current_region; }
+  const Region& GetRegion(int region) const { return m_regions[region]; }
+  // Returns the region the near code at ptr belongs to, or -1.
+  int FindRegion(const u8* ptr) const;
+
+  // Returns true if a new block may not fit into the current region anymore.
+  bool IsAlmostFull(const u8* near_ptr, const u8* far_ptr) const;
+  // Returns the region other than the current one which was executed least
+  // recently.
+  int GetOldestRegion() const;
+  // Records that region has been emptied. It's the next one to be reused.
+  void OnEvicted(int region, int num_blocks);
+  void SwitchToRegion(int region);
+  void MarkExecuted(int region);
+
+  const Stats& GetStats() const { return m_stats; }
+  void GetCounters(std::vector<std::pair<std::string, u64>>* counters) const;
+
+private:
+  std::array<Region, NUM_REGIONS> m_regions{};
+  // Emulated time at which each region was last seen executing.
+  std::array<s64, NUM_REGIONS> m_last_executed{};
+  int m_current_region = 0;
+  s64 m_stats_since = 0;
+  Stats m_stats;
+};
@@ -0,0 +1,104 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitIdleLoops.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/PowerPC/PPCSymbolDB.h"
+#include "Core/PowerPC/PowerPC.h"
+
+void JitIdleLoops::Init(bool enabled)
+{
+  m_enabled = enabled;
+  m_loops.clear();
+  m_skips = 0;
+}
+
+void JitIdleLoops::Shutdown()
+{
+  m_enabled = false;
+  m_loops.clear();
+}
+
+PPCAnalyst::IdleLoop JitIdleLoops::Analyze(const PPCAnalyst::CodeBlock& block,
+                                           const PPCAnalyst::CodeBuffer& buffer)
+{
+  if (!m_enabled)
+    return {};
+
+  PPCAnalyst::IdleLoop loop = PPCAnalyst::AnalyzeIdleLoop(block, buffer);
+  if (loop.type != PPCAnalyst::IdleLoopType::None)
+    m_loops[block.m_address] = loop;
+  return loop;
+}
+
+static const char* GetTypeName(PPCAnalyst::IdleLoopType type)
+{
+  switch (type)
+  {
+  case PPCAnalyst::IdleLoopType::Busy:
+    return "busy";
+  case PPCAnalyst::IdleLoopType::Poll:
+    return "poll";
+  case PPCAnalyst::IdleLoopType::Delay:
+    return "delay";
+  default:
+    return "none";
+  }
+}
+
+void JitIdleLoops::WriteReport(const std::string& filename) const
+{
+  File::IOFile f(filename, "w");
+  if (!f)
+    return;
+
+  fprintf(f.GetHandle(), "address\ttype\tinstructions\tbranch\tsymbol\treason\n");
+  for (const auto& entry : m_loops)
+  {
+    const PPCAnalyst::IdleLoop& loop = entry.second;
+    const std::string symbol = g_symbolDB.GetDescription(entry.first);
+    fprintf(f.GetHandle(), "%08x\t%s\t%u\t%08x\t%s\t%s\n", entry.first, GetTypeName(loop.type),
+            loop.num_instructions, loop.branch_address, symbol.c_str(), loop.reason.c_str());
+  }
+}
+
+void JitIdleLoops::SkipDelayLoop(u32 cycles)
+{
+  // The exit charges the current iteration, and the last iteration has to run
+  // so that the loop ends through its branch.
+  const s32 remaining = PowerPC::ppcState.downcount - static_cast<s32>(cycles);
+  if (remaining <= 0 || CTR <= 1)
+    return;
+
+  const u32 iterations = std::min<u32>(CTR - 1, static_cast<u32>(remaining) / cycles);
+  CTR -= iterations;
+  PowerPC::ppcState.downcount -= static_cast<s32>(iterations * cycles);
+}
+
+void JitIdleLoops::GetCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  if (!m_enabled)
+    return;
+
+  u64 poll_loops = 0, delay_loops = 0, busy_loops = 0;
+  for (const auto& entry : m_loops)
+  {
+    if (entry.second.type == PPCAnalyst::IdleLoopType::Poll)
+      poll_loops++;
+    else if (entry.second.type == PPCAnalyst::IdleLoopType::Delay)
+      delay_loops++;
+    else
+      busy_loops++;
+  }
+  counters->emplace_back("Polling loops", poll_loops);
+  counters->emplace_back("Delay loops", delay_loops);
+  counters->emplace_back("Busy loops", busy_loops);
+  counters->emplace_back("Idle loop skips", m_skips);
+}
@@ -0,0 +1,50 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+
+// Idle loop skipping.
+//
+// Blocks which branch back to their start are classified by
+// PPCAnalyst::AnalyzeIdleLoop. Once a polling loop takes its branch back, it
+// would keep doing the same thing until an event or an exception changes
+// memory, so it skips straight to the next event. Delay loops run all the
+// iterations which fit before the next event at once instead. Both only happen
+// when the loads whose address comes from registers read RAM. Every loop which
+// gets compiled is recorded with the reason for its classification, and the
+// report is written to the log directory when the game stops.
+class JitIdleLoops
+{
+public:
+  void Init(bool enabled);
+  void Shutdown();
+
+  bool IsEnabled() const { return m_enabled; }
+  // Classifies the loop of a block that is about to be compiled.
+  PPCAnalyst::IdleLoop Analyze(const PPCAnalyst::CodeBlock& block,
+                               const PPCAnalyst::CodeBuffer& buffer);
+  void WriteReport(const std::string& filename) const;
+
+  // Called by the generated code when a delay loop branches back; cycles is
+  // what one iteration costs.
+  static void SkipDelayLoop(u32 cycles);
+
+  // Incremented by the generated code while profiling.
+  u64* GetSkipCounter() { return &m_skips; }
+  void GetCounters(std::vector<std::pair<std::string, u64>>* counters) const;
+
+private:
+  bool m_enabled = false;
+  // The latest classification of the loop starting at each address.
+  std::map<u32, PPCAnalyst::IdleLoop> m_loops;
+  u64 m_skips = 0;
+};
@@ -0,0 +1,104 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitTiering.h"
+
+#include <algorithm>
+
+#include "Common/CommonTypes.h"
+#include "Core/CoreTiming.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/PowerPC.h"
+
+void JitTiering::Init(bool enabled)
+{
+  m_enabled = enabled;
+  m_stats = Stats();
+  Clear();
+}
+
+void JitTiering::Clear()
+{
+  // Blocks have to earn their way back into the cache after a clear.
+  m_entries.clear();
+  m_budget = MAX_COMPILE_BURST;
+  m_budget_updated_at = static_cast<s64>(CoreTiming::GetTicks());
+}
+
+bool JitTiering::TakeCompileBudget()
+{
+  const s64 now = static_cast<s64>(CoreTiming::GetTicks());
+  const s64 earned = (now - m_budget_updated_at) / CYCLES_PER_COMPILE;
+  if (earned > 0)
+  {
+    m_budget = std::min(m_budget + earned, MAX_COMPILE_BURST);
+    m_budget_updated_at += earned * CYCLES_PER_COMPILE;
+  }
+
+  if (m_budget <= 0)
+    return false;
+  m_budget--;
+  return true;
+}
+
+bool JitTiering::ShouldInterpret(u32 em_address, u32 msr_bits)
+{
+  if (!m_enabled)
+    return false;
+
+  Entry& entry = m_entries[static_cast<u64>(msr_bits) << 32 | em_address];
+  if (entry.executions < TIER_UP_THRESHOLD)
+  {
+    if (entry.executions == 0)
+      m_stats.tier0_blocks++;
+    entry.executions++;
+    m_stats.tier0_executions++;
+    return true;
+  }
+
+  const s64 now = static_cast<s64>(CoreTiming::GetTicks());
+  if (entry.queued_at < 0)
+    entry.queued_at = now;
+
+  if (!TakeCompileBudget())
+  {
+    m_stats.tier0_executions++;
+    return true;
+  }
+
+  const u64 latency = static_cast<u64>(now - entry.queued_at);
+  m_stats.compiled_blocks++;
+  m_stats.queue_latency_sum += latency;
+  m_stats.queue_latency_max = std::max(m_stats.queue_latency_max, latency);
+  // The block cache owns the block from now on. If it gets invalidated, it
+  // starts over in tier 0.
+  m_entries.erase(static_cast<u64>(msr_bits) << 32 | em_address);
+  return false;
+}
+
+void JitTiering::GetCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  if (!m_enabled)
+    return;
+
+  counters->emplace_back("Tier 0 blocks", m_stats.tier0_blocks);
+  counters->emplace_back("Tier 0 executions", m_stats.tier0_executions);
+  counters->emplace_back("Tiered-up blocks", m_stats.compiled_blocks);
+  counters->emplace_back("Compile queue latency avg (cycles)",
+                         m_stats.compiled_blocks ?
+                             m_stats.queue_latency_sum / m_stats.compiled_blocks :
+                             0);
+  counters->emplace_back("Compile queue latency max (cycles)", m_stats.queue_latency_max);
+}
+
+void JitTiering::RunBlockInInterpreter()
+{
+  Interpreter* const interpreter = Interpreter::getInstance();
+
+  Interpreter::m_EndBlock = false;
+  int cycles = 0;
+  while (!Interpreter::m_EndBlock)
+    cycles += interpreter->SingleStepInner();
+  PowerPC::ppcState.downcount -= cycles;
+}
@@ -0,0 +1,73 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Decides when a block is worth compiling.
+//
+// With tiering enabled, a block which misses in the block cache isn't
+// compiled right away. It runs through the interpreter (tier 0) until it has
+// been executed TIER_UP_THRESHOLD times, at which point it is queued for
+// compilation. Queued blocks are compiled as long as the compile budget
+// allows; the budget refills with emulated time, so entering a new area of a
+// game spreads its compilation over several slices instead of stalling one
+// frame. Using emulated time keeps the decisions deterministic. Compilation
+// itself still happens on the CPU thread; the queue only decides when.
+class JitTiering
+{
+public:
+  // Number of tier 0 executions before a block is queued for compilation.
+  static constexpr u32 TIER_UP_THRESHOLD = 2;
+  // Emulated cycles needed to earn one compilation.
+  static constexpr s64 CYCLES_PER_COMPILE = 10000;
+  // Maximum number of compilations which can be saved up.
+  static constexpr s64 MAX_COMPILE_BURST = 64;
+
+  struct Stats
+  {
+    u64 tier0_executions = 0;
+    u64 tier0_blocks = 0;
+    u64 compiled_blocks = 0;
+    // Emulated cycles spent between a block getting queued and being compiled.
+    u64 queue_latency_sum = 0;
+    u64 queue_latency_max = 0;
+  };
+
+  void Init(bool enabled);
+  void Clear();
+
+  bool IsEnabled() const { return m_enabled; }
+  // Returns true if the block starting at em_address should be interpreted
+  // this time instead of being compiled.
+  bool ShouldInterpret(u32 em_address, u32 msr_bits);
+
+  const Stats& GetStats() const { return m_stats; }
+  void GetCounters(std::vector<std::pair<std::string, u64>>* counters) const;
+
+  // Runs one block starting at PC through the interpreter.
+  static void RunBlockInInterpreter();
+
+private:
+  struct Entry
+  {
+    u32 executions = 0;
+    // Emulated time at which the block got queued for compilation, or -1.
+    s64 queued_at = -1;
+  };
+
+  bool TakeCompileBudget();
+
+  bool m_enabled = false;
+  s64 m_budget = 0;
+  s64 m_budget_updated_at = 0;
+  std::unordered_map<u64, Entry> m_entries;  // (msr_bits << 32 | address) -> entry
+  Stats m_stats;
+};
@@ -0,0 +1,86 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitTraces.h"
+
+#include "Common/CommonTypes.h"
+
+void JitTraces::Init(bool enabled)
+{
+  m_enabled = enabled;
+  m_stats = Stats();
+  Clear();
+}
+
+void JitTraces::Clear()
+{
+  // Only called when the code cache is cleared, so nothing points into the
+  // profiles anymore.
+  m_profiles.clear();
+}
+
+bool JitTraces::ShouldProfile(u32 address) const
+{
+  if (!m_enabled)
+    return false;
+
+  auto it = m_profiles.find(address);
+  return it == m_profiles.end() || !it->second.finished;
+}
+
+u32* JitTraces::GetTakenCounter(u32 block_address, u32 branch_address)
+{
+  u32& counter = m_profiles[block_address].taken[branch_address];
+  // The block may be recompiled after being invalidated; start over.
+  counter = 0;
+  return &counter;
+}
+
+void JitTraces::FinishProfiling(u32 block_address)
+{
+  Profile& profile = m_profiles[block_address];
+  if (profile.finished)
+    return;
+
+  profile.finished = true;
+  m_stats.profiled_blocks++;
+  for (const auto& branch : profile.taken)
+  {
+    if (u64(branch.second) * 100 >= u64(HOT_BLOCK_THRESHOLD) * FOLLOW_PERCENT)
+      profile.followed.push_back(branch.first);
+  }
+}
+
+std::vector<u32> JitTraces::GetFollowedBranches(u32 block_address) const
+{
+  if (!m_enabled)
+    return {};
+
+  auto it = m_profiles.find(block_address);
+  if (it == m_profiles.end())
+    return {};
+  return it->second.followed;
+}
+
+void JitTraces::AddTrace(u32 num_instructions)
+{
+  m_stats.traces++;
+  m_stats.trace_instructions += num_instructions;
+}
+
+void JitTraces::GetCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  if (!m_enabled)
+    return;
+
+  counters->emplace_back("Profiled blocks", m_stats.profiled_blocks);
+  counters->emplace_back("Traces", m_stats.traces);
+  counters->emplace_back("Trace length avg (instructions)",
+                         m_stats.traces ? m_stats.trace_instructions / m_stats.traces : 0);
+  counters->emplace_back("Trace entries", m_stats.trace_entries);
+  counters->emplace_back("Trace side exits", m_stats.side_exits);
+  counters->emplace_back("Trace side exit rate (%)",
+                         m_stats.trace_entries ? m_stats.side_exits * 100 / m_stats.trace_entries :
+                                                 0);
+}
@@ -0,0 +1,74 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Profile-guided trace formation.
+//
+// With traces enabled, newly compiled blocks count how often they run and how
+// often each of their conditional branches is taken. Once a block has run
+// HOT_BLOCK_THRESHOLD times, the branches which were taken most of the time are
+// recorded and the block is recompiled as a trace: the analyzer continues at
+// the target of those branches, and the fall-through path becomes a side exit.
+// Each block is only profiled once.
+class JitTraces
+{
+public:
+  // Number of runs after which a profiled block gets recompiled.
+  static constexpr u32 HOT_BLOCK_THRESHOLD = 1000;
+  // A branch is followed if it was taken on at least this percentage of runs.
+  static constexpr u32 FOLLOW_PERCENT = 75;
+
+  struct Stats
+  {
+    u64 profiled_blocks = 0;
+    u64 traces = 0;
+    u64 trace_instructions = 0;
+    // Incremented by the generated code.
+    u64 trace_entries = 0;
+    u64 side_exits = 0;
+  };
+
+  void Init(bool enabled);
+  void Clear();
+
+  bool IsEnabled() const { return m_enabled; }
+  // Returns true if the block starting at address should be compiled with
+  // profiling code.
+  bool ShouldProfile(u32 address) const;
+  // Returns the taken counter of a branch in a profiled block. The pointer
+  // stays valid until Clear().
+  u32* GetTakenCounter(u32 block_address, u32 branch_address);
+  // Picks the branches to follow once a profiled block got hot.
+  void FinishProfiling(u32 block_address);
+  // Returns the branches to follow when compiling the block at address.
+  std::vector<u32> GetFollowedBranches(u32 block_address) const;
+  void AddTrace(u32 num_instructions);
+
+  u64* GetTraceEntriesCounter() { return &m_stats.trace_entries; }
+  u64* GetSideExitCounter() { return &m_stats.side_exits; }
+  const Stats& GetStats() const { return m_stats; }
+  void GetCounters(std::vector<std::pair<std::string, u64>>* counters) const;
+
+private:
+  struct Profile
+  {
+    bool finished = false;
+    std::map<u32, u32> taken;  // branch address -> times taken
+    std::vector<u32> followed;
+  };
+
+  bool m_enabled = false;
+  // Profiles are never erased before Clear(), as generated code points into them.
+  std::unordered_map<u32, Profile> m_profiles;
+  Stats m_stats;
+};
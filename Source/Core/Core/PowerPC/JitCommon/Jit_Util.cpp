@@ -242,10 +242,20 @@ FixupBranch EmuCodeBlock::CheckIfSafeAddress(const OpArg& reg_value, X64Reg reg_
   return J_CC(CC_Z, farcode.Enabled());
 }
 
+// Memory checks only unmap watched pages from the logical view, so untranslated
+// accesses still have to go through the memory functions to be checked.
+static bool UseMemFuncs(int flags)
+{
+  if ((flags & EmuCodeBlock::SAFE_LOADSTORE_FORCE_SLOWMEM) || jit->jo.alwaysUseMemFuncs)
+    return true;
+  bool dr_set = (flags & EmuCodeBlock::SAFE_LOADSTORE_DR_ON) || UReg_MSR(MSR).DR;
+  return !dr_set && PowerPC::memchecks.HasAny();
+}
+
 void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg& opAddress, int accessSize,
                                  s32 offset, BitSet32 registersInUse, bool signExtend, int flags)
 {
-  bool slowmem = (flags & SAFE_LOADSTORE_FORCE_SLOWMEM) != 0 || jit->jo.alwaysUseMemFuncs;
+  bool slowmem = UseMemFuncs(flags);
 
   registersInUse[reg_value] = false;
   if (jit->jo.fastmem && !(flags & SAFE_LOADSTORE_NO_FASTMEM) && !slowmem)
@@ -515,7 +525,7 @@ void EmuCodeBlock::SafeWriteRegToReg(OpArg reg_value, X64Reg reg_addr, int acces
                                      BitSet32 registersInUse, int flags)
 {
   bool swap = !(flags & SAFE_LOADSTORE_NO_SWAP);
-  bool slowmem = (flags & SAFE_LOADSTORE_FORCE_SLOWMEM) != 0 || jit->jo.alwaysUseMemFuncs;
+  bool slowmem = UseMemFuncs(flags);
 
   // set the correct immediate format
   reg_value = FixImmediate(accessSize, reg_value);
@@ -1111,3 +1121,12 @@ void EmuCodeBlock::Clear()
   backPatchInfo.clear();
   exceptionHandlerAtLoc.clear();
 }
+
+void EmuCodeBlock::ClearBackpatchInfo(const u8* start, const u8* end)
+{
+  auto in_range = [&](const u8* ptr) { return ptr >= start && ptr < end; };
+  for (auto it = backPatchInfo.begin(); it != backPatchInfo.end();)
+    it = in_range(it->first) ? backPatchInfo.erase(it) : std::next(it);
+  for (auto it = exceptionHandlerAtLoc.begin(); it != exceptionHandlerAtLoc.end();)
+    it = in_range(it->first) ? exceptionHandlerAtLoc.erase(it) : std::next(it);
+}
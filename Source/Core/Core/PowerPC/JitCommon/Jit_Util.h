@@ -204,6 +204,8 @@ public:
   void ConvertDoubleToSingle(Gen::X64Reg dst, Gen::X64Reg src);
   void SetFPRF(Gen::X64Reg xmm);
   void Clear();
+  // Forgets about the fastmem accesses of the code in [start, end).
+  void ClearBackpatchInfo(const u8* start, const u8* end);
 
 protected:
   std::unordered_map<u8*, TrampolineInfo> backPatchInfo;
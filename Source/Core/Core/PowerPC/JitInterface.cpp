@@ -12,10 +12,15 @@
 #include "Common/PerformanceCounter.h"
 #endif
 
+#include "Common/FileUtil.h"
+#include "Common/StringUtil.h"
+#include "Core/ConfigManager.h"
 #include "Core/Core.h"
+#include "Core/HLE/HLE_Memory.h"
 #include "Core/PowerPC/CachedInterpreter.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PPCAnalysisCache.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PowerPC.h"
 #include "Core/PowerPC/Profiler.h"
@@ -34,6 +39,8 @@
 
 namespace JitInterface
 {
+static PPCAnalyst::AnalysisCache s_analysis_cache;
+
 void DoState(PointerWrap& p)
 {
   if (jit && p.GetMode() == PointerWrap::MODE_READ)
@@ -68,6 +75,17 @@ CPUCoreBase* InitJitCore(int core)
   }
   jit = static_cast<JitBase*>(ptr);
   jit->Init();
+
+  // The analysis of a block depends on the breakpoints while debugging.
+  const SConfig& config = SConfig::GetInstance();
+  if (config.bJITAnalysisCache && !config.bEnableDebugging && !config.m_strGameID.empty())
+  {
+    File::CreateFullPath(File::GetUserPath(D_CACHE_IDX));
+    s_analysis_cache.Open(StringFromFormat("%s%s-ppcanalysis.cache",
+                                           File::GetUserPath(D_CACHE_IDX).c_str(),
+                                           config.m_strGameID.c_str()));
+    jit->SetAnalysisCache(&s_analysis_cache);
+  }
   return ptr;
 }
 void InitTables(int core)
@@ -112,16 +130,25 @@ void WriteProfileResults(const std::string& filename)
     return;
   }
   fprintf(f.GetHandle(), "origAddr\tblkName\trunCount\tcost\ttimeCost\tpercent\ttimePercent\tOvAlli"
-                         "nBlkTime(ms)\tblkCodeSize\n");
+                         "nBlkTime(ms)\tblkCodeSize\tavoidedLoads\tavoidedStores\n");
   for (auto& stat : prof_stats.block_stats)
   {
     std::string name = g_symbolDB.GetDescription(stat.addr);
     double percent = 100.0 * (double)stat.cost / (double)prof_stats.cost_sum;
     double timePercent = 100.0 * (double)stat.tick_counter / (double)prof_stats.timecost_sum;
     fprintf(f.GetHandle(),
-            "%08x\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%i\n", stat.addr,
-            name.c_str(), stat.run_count, stat.cost, stat.tick_counter, percent, timePercent,
-            (double)stat.tick_counter * 1000.0 / (double)prof_stats.countsPerSec, stat.block_size);
+            "%08x\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%i\t%" PRIu64
+            "\t%" PRIu64 "\n",
+            stat.addr, name.c_str(), stat.run_count, stat.cost, stat.tick_counter, percent,
+            timePercent, (double)stat.tick_counter * 1000.0 / (double)prof_stats.countsPerSec,
+            stat.block_size, stat.avoided_loads, stat.avoided_stores);
+  }
+
+  if (!prof_stats.counters.empty())
+  {
+    fprintf(f.GetHandle(), "\ncounter\tvalue\n");
+    for (const auto& counter : prof_stats.counters)
+      fprintf(f.GetHandle(), "%s\t%" PRIu64 "\n", counter.first.c_str(), counter.second);
   }
 }
 
@@ -134,6 +161,7 @@ void GetProfileResults(ProfileStats* prof_stats)
   prof_stats->cost_sum = 0;
   prof_stats->timecost_sum = 0;
   prof_stats->block_stats.clear();
+  prof_stats->counters.clear();
   prof_stats->block_stats.reserve(jit->GetBlockCache()->GetNumBlocks());
 
   Core::EState old_state = Core::GetState();
@@ -150,12 +178,16 @@ void GetProfileResults(ProfileStats* prof_stats)
     // Todo: tweak.
     if (block->runCount >= 1)
       prof_stats->block_stats.emplace_back(i, block->effectiveAddress, cost, timecost,
-                                           block->runCount, block->codeSize);
+                                           block->runCount, block->codeSize, block->avoidedLoads,
+                                           block->avoidedStores);
     prof_stats->cost_sum += cost;
     prof_stats->timecost_sum += timecost;
   }
 
   sort(prof_stats->block_stats.begin(), prof_stats->block_stats.end());
+  jit->GetProfileCounters(&prof_stats->counters);
+  s_analysis_cache.GetCounters(&prof_stats->counters);
+  HLE_Memory::GetCounters(&prof_stats->counters);
   if (old_state == Core::CORE_RUN)
     Core::SetState(Core::CORE_RUN);
 }
@@ -289,5 +321,6 @@ void Shutdown()
     delete jit;
     jit = nullptr;
   }
+  s_analysis_cache.Close();
 }
 }
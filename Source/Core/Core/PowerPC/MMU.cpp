@@ -25,8 +25,6 @@
 
 namespace PowerPC
 {
-#define HW_PAGE_SIZE 4096
-
 // EFB RE
 /*
 GXPeekZ
@@ -608,10 +606,12 @@ std::string HostGetString(u32 address, size_t size)
 
 bool IsOptimizableRAMAddress(const u32 address)
 {
-  if (PowerPC::memchecks.HasAny())
+  if (!UReg_MSR(MSR).DR)
     return false;
 
-  if (!UReg_MSR(MSR).DR)
+  // Accesses to watched memory have to go through Memcheck, and the rest of
+  // its chunk isn't mapped either.
+  if (Memory::IsWatchedLogicalChunk(address))
     return false;
 
   // TODO: This API needs to take an access size
@@ -923,6 +923,8 @@ static void GenerateISIException(u32 _EffectiveAddress)
 
 void SDRUpdated()
 {
+  Memory::ClearLogicalPages();
+
   u32 htabmask = SDR1_HTABMASK(PowerPC::ppcState.spr[SPR_SDR]);
   u32 x = 1;
   u32 xx = 0;
@@ -1020,6 +1022,8 @@ static void UpdateTLBEntry(const XCheckTLBFlag flag, UPTE2 PTE2, const u32 addre
 
 void InvalidateTLBEntry(u32 address)
 {
+  Memory::InvalidateLogicalPages(address);
+
   PowerPC::tlb_entry* tlbe =
       &PowerPC::ppcState.tlb[0][(address >> HW_PAGE_INDEX_SHIFT) & HW_PAGE_INDEX_MASK];
   tlbe->tag[0] = TLB_TAG_INVALID;
@@ -1030,6 +1034,28 @@ void InvalidateTLBEntry(u32 address)
   tlbe_i->tag[1] = TLB_TAG_INVALID;
 }
 
+// Mirrors the data TLB entry for address into the logical address space, so that
+// fastmem accesses to the page don't fault. Mappings are only removed by tlbie or
+// by SDR1 and BAT changes, not when the entry gets evicted from the TLB.
+static void MapLogicalPage(const XCheckTLBFlag flag, const u32 address)
+{
+  if ((flag != FLAG_READ && flag != FLAG_WRITE) || !Memory::HasLogicalPages())
+    return;
+
+  const u32 tag = address >> HW_PAGE_INDEX_SHIFT;
+  const PowerPC::tlb_entry& tlbe = PowerPC::ppcState.tlb[0][tag & HW_PAGE_INDEX_MASK];
+  for (int i = 0; i < TLB_WAYS; i++)
+  {
+    if (tlbe.tag[i] == tag)
+    {
+      UPTE2 PTE2;
+      PTE2.Hex = tlbe.pte[i];
+      Memory::MapLogicalPage(address, tlbe.paddr[i], PTE2.C != 0);
+      return;
+    }
+  }
+}
+
 // Page Address Translation
 static TranslateAddressResult TranslatePageAddress(const u32 address, const XCheckTLBFlag flag)
 {
@@ -1040,7 +1066,10 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
   u32 translatedAddress = 0;
   TLBLookupResult res = LookupTLBPageAddress(flag, address, &translatedAddress);
   if (res == TLB_FOUND)
+  {
+    MapLogicalPage(flag, address);
     return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED, translatedAddress};
+  }
 
   u32 sr = PowerPC::ppcState.sr[EA_SR(address)];
 
@@ -1105,6 +1134,7 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
         // We already updated the TLB entry if this was caused by a C bit.
         if (res != TLB_UPDATE_C)
           UpdateTLBEntry(flag, PTE2, address);
+        MapLogicalPage(flag, address);
 
         return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED,
                                       (PTE2.RPN << 12) | offset};
@@ -1114,6 +1144,20 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
   return TranslateAddressResult{TranslateAddressResult::PAGE_FAULT, 0};
 }
 
+bool HandleLogicalPageFault(u32 address)
+{
+  if (!Memory::HasLogicalPages() || (dbat_table[address >> BAT_INDEX_SHIFT] & 1))
+    return false;
+
+  // Reads don't fault on read-only pages, so a fault on one comes from a write, which has to set
+  // the C bit first.
+  const Memory::LogicalPageAccess access = Memory::GetLogicalPageAccess(address);
+  if (access == Memory::LogicalPageAccess::ReadWrite)
+    return false;
+  TranslatePageAddress(address, access == Memory::LogicalPageAccess::None ? FLAG_READ : FLAG_WRITE);
+  return Memory::GetLogicalPageAccess(address) != access;
+}
+
 static void UpdateBATs(BatTable& bat_table, u32 base_spr)
 {
   // TODO: Separate BATs for MSR.PR==0 and MSR.PR==1
@@ -1181,6 +1225,23 @@ static void UpdateBATs(BatTable& bat_table, u32 base_spr)
   }
 }
 
+// Memory checks leave watched memory out of the fastmem arena, so the address checks in the JIT
+// must send accesses there to the memory functions.
+static void UpdateWatchedBATs(BatTable& bat_table)
+{
+  if (!memchecks.HasAny())
+    return;
+
+  for (u32 i = 0; i < bat_table.size(); ++i)
+  {
+    if ((bat_table[i] & 2) &&
+        memchecks.OverlapsMemoryRange(i << BAT_INDEX_SHIFT, 1 << BAT_INDEX_SHIFT))
+    {
+      bat_table[i] &= ~2;
+    }
+  }
+}
+
 static void UpdateFakeMMUBat(BatTable& bat_table, u32 start_addr)
 {
   for (u32 i = 0; i < (0x10000000 >> BAT_INDEX_SHIFT); ++i)
@@ -1206,6 +1267,7 @@ void DBATUpdated()
     UpdateFakeMMUBat(dbat_table, 0x40000000);
     UpdateFakeMMUBat(dbat_table, 0x70000000);
   }
+  UpdateWatchedBATs(dbat_table);
 
 #ifndef _ARCH_32
   Memory::UpdateLogicalMemory(dbat_table);
@@ -0,0 +1,261 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/PPCAnalysisCache.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/ChunkFile.h"
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PPCTables.h"
+#include "Core/PowerPC/PowerPC.h"
+
+namespace PPCAnalyst
+{
+namespace
+{
+// An entry is an EntryHeader, followed by the CodeOps of the block, each with
+// whether it was read through a BAT. All of them are written field by field,
+// so that padding doesn't end up in the file.
+struct EntryHeader
+{
+  u32 num_instructions;
+  u32 next_pc;
+  BlockStats stats;
+  BlockRegStats gpa;
+  BlockRegStats fpa;
+  BitSet8 gqr_used;
+  BitSet8 gqr_modified;
+  BitSet32 gpr_inputs;
+  BitSet32 fpr_inputs;
+  BitSet32 gpr_overwritten;
+  BitSet32 fpr_overwritten;
+};
+
+void DoRegStats(PointerWrap& p, BlockRegStats& reg_stats)
+{
+  p.DoArray(reg_stats.firstRead);
+  p.DoArray(reg_stats.firstWrite);
+  p.DoArray(reg_stats.lastRead);
+  p.DoArray(reg_stats.lastWrite);
+  p.DoArray(reg_stats.numReads);
+  p.DoArray(reg_stats.numWrites);
+  p.Do(reg_stats.any);
+  p.Do(reg_stats.anyTimer);
+}
+
+void DoHeader(PointerWrap& p, EntryHeader& header)
+{
+  p.Do(header.num_instructions);
+  p.Do(header.next_pc);
+  p.Do(header.stats.isFirstBlockOfFunction);
+  p.Do(header.stats.isLastBlockOfFunction);
+  p.Do(header.stats.numCycles);
+  DoRegStats(p, header.gpa);
+  DoRegStats(p, header.fpa);
+  p.Do(header.gqr_used);
+  p.Do(header.gqr_modified);
+  p.Do(header.gpr_inputs);
+  p.Do(header.fpr_inputs);
+  p.Do(header.gpr_overwritten);
+  p.Do(header.fpr_overwritten);
+}
+
+// Leaves out opinfo, which is looked up again from the instruction.
+void DoCodeOp(PointerWrap& p, CodeOp& op, bool& from_bat)
+{
+  p.Do(op.inst.hex);
+  p.Do(op.address);
+  p.Do(op.branchTo);
+  p.Do(op.branchToIndex);
+  p.Do(op.regsOut);
+  p.Do(op.regsIn);
+  p.Do(op.fregsIn);
+  p.Do(op.fregOut);
+  p.Do(op.isBranchTarget);
+  p.Do(op.wantsCR0);
+  p.Do(op.wantsCR1);
+  p.Do(op.wantsFPRF);
+  p.Do(op.wantsCA);
+  p.Do(op.wantsCAInFlags);
+  p.Do(op.outputCR0);
+  p.Do(op.outputCR1);
+  p.Do(op.outputFPRF);
+  p.Do(op.outputCA);
+  p.Do(op.canEndBlock);
+  p.Do(op.skip);
+  p.Do(op.followTaken);
+  p.Do(op.fprInUse);
+  p.Do(op.gprInUse);
+  p.Do(op.gprInReg);
+  p.Do(op.fprInXmm);
+  p.Do(op.fprIsSingle);
+  p.Do(op.fprIsDuplicated);
+  p.Do(op.fprIsStoreSafe);
+  p.Do(from_bat);
+}
+
+size_t EntrySize(u32 num_instructions)
+{
+  EntryHeader header;
+  CodeOp op;
+  bool from_bat = false;
+  u8* ptr = nullptr;
+  PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+  DoHeader(p, header);
+  const size_t header_size = reinterpret_cast<size_t>(ptr);
+  DoCodeOp(p, op, from_bat);
+  const size_t op_size = reinterpret_cast<size_t>(ptr) - header_size;
+  return header_size + num_instructions * op_size;
+}
+}  // namespace
+
+class AnalysisCache::Reader final : public LinearDiskCacheReader<Key, u8>
+{
+public:
+  explicit Reader(AnalysisCache* cache) : m_cache(cache) {}
+  void Read(const Key& key, const u8* value, u32 value_size) override
+  {
+    if (value_size < EntrySize(0))
+      return;
+    std::vector<u8> entry(value, value + value_size);
+    u8* ptr = entry.data();
+    PointerWrap p(&ptr, PointerWrap::MODE_READ);
+    EntryHeader header;
+    DoHeader(p, header);
+    if (value_size != EntrySize(header.num_instructions))
+      return;
+
+    // Later entries replace earlier ones for the same key.
+    m_cache->m_entries[key] = std::move(entry);
+  }
+
+private:
+  AnalysisCache* m_cache;
+};
+
+void AnalysisCache::Open(const std::string& filename)
+{
+  Close();
+  Reader reader(this);
+  m_file.OpenAndRead(filename, reader);
+  m_stats.loaded = m_entries.size();
+  m_open = true;
+  INFO_LOG(DYNA_REC, "Loaded %zu block analyses from %s", m_entries.size(), filename.c_str());
+}
+
+void AnalysisCache::Close()
+{
+  if (m_open)
+    m_file.Close();
+  m_open = false;
+  m_entries.clear();
+  m_stats = Stats();
+}
+
+bool AnalysisCache::Load(const Key& key, CodeBlock* block, CodeBuffer* buffer, u32* next_pc)
+{
+  auto it = m_entries.find(key);
+  if (it == m_entries.end())
+  {
+    m_stats.misses++;
+    return false;
+  }
+
+  u8* ptr = it->second.data();
+  PointerWrap p(&ptr, PointerWrap::MODE_READ);
+  EntryHeader header;
+  DoHeader(p, header);
+  if (header.num_instructions > static_cast<u32>(buffer->GetSize()))
+  {
+    m_stats.misses++;
+    return false;
+  }
+
+  // Read the code again the way Analyze does, so the entry is only used if
+  // the instructions and their translation are unchanged.
+  CodeOp* code = buffer->codebuffer;
+  for (u32 i = 0; i < header.num_instructions; i++)
+  {
+    bool from_bat;
+    DoCodeOp(p, code[i], from_bat);
+    auto result = PowerPC::TryReadInstruction(code[i].address);
+    if (!result.valid || result.hex != code[i].inst.hex || result.from_bat != from_bat)
+    {
+      m_stats.stale++;
+      m_entries.erase(it);
+      return false;
+    }
+    code[i].opinfo = GetOpInfo(code[i].inst);
+  }
+
+  *block->m_stats = header.stats;
+  *block->m_gpa = header.gpa;
+  *block->m_fpa = header.fpa;
+  block->m_address = key.address;
+  block->m_num_instructions = header.num_instructions;
+  block->m_broken = false;
+  block->m_memory_exception = false;
+  block->m_gqr_used = header.gqr_used;
+  block->m_gqr_modified = header.gqr_modified;
+  block->m_gpr_inputs = header.gpr_inputs;
+  block->m_fpr_inputs = header.fpr_inputs;
+  block->m_gpr_overwritten = header.gpr_overwritten;
+  block->m_fpr_overwritten = header.fpr_overwritten;
+  *next_pc = header.next_pc;
+  m_stats.hits++;
+  return true;
+}
+
+void AnalysisCache::Store(const Key& key, const CodeBlock& block, const CodeBuffer& buffer,
+                          u32 next_pc)
+{
+  EntryHeader header;
+  header.num_instructions = block.m_num_instructions;
+  header.next_pc = next_pc;
+  header.stats = *block.m_stats;
+  header.gpa = *block.m_gpa;
+  header.fpa = *block.m_fpa;
+  header.gqr_used = block.m_gqr_used;
+  header.gqr_modified = block.m_gqr_modified;
+  header.gpr_inputs = block.m_gpr_inputs;
+  header.fpr_inputs = block.m_fpr_inputs;
+  header.gpr_overwritten = block.m_gpr_overwritten;
+  header.fpr_overwritten = block.m_fpr_overwritten;
+
+  std::vector<u8> entry(EntrySize(block.m_num_instructions));
+  u8* ptr = entry.data();
+  PointerWrap p(&ptr, PointerWrap::MODE_WRITE);
+  DoHeader(p, header);
+  for (u32 i = 0; i < block.m_num_instructions; i++)
+  {
+    CodeOp op = buffer.codebuffer[i];
+    bool from_bat = PowerPC::TryReadInstruction(op.address).from_bat;
+    DoCodeOp(p, op, from_bat);
+  }
+
+  // Only write it out if it changed, so the file doesn't grow every time the
+  // same code is analyzed again, but stale entries do get replaced.
+  std::vector<u8>& stored = m_entries[key];
+  if (stored == entry)
+    return;
+  stored = std::move(entry);
+  m_file.Append(key, stored.data(), static_cast<u32>(stored.size()));
+}
+
+void AnalysisCache::GetCounters(std::vector<std::pair<std::string, u64>>* counters) const
+{
+  if (!m_open)
+    return;
+
+  counters->emplace_back("Analysis cache entries loaded", m_stats.loaded);
+  counters->emplace_back("Analysis cache hits", m_stats.hits);
+  counters->emplace_back("Analysis cache misses", m_stats.misses);
+  counters->emplace_back("Analysis cache stale entries", m_stats.stale);
+}
+}  // namespace PPCAnalyst
@@ -0,0 +1,79 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/LinearDiskCache.h"
+
+namespace PPCAnalyst
+{
+struct CodeBlock;
+class CodeBuffer;
+
+// Keeps the results of PPCAnalyzer::Analyze around, on disk too, so blocks
+// don't have to be analyzed again when a game is started another time.
+//
+// Entries remember the instructions they were made from. An entry is only
+// used if reading the block's code again yields the same instructions with
+// the same address translation, so modified code is always analyzed again.
+class AnalysisCache
+{
+public:
+  struct Key
+  {
+    u32 address;
+    u32 msr_bits;
+    u32 options;
+    u32 block_size;
+    // Hash of the branches a trace follows.
+    u64 followed_branches;
+
+    bool operator<(const Key& other) const
+    {
+      return std::tie(address, msr_bits, options, block_size, followed_branches) <
+             std::tie(other.address, other.msr_bits, other.options, other.block_size,
+                      other.followed_branches);
+    }
+  };
+
+  struct Stats
+  {
+    u64 loaded = 0;
+    u64 hits = 0;
+    u64 misses = 0;
+    // Entries which didn't match the code in memory anymore.
+    u64 stale = 0;
+  };
+
+  // Reads the entries stored in filename. New entries are appended to it.
+  void Open(const std::string& filename);
+  void Close();
+  bool IsOpen() const { return m_open; }
+
+  // Fills block and buffer from the entry for key and returns true if its
+  // code is still in memory.
+  bool Load(const Key& key, CodeBlock* block, CodeBuffer* buffer, u32* next_pc);
+  // Remembers the analysis of a block which ended at next_pc.
+  void Store(const Key& key, const CodeBlock& block, const CodeBuffer& buffer, u32 next_pc);
+
+  const Stats& GetStats() const { return m_stats; }
+  void GetCounters(std::vector<std::pair<std::string, u64>>* counters) const;
+
+private:
+  class Reader;
+
+  bool m_open = false;
+  // Serialized entries; see PPCAnalysisCache.cpp for the layout.
+  std::map<Key, std::vector<u8>> m_entries;
+  LinearDiskCache<Key, u8> m_file;
+  Stats m_stats;
+};
+}  // namespace PPCAnalyst
@@ -3,14 +3,17 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <queue>
 #include <string>
 
 #include "Common/CommonTypes.h"
+#include "Common/Hash.h"
 #include "Common/Logging/Log.h"
 #include "Common/StringUtil.h"
 #include "Core/ConfigManager.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/PPCAnalysisCache.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PPCTables.h"
@@ -627,6 +630,34 @@ void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, GekkoOPInf
 }
 
 u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize)
+{
+  if (!m_cache)
+    return AnalyzeBlock(address, block, buffer, blockSize);
+
+  AnalysisCache::Key key;
+  key.address = address;
+  key.msr_bits = MSR & JitBlock::JIT_CACHE_MSR_MASK;
+  key.options = m_options;
+  key.block_size = blockSize;
+  key.followed_branches =
+      m_followed_branches.empty() ?
+          0 :
+          GetHash64(reinterpret_cast<const u8*>(m_followed_branches.data()),
+                    static_cast<u32>(m_followed_branches.size() * sizeof(u32)), 0);
+
+  u32 next_pc;
+  if (m_cache->Load(key, block, buffer, &next_pc))
+    return next_pc;
+
+  next_pc = AnalyzeBlock(address, block, buffer, blockSize);
+  // Broken blocks end wherever the code couldn't be read, which isn't
+  // recorded in the entry.
+  if (!block->m_broken && !block->m_memory_exception)
+    m_cache->Store(key, *block, *buffer, next_pc);
+  return next_pc;
+}
+
+u32 PPCAnalyzer::AnalyzeBlock(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize)
 {
   // Clear block stats
   memset(block->m_stats, 0, sizeof(BlockStats));
@@ -768,7 +799,27 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
       }
     }
 
-    if (!follow)
+    // Traces continue at the target of conditional branches which are known
+    // to be mostly taken, unless that would loop back into the trace. Like
+    // blocks, traces outside of BATs don't leave the page they started in.
+    bool follow_taken = false;
+    if (conditional_continue && inst.OPCD == 16 && !inst.LK && !m_followed_branches.empty() &&
+        std::find(m_followed_branches.begin(), m_followed_branches.end(), address) !=
+            m_followed_branches.end())
+    {
+      destination = inst.AA ? SignExt16(inst.BD << 2) : address + SignExt16(inst.BD << 2);
+      follow_taken =
+          (result.from_bat || (destination & ~0xfff) == (address & ~0xfff)) &&
+          std::none_of(code, code + i + 1,
+                       [destination](const CodeOp& op) { return op.address == destination; });
+    }
+
+    if (follow_taken)
+    {
+      code[i].followTaken = true;
+      address = destination;
+    }
+    else if (!follow)
     {
       address += 4;
       if (!conditional_continue && opinfo->flags & FL_ENDBLOCK)  // right now we stop early
@@ -845,11 +896,22 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
 
   // Forward scan, for flags that need the other direction for calculation.
   BitSet32 fprIsSingle, fprIsDuplicated, fprIsStoreSafe, gprDefined, gprBlockInputs;
+  BitSet32 fprDefined, fprBlockInputs, gprOverwritten, fprOverwritten;
   BitSet8 gqrUsed, gqrModified;
+  bool canExit = false;
   for (u32 i = 0; i < block->m_num_instructions; i++)
   {
     gprBlockInputs |= code[i].regsIn & ~gprDefined;
     gprDefined |= code[i].regsOut;
+    fprBlockInputs |= code[i].fregsIn & ~fprDefined;
+    if (code[i].fregOut >= 0)
+      fprDefined[code[i].fregOut] = true;
+    canExit |= code[i].canEndBlock;
+    if (!canExit)
+    {
+      gprOverwritten = gprDefined;
+      fprOverwritten = fprDefined;
+    }
 
     code[i].fprIsSingle = fprIsSingle;
     code[i].fprIsDuplicated = fprIsDuplicated;
@@ -904,7 +966,237 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
   block->m_gqr_used = gqrUsed;
   block->m_gqr_modified = gqrModified;
   block->m_gpr_inputs = gprBlockInputs;
+  block->m_fpr_inputs = fprBlockInputs;
+  block->m_gpr_overwritten = gprOverwritten;
+  block->m_fpr_overwritten = fprOverwritten;
   return address;
 }
 
+static u32 GetBranchTarget(const CodeOp& op)
+{
+  if (op.inst.OPCD == 18)
+    return EvaluateBranchTarget(op.inst, op.address);
+
+  u32 target = SignExt16(op.inst.BD << 2);
+  if (!op.inst.AA)
+    target += op.address;
+  return target;
+}
+
+static bool DecrementsCTR(const CodeOp& op)
+{
+  return op.inst.OPCD == 16 && !(op.inst.BO & BO_DONT_DECREMENT_FLAG);
+}
+
+// Returns why the instruction keeps a loop from being idle, or an empty string.
+static std::string GetBusyReason(const CodeOp& op, u32 loop_start, u32 loop_end)
+{
+  const GekkoOPInfo* info = op.opinfo;
+  if (op.skip)
+    return "calls a function";
+  if (info->flags & (FL_EVIL | FL_TIMER | FL_CHECKEXCEPTIONS))
+    return StringFromFormat("uses %s", info->opname);
+
+  // Only conditional branches out of the loop, or back to its start. The
+  // branch closing the loop is checked by the caller.
+  if (op.inst.OPCD == 16 || op.inst.OPCD == 18)
+  {
+    const u32 target = GetBranchTarget(op);
+    if (op.address == loop_end ||
+        (op.inst.OPCD == 16 && !op.inst.LK && (target <= loop_start || target > loop_end)))
+    {
+      return "";
+    }
+    return StringFromFormat("branches with %s", info->opname);
+  }
+
+  switch (info->type)
+  {
+  case OPTYPE_INTEGER:
+    if (info->flags & (FL_SET_CA | FL_READ_CA))
+      return StringFromFormat("uses the carry flag in %s", info->opname);
+    if ((info->flags & FL_SET_OE) && op.inst.OE)
+      return StringFromFormat("sets the overflow flag in %s", info->opname);
+    return "";
+
+  case OPTYPE_LOAD:
+    return "";
+
+  case OPTYPE_STORE:
+  case OPTYPE_STOREFP:
+  case OPTYPE_STOREPS:
+  case OPTYPE_DCACHE:
+  case OPTYPE_ICACHE:
+    return StringFromFormat("writes memory with %s", info->opname);
+
+  case OPTYPE_LOADFP:
+  case OPTYPE_LOADPS:
+  case OPTYPE_DOUBLEFP:
+  case OPTYPE_SINGLEFP:
+  case OPTYPE_PS:
+  case OPTYPE_SYSTEMFP:
+    return StringFromFormat("uses floating point in %s", info->opname);
+
+  default:
+    return StringFromFormat("uses %s", info->opname);
+  }
+}
+
+// Tracks the values li, lis, addi, addis, ori and oris compute from constants.
+static void UpdateKnownValue(const CodeOp& op, std::array<u32, 32>* values, BitSet32* known)
+{
+  const UGeckoInstruction inst = op.inst;
+  const bool from_constant = inst.RA == 0 || (*known)[inst.RA];
+  const bool from_known_source = (*known)[inst.RS];
+  *known &= ~op.regsOut;
+  if ((inst.OPCD == 14 || inst.OPCD == 15) && from_constant)
+  {
+    const u32 base = inst.RA == 0 ? 0 : (*values)[inst.RA];
+    const u32 imm = static_cast<u32>(static_cast<s32>(inst.SIMM_16));
+    (*values)[inst.RD] = base + (inst.OPCD == 15 ? imm << 16 : imm);
+    (*known)[inst.RD] = true;
+  }
+  else if ((inst.OPCD == 24 || inst.OPCD == 25) && from_known_source)
+  {
+    (*values)[inst.RA] = (*values)[inst.RS] | (inst.OPCD == 25 ? inst.UIMM << 16 : inst.UIMM);
+    (*known)[inst.RA] = true;
+  }
+}
+
+// Works out where a load of a loop reads from, given the registers with a known value and the
+// ones written earlier in the iteration. Registers the loop doesn't write keep their value, so
+// addresses depending on them are left to the generated code to check. Returns why the load keeps
+// the loop from being idle, or an empty string.
+static std::string GetLoadAddress(const CodeOp& op, const std::array<u32, 32>& values,
+                                  BitSet32 known, BitSet32 defined, IdleLoopLoad* load)
+{
+  const bool indexed = op.inst.OPCD == 31;
+  load->offset = indexed ? 0 : static_cast<u32>(static_cast<s32>(op.inst.SIMM_16));
+  auto add_register = [&](int reg, s8* slot) {
+    if (known[reg])
+      load->offset += values[reg];
+    else if (defined[reg])
+      return false;
+    else
+      *slot = static_cast<s8>(reg);
+    return true;
+  };
+  if ((op.inst.RA != 0 && !add_register(op.inst.RA, &load->base)) ||
+      (indexed && !add_register(op.inst.RB, &load->index)))
+  {
+    return StringFromFormat("reads memory at a computed address with %s", op.opinfo->opname);
+  }
+
+  if (load->base < 0 && load->index < 0 && !PowerPC::HostIsRAMAddress(load->offset))
+    return StringFromFormat("reads %08x, which isn't RAM, with %s", load->offset,
+                            op.opinfo->opname);
+  return "";
+}
+
+IdleLoop AnalyzeIdleLoop(const CodeBlock& block, const CodeBuffer& buffer)
+{
+  const CodeOp* code = buffer.codebuffer;
+  IdleLoop loop;
+
+  // Look for the branch back to the start. An unconditional one ends the block,
+  // and traces continue at the target of their followed branches.
+  u32 end = 0;
+  for (; end < block.m_num_instructions; end++)
+  {
+    const CodeOp& op = code[end];
+    const bool conditional = op.inst.OPCD == 16 && !op.followTaken;
+    const bool unconditional = op.inst.OPCD == 18 && end == block.m_num_instructions - 1;
+    if ((conditional || unconditional) && !op.inst.LK && !op.skip &&
+        GetBranchTarget(op) == block.m_address)
+    {
+      break;
+    }
+  }
+  if (end == block.m_num_instructions)
+    return loop;
+
+  loop.branch_address = code[end].address;
+  loop.num_instructions = end + 1;
+  loop.type = IdleLoopType::Busy;
+
+  // An iteration only depends on memory if every register it reads is either
+  // left alone by the loop or defined earlier in the same iteration.
+  BitSet32 gprs_defined, gprs_written, gprs_read_first;
+  BitSet8 crs_defined, crs_written, crs_read_first;
+  // Load addresses are usually built from constants in the loop.
+  std::array<u32, 32> gpr_values{};
+  BitSet32 gprs_known;
+  for (u32 i = 0; i <= end; i++)
+  {
+    const CodeOp& op = code[i];
+    const std::string reason = GetBusyReason(op, block.m_address, loop.branch_address);
+    if (!reason.empty())
+    {
+      loop.reason = StringFromFormat("%s at %08x", reason.c_str(), op.address);
+      return loop;
+    }
+    if (i != end && DecrementsCTR(op))
+    {
+      loop.reason = StringFromFormat("counts down CTR at %08x", op.address);
+      return loop;
+    }
+    if (op.opinfo->type == OPTYPE_LOAD)
+    {
+      IdleLoopLoad load;
+      const std::string load_reason =
+          GetLoadAddress(op, gpr_values, gprs_known, gprs_defined, &load);
+      if (!load_reason.empty())
+      {
+        loop.reason = StringFromFormat("%s at %08x", load_reason.c_str(), op.address);
+        return loop;
+      }
+      if (load.base >= 0 || load.index >= 0)
+        loop.loads.push_back(load);
+    }
+
+    // ori rX, rX, 0 (like nop) changes nothing, but would look like it keeps rX.
+    if (op.inst.OPCD == 24 && op.inst.UIMM == 0 && op.inst.RA == op.inst.RS)
+      continue;
+
+    BitSet8 crs_in, crs_out;
+    if (op.inst.OPCD == 16 && !(op.inst.BO & BO_DONT_CHECK_CONDITION))
+      crs_in[op.inst.BI >> 2] = true;
+    if (op.opinfo->flags & FL_SET_CRn)
+      crs_out[op.inst.CRFD] = true;
+    if (op.outputCR0)
+      crs_out[0] = true;
+
+    gprs_read_first |= op.regsIn & ~gprs_defined;
+    gprs_defined |= op.regsOut;
+    gprs_written |= op.regsOut;
+    UpdateKnownValue(op, &gpr_values, &gprs_known);
+    crs_read_first |= crs_in & ~crs_defined;
+    crs_defined |= crs_out;
+    crs_written |= crs_out;
+  }
+
+  for (int reg : gprs_read_first & gprs_written)
+  {
+    loop.reason = StringFromFormat("keeps r%d between iterations", reg);
+    return loop;
+  }
+  for (int field : crs_read_first & crs_written)
+  {
+    loop.reason = StringFromFormat("keeps cr%d between iterations", field);
+    return loop;
+  }
+
+  if (DecrementsCTR(code[end]))
+  {
+    loop.type = IdleLoopType::Delay;
+    loop.reason = "only counts down CTR";
+  }
+  else
+  {
+    loop.type = IdleLoopType::Poll;
+    loop.reason = "only reads memory";
+  }
+  return loop;
+}
+
 }  // namespace
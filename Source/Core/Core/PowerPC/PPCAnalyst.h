@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/BitSet.h"
@@ -19,6 +20,8 @@ struct Symbol;
 
 namespace PPCAnalyst
 {
+class AnalysisCache;
+
 struct CodeOp  // 16B
 {
   UGeckoInstruction inst;
@@ -42,6 +45,9 @@ struct CodeOp  // 16B
   bool outputCA;
   bool canEndBlock;
   bool skip;  // followed BL-s for example
+  // Conditional branch whose target is the next instruction of a trace; the
+  // fall-through path leaves the block.
+  bool followTaken;
   // which registers are still needed after this instruction in this block
   BitSet32 fprInUse;
   BitSet32 gprInUse;
@@ -109,6 +115,8 @@ struct BlockRegStats
     {
       firstRead[i] = -1;
       firstWrite[i] = -1;
+      lastRead[i] = -1;
+      lastWrite[i] = -1;
       numReads[i] = 0;
       numWrites[i] = 0;
     }
@@ -157,6 +165,49 @@ struct CodeBlock
 
   // Which GPRs this block reads from before defining, if any.
   BitSet32 m_gpr_inputs;
+
+  // Which FPRs this block reads from before defining, if any.
+  BitSet32 m_fpr_inputs;
+
+  // Which GPRs and FPRs this block defines before it can exit. Their values
+  // from before the block are dead once it has been entered, so a block
+  // jumping straight into it doesn't have to store them.
+  BitSet32 m_gpr_overwritten;
+  BitSet32 m_fpr_overwritten;
+};
+
+enum class IdleLoopType
+{
+  // The block doesn't branch back to its start.
+  None,
+  // A loop which does more than waiting; the reason says why.
+  Busy,
+  // Waits for memory to change, which only an event or an exception can do.
+  Poll,
+  // Waits for CTR to count down, and possibly for memory to change.
+  Delay,
+};
+
+// A load of a loop from offset plus the values of base and index, where given.
+// Those are registers the loop doesn't write, so the address stays the same.
+struct IdleLoopLoad
+{
+  s8 base = -1;
+  s8 index = -1;
+  u32 offset = 0;
+};
+
+struct IdleLoop
+{
+  IdleLoopType type = IdleLoopType::None;
+  // The branch back to the start of the block.
+  u32 branch_address = 0;
+  u32 num_instructions = 0;
+  std::string reason;
+  // The loads whose address depends on registers, which have to be checked to
+  // read RAM before the loop can be skipped. Constant addresses are checked by
+  // AnalyzeIdleLoop already.
+  std::vector<IdleLoopLoad> loads;
 };
 
 class PPCAnalyzer
@@ -173,9 +224,16 @@ private:
   void ReorderInstructions(u32 instructions, CodeOp* code);
   void SetInstructionStats(CodeBlock* block, CodeOp* code, GekkoOPInfo* opinfo, u32 index);
 
+  u32 AnalyzeBlock(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize);
+
   // Options
   u32 m_options;
 
+  // Conditional branches to follow when forming a trace.
+  std::vector<u32> m_followed_branches;
+
+  AnalysisCache* m_cache = nullptr;
+
 public:
   enum AnalystOption
   {
@@ -220,9 +278,27 @@ public:
   void SetOption(AnalystOption option) { m_options |= option; }
   void ClearOption(AnalystOption option) { m_options &= ~(option); }
   bool HasOption(AnalystOption option) const { return !!(m_options & option); }
+
+  // Makes the next Analyze() continue at the target of the given conditional
+  // branches instead of their fall-through, turning the block into a trace.
+  // Only used with OPTION_CONDITIONAL_CONTINUE.
+  void SetFollowedBranches(std::vector<u32> branches)
+  {
+    m_followed_branches = std::move(branches);
+  }
+  // Makes Analyze() reuse earlier results from cache; nullptr disables it.
+  void SetCache(AnalysisCache* cache) { m_cache = cache; }
+
   u32 Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize);
 };
 
+// Checks whether the block is a loop whose iterations don't change anything
+// but CTR, and only depend on RAM and on values computed in the same
+// iteration. Running such a loop again does the same thing until memory
+// changes. Memory mapped registers can change with time alone, so loops
+// reading them are busy.
+IdleLoop AnalyzeIdleLoop(const CodeBlock& block, const CodeBuffer& buffer);
+
 void LogFunctionCall(u32 addr);
 void FindFunctions(u32 startAddr, u32 endAddr, PPCSymbolDB* func_db);
 bool AnalyzeFunction(u32 startAddr, Symbol& func, int max_size = 0);
@@ -58,6 +58,8 @@ void InstructionCache::Reset()
 {
   memset(valid, 0, sizeof(valid));
   memset(plru, 0, sizeof(plru));
+  last_line = ICACHE_NO_LINE;
+  last_way = 0;
   memset(lookup_table, 0xff, sizeof(lookup_table));
   memset(lookup_table_ex, 0xff, sizeof(lookup_table_ex));
   memset(lookup_table_vmem, 0xff, sizeof(lookup_table_vmem));
@@ -89,6 +91,7 @@ void InstructionCache::Invalidate(u32 addr)
         lookup_table[((tags[set][i] << 7) | set) & 0xfffff] = 0xff;
     }
   valid[set] = 0;
+  last_line = ICACHE_NO_LINE;
   JitInterface::InvalidateICache(addr & ~0x1f, 32, false);
 }
 
@@ -97,6 +100,8 @@ u32 InstructionCache::ReadInstruction(u32 addr)
   if (!HID0.ICE)  // instruction cache is disabled
     return Memory::Read_U32(addr);
   u32 set = (addr >> 5) & 0x7f;
+  if ((addr & ~0x1f) == last_line)
+    return Common::swap32(data[set][last_way][(addr >> 2) & 7]);
   u32 tag = addr >> 12;
 
   u32 t;
@@ -145,6 +150,8 @@ u32 InstructionCache::ReadInstruction(u32 addr)
   }
   // update plru
   plru[set] = (plru[set] & ~s_plru_mask[t]) | s_plru_value[t];
+  last_line = addr & ~0x1f;
+  last_way = t;
   u32 res = Common::swap32(data[set][t][(addr >> 2) & 7]);
   return res;
 }
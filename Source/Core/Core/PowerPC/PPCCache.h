@@ -16,6 +16,9 @@ const u32 ICACHE_BLOCK_SIZE = 8;
 const u32 ICACHE_EXRAM_BIT = 0x10000000;
 const u32 ICACHE_VMEM_BIT = 0x20000000;
 
+// Never equal to the address of a line, which has the low bits clear.
+const u32 ICACHE_NO_LINE = 1;
+
 struct InstructionCache
 {
   u32 data[ICACHE_SETS][ICACHE_WAYS][ICACHE_BLOCK_SIZE];
@@ -23,6 +26,11 @@ struct InstructionCache
   u32 plru[ICACHE_SETS];
   u32 valid[ICACHE_SETS];
 
+  // The line and way of the last hit. The interpreter reads a line eight times in a row, and
+  // repeating the PLRU update of the last hit in its set changes nothing.
+  u32 last_line;
+  u32 last_way;
+
   u32 way_from_valid[255];
   u32 way_from_plru[128];
 
@@ -41,6 +41,7 @@ enum CoreMode
 #define NUM_TLBS 2
 #define TLB_WAYS 2
 
+#define HW_PAGE_SIZE 4096
 #define HW_PAGE_INDEX_SHIFT 12
 #define HW_PAGE_INDEX_MASK 0x3f
 #define HW_PAGE_TAG_SHIFT 18
@@ -267,6 +268,9 @@ void ClearCacheLine(const u32 address);  // Zeroes 32 bytes; address should be 3
 // TLB functions
 void SDRUpdated();
 void InvalidateTLBEntry(u32 address);
+// Called when a fastmem access to a logical address faulted. Maps the page if the page
+// table translates it, and returns whether the access can be retried.
+bool HandleLogicalPageFault(u32 address);
 void DBATUpdated();
 void IBATUpdated();
 
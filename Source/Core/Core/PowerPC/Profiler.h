@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -43,8 +44,9 @@
 
 struct BlockStat
 {
-  BlockStat(int bn, u32 _addr, u64 c, u64 ticks, u64 run, u32 size)
-      : blockNum(bn), addr(_addr), cost(c), tick_counter(ticks), run_count(run), block_size(size)
+  BlockStat(int bn, u32 _addr, u64 c, u64 ticks, u64 run, u32 size, u64 loads, u64 stores)
+      : blockNum(bn), addr(_addr), cost(c), tick_counter(ticks), run_count(run), block_size(size),
+        avoided_loads(loads), avoided_stores(stores)
   {
   }
   int blockNum;
@@ -53,6 +55,9 @@ struct BlockStat
   u64 tick_counter;
   u64 run_count;
   u32 block_size;
+  // Register loads and stores saved by passing registers into linked blocks.
+  u64 avoided_loads;
+  u64 avoided_stores;
 
   bool operator<(const BlockStat& other) const { return cost > other.cost; }
 };
@@ -62,6 +67,8 @@ struct ProfileStats
   u64 cost_sum;
   u64 timecost_sum;
   u64 countsPerSec;
+  // Named event counters reported by the JIT core.
+  std::vector<std::pair<std::string, u64>> counters;
 };
 
 namespace Profiler
@@ -0,0 +1,346 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/SamplingProfiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Event.h"
+#include "Common/FileUtil.h"
+#include "Common/Logging/Log.h"
+#include "Common/StringUtil.h"
+#include "Common/SymbolDB.h"
+#include "Common/Thread.h"
+#include "Core/MachineContext.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/PPCSymbolDB.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// Android and OSX haven't implemented thread_local yet, see Core.cpp.
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(__ANDROID__) && defined(CTX_PC)
+#define SAMPLING_PROFILER_SUPPORTED
+#include <cerrno>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+namespace SamplingProfiler
+{
+namespace
+{
+// What a sample hit. Every sample is stored as the frame and an address.
+enum Frame : u32
+{
+  // address is the effective address of the block.
+  FRAME_JIT_BLOCK = 1,
+  FRAME_JIT_UNKNOWN_BLOCK,
+  FRAME_JIT_ROUTINES,
+  FRAME_JIT_FAR_CODE,
+  // Host code on the CPU thread, e.g. the interpreter or memory functions.
+  // address is PC, which is only exact for the interpreters.
+  FRAME_CPU_HOST,
+  FRAME_CORE_TIMING,
+  FRAME_VIDEO,
+  FRAME_DSP,
+  FRAME_OTHER,
+};
+
+constexpr u64 MakeKey(Frame frame, u32 address)
+{
+  return (static_cast<u64>(frame) << 32) | address;
+}
+
+// Samples are put into the first free slot of the ring by the signal handler,
+// and collected by the collector thread. Samples are dropped if the ring is
+// full, which is counted.
+constexpr size_t RING_SIZE = 0x4000;
+std::array<std::atomic<u64>, RING_SIZE> s_ring;
+std::atomic<u64> s_ring_position;
+std::atomic<u64> s_dropped_samples;
+
+std::atomic<bool> s_running{false};
+std::thread s_collector;
+Common::Event s_collector_wakeup;
+// Only touched by the collector thread while running.
+std::map<u64, u64> s_samples;
+
+void Collect()
+{
+  for (auto& slot : s_ring)
+  {
+    const u64 key = slot.exchange(0, std::memory_order_acquire);
+    if (key)
+      s_samples[key]++;
+  }
+}
+
+void CollectorThread()
+{
+  Common::SetCurrentThreadName("Sampling profiler");
+  while (s_running.load())
+  {
+    s_collector_wakeup.WaitFor(std::chrono::milliseconds(100));
+    Collect();
+  }
+}
+
+std::string GetFunctionName(u32 address)
+{
+  const Symbol* symbol = g_symbolDB.GetSymbolFromAddr(address);
+  if (!symbol)
+    return "[unknown function]";
+
+  // Frames are separated by semicolons.
+  std::string name = symbol->name;
+  std::replace(name.begin(), name.end(), ';', ',');
+  return name;
+}
+
+std::string GetStack(u64 key)
+{
+  const u32 address = static_cast<u32>(key);
+  switch (static_cast<Frame>(key >> 32))
+  {
+  case FRAME_JIT_BLOCK:
+    return StringFromFormat("CPU;JIT;%s;%08x", GetFunctionName(address).c_str(), address);
+  case FRAME_JIT_UNKNOWN_BLOCK:
+    return "CPU;JIT;[unknown block]";
+  case FRAME_JIT_ROUTINES:
+    return "CPU;JIT;[dispatcher and routines]";
+  case FRAME_JIT_FAR_CODE:
+    return "CPU;JIT;[far code and trampolines]";
+  case FRAME_CPU_HOST:
+    return "CPU;Host;" + GetFunctionName(address);
+  case FRAME_CORE_TIMING:
+    return "CPU;CoreTiming";
+  case FRAME_VIDEO:
+    return "Video";
+  case FRAME_DSP:
+    return "DSP";
+  case FRAME_OTHER:
+  default:
+    return "Other";
+  }
+}
+
+#ifdef SAMPLING_PROFILER_SUPPORTED
+thread_local Subsystem t_subsystem = Subsystem::Other;
+struct sigaction s_old_action;
+
+u64 GetCPUSample(const u8* host_pc)
+{
+  // The CPU thread is the only one changing the block cache, and it can't be
+  // doing that while running JIT code.
+  switch (jit ? jit->GetHostCodeType(host_pc) : JitBase::HostCode::None)
+  {
+  case JitBase::HostCode::Blocks:
+  {
+    const int block_num = jit->GetBlockCache()->GetBlockNumberFromHostAddress(host_pc);
+    if (block_num < 0)
+      return MakeKey(FRAME_JIT_UNKNOWN_BLOCK, 0);
+    return MakeKey(FRAME_JIT_BLOCK, jit->GetBlockCache()->GetBlock(block_num)->effectiveAddress);
+  }
+  case JitBase::HostCode::Routines:
+    return MakeKey(FRAME_JIT_ROUTINES, 0);
+  case JitBase::HostCode::FarCode:
+    return MakeKey(FRAME_JIT_FAR_CODE, 0);
+  case JitBase::HostCode::None:
+  default:
+    return MakeKey(FRAME_CPU_HOST, PC);
+  }
+}
+
+u64 GetSample(const u8* host_pc)
+{
+  switch (t_subsystem)
+  {
+  case Subsystem::CPU:
+    return GetCPUSample(host_pc);
+  case Subsystem::CoreTiming:
+    return MakeKey(FRAME_CORE_TIMING, 0);
+  case Subsystem::Video:
+    return MakeKey(FRAME_VIDEO, 0);
+  case Subsystem::DSP:
+    return MakeKey(FRAME_DSP, 0);
+  case Subsystem::Other:
+  default:
+    return MakeKey(FRAME_OTHER, 0);
+  }
+}
+
+void SignalHandler(int, siginfo_t*, void* raw_context)
+{
+  if (!s_running.load(std::memory_order_relaxed))
+    return;
+
+  const int saved_errno = errno;
+  ucontext_t* context = static_cast<ucontext_t*>(raw_context);
+#ifdef __OpenBSD__
+  SContext* ctx = context;
+#else
+  SContext* ctx = &context->uc_mcontext;
+#endif
+  const u64 key = GetSample(reinterpret_cast<const u8*>(ctx->CTX_PC));
+
+  const u64 position = s_ring_position.fetch_add(1, std::memory_order_relaxed);
+  u64 expected = 0;
+  if (!s_ring[position % RING_SIZE].compare_exchange_strong(expected, key,
+                                                             std::memory_order_release))
+  {
+    s_dropped_samples.fetch_add(1, std::memory_order_relaxed);
+  }
+  errno = saved_errno;
+}
+
+bool StartTimer(int samples_per_second)
+{
+  struct sigaction action = {};
+  action.sa_sigaction = &SignalHandler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, &s_old_action))
+    return false;
+
+  const long interval = std::max(1000000L / samples_per_second, 1L);
+  itimerval timer = {};
+  timer.it_interval.tv_sec = interval / 1000000;
+  timer.it_interval.tv_usec = interval % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr))
+  {
+    sigaction(SIGPROF, &s_old_action, nullptr);
+    return false;
+  }
+  return true;
+}
+
+void StopTimer()
+{
+  itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  // A signal which is still pending would kill the process with the default
+  // action, so it's only restored if something else installed a handler.
+  if (s_old_action.sa_handler != SIG_DFL)
+    sigaction(SIGPROF, &s_old_action, nullptr);
+}
+#endif
+}  // namespace
+
+#ifdef SAMPLING_PROFILER_SUPPORTED
+void SetThreadSubsystem(Subsystem subsystem)
+{
+  t_subsystem = subsystem;
+}
+
+Subsystem GetThreadSubsystem()
+{
+  return t_subsystem;
+}
+
+bool IsSupported()
+{
+  return true;
+}
+#else
+void SetThreadSubsystem(Subsystem subsystem)
+{
+}
+
+Subsystem GetThreadSubsystem()
+{
+  return Subsystem::Other;
+}
+
+bool IsSupported()
+{
+  return false;
+}
+#endif
+
+bool Start(int samples_per_second)
+{
+  if (s_running.load() || samples_per_second <= 0)
+    return false;
+
+#ifdef SAMPLING_PROFILER_SUPPORTED
+  for (auto& slot : s_ring)
+    slot.store(0);
+  s_ring_position = 0;
+  s_dropped_samples = 0;
+  s_samples.clear();
+
+  s_running = true;
+  s_collector = std::thread(CollectorThread);
+  if (!StartTimer(samples_per_second))
+  {
+    ERROR_LOG(POWERPC, "Sampling profiler: couldn't set up the profiling timer");
+    Stop();
+    return false;
+  }
+  INFO_LOG(POWERPC, "Sampling profiler: started with %d samples per second", samples_per_second);
+  return true;
+#else
+  ERROR_LOG(POWERPC, "Sampling profiler: not supported on this platform");
+  return false;
+#endif
+}
+
+void Stop()
+{
+  if (!s_running.load())
+    return;
+
+#ifdef SAMPLING_PROFILER_SUPPORTED
+  StopTimer();
+#endif
+  s_running = false;
+  s_collector_wakeup.Set();
+  s_collector.join();
+  Collect();
+
+  u64 total = 0;
+  for (const auto& sample : s_samples)
+    total += sample.second;
+  INFO_LOG(POWERPC, "Sampling profiler: stopped with %" PRIu64 " samples, %" PRIu64 " dropped",
+           total, s_dropped_samples.load());
+}
+
+bool IsRunning()
+{
+  return s_running.load();
+}
+
+void WriteReport(const std::string& filename)
+{
+  // Host code samples on the CPU thread at different PCs of the same function
+  // end up with the same stack.
+  std::map<std::string, u64> stacks;
+  for (const auto& sample : s_samples)
+    stacks[GetStack(sample.first)] += sample.second;
+
+  std::vector<std::pair<std::string, u64>> sorted(stacks.begin(), stacks.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b) { return a.second > b.second; });
+
+  File::IOFile f(filename, "w");
+  if (!f)
+  {
+    ERROR_LOG(POWERPC, "Sampling profiler: couldn't write %s", filename.c_str());
+    return;
+  }
+  for (const auto& stack : sorted)
+    fprintf(f.GetHandle(), "%s %" PRIu64 "\n", stack.first.c_str(), stack.second);
+}
+}
@@ -0,0 +1,60 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// A profiler which samples where the emulator spends its time from a timer
+// signal, instead of instrumenting the JIT blocks like Profiler does.
+//
+// Samples on the CPU thread are resolved to the JIT block (and through the
+// symbol map, the guest function) they interrupted. Every other sample is
+// only attributed to the subsystem its thread declared.
+namespace SamplingProfiler
+{
+enum class Subsystem : u8
+{
+  Other,
+  CPU,
+  CoreTiming,
+  Video,
+  DSP,
+};
+
+// Declares what the calling thread spends its time on.
+void SetThreadSubsystem(Subsystem subsystem);
+Subsystem GetThreadSubsystem();
+
+// Attributes the samples taken on this thread to another subsystem for the
+// lifetime of the object, e.g. for the DSP or the GPU on the CPU thread.
+class ScopedSubsystem final
+{
+public:
+  explicit ScopedSubsystem(Subsystem subsystem) : m_previous(GetThreadSubsystem())
+  {
+    SetThreadSubsystem(subsystem);
+  }
+  ~ScopedSubsystem() { SetThreadSubsystem(m_previous); }
+  ScopedSubsystem(const ScopedSubsystem&) = delete;
+  ScopedSubsystem& operator=(const ScopedSubsystem&) = delete;
+
+private:
+  Subsystem m_previous;
+};
+
+// Returns false if sampling isn't supported on this platform.
+bool IsSupported();
+
+// Starts taking samples_per_second samples per second of CPU time.
+bool Start(int samples_per_second);
+void Stop();
+bool IsRunning();
+
+// Writes the samples taken by the last run as collapsed stacks, one line per
+// stack followed by the number of samples, as read by flame graph tools.
+void WriteReport(const std::string& filename);
+}
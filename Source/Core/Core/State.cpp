@@ -71,7 +71,7 @@ static Common::Event g_compressAndDumpStateSyncEvent;
 static std::thread g_save_thread;
 
 // Don't forget to increase this after doing changes on the savestate system
-static const u32 STATE_VERSION = 65;  // Last changed in PR 4120
+static const u32 STATE_VERSION = 66;  // Last changed for the icache line memo
 
 // Maps savestate versions to Dolphin versions.
 // Versions after 42 don't need to be added to this list,
@@ -18,6 +18,7 @@
 #include "Core/HW/ProcessorInterface.h"
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/Fifo.h"
+#include "VideoCommon/Statistics.h"
 
 namespace CommandProcessor
 {
@@ -266,13 +267,15 @@ void RegisterMMIO(MMIO::Mapping* mmio, u32 base)
                                 MMIO::DirectWrite<u16>(MMIO::Utils::HighPart(&fifo.CPReadPointer)));
 }
 
-void GatherPipeBursted()
+void GatherPipeBursted(u32 bursts)
 {
-  SetCPStatusFromCPU();
+  INCSTAT(stats.thisFrame.numGatherPipeFlushes);
+  ADDSTAT(stats.thisFrame.numGatherPipeBursts, bursts);
 
   // if we aren't linked, we don't care about gather pipe data
   if (!m_CPCtrlReg.GPLinkEnable)
   {
+    SetCPStatusFromCPU();
     if (IsOnThread() && !Fifo::UseDeterministicGPUThread())
     {
       // In multibuffer mode is not allowed write in the same FIFO attached to the GPU.
@@ -288,10 +291,13 @@ void GatherPipeBursted()
   }
 
   // update the fifo pointer
-  if (fifo.CPWritePointer == fifo.CPEnd)
-    fifo.CPWritePointer = fifo.CPBase;
-  else
-    fifo.CPWritePointer += GATHER_PIPE_SIZE;
+  for (u32 i = 0; i < bursts; i++)
+  {
+    if (fifo.CPWritePointer == fifo.CPEnd)
+      fifo.CPWritePointer = fifo.CPBase;
+    else
+      fifo.CPWritePointer += GATHER_PIPE_SIZE;
+  }
 
   if (m_CPCtrlReg.GPReadEnable && m_CPCtrlReg.GPLinkEnable)
   {
@@ -300,6 +306,12 @@ void GatherPipeBursted()
     ProcessorInterface::Fifo_CPUEnd = fifo.CPEnd;
   }
 
+  // One burst at a time, the status would be checked before each of them. The distance only grows
+  // on this thread, so the check before the last burst is the one that counts.
+  if (bursts > 1)
+    Common::AtomicAdd(fifo.CPReadWriteDistance, GATHER_PIPE_SIZE * (bursts - 1));
+  SetCPStatusFromCPU();
+
   // If the game is running close to overflowing, make the exception checking more frequent.
   if (fifo.bFF_HiWatermark)
     CoreTiming::ForceExceptionCheck(0);
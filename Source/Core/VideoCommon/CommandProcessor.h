@@ -125,7 +125,8 @@ void RegisterMMIO(MMIO::Mapping* mmio, u32 base);
 
 void SetCPStatusFromGPU();
 void SetCPStatusFromCPU();
-void GatherPipeBursted();
+// Called once for any number of bursts written to the FIFO in one go.
+void GatherPipeBursted(u32 bursts);
 void UpdateInterrupts(u64 userdata);
 void UpdateInterruptsFromVideoBackend(u64 userdata);
 
@@ -20,6 +20,7 @@
 #include "Core/HW/SystemTimers.h"
 #include "Core/Host.h"
 #include "Core/NetPlayProto.h"
+#include "Core/SamplingProfiler.h"
 
 #include "VideoCommon/AsyncRequests.h"
 #include "VideoCommon/CPMemory.h"
@@ -294,6 +295,7 @@ void ResetVideoBuffer()
 // Purpose: Keep the Core HW updated about the CPU-GPU distance
 void RunGpuLoop()
 {
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::Video);
   AsyncRequests::GetInstance()->SetEnable(true);
   AsyncRequests::GetInstance()->SetPassthrough(false);
 
@@ -442,6 +444,7 @@ void RunGpu()
 
 static int RunGpuOnCpu(int ticks)
 {
+  SamplingProfiler::ScopedSubsystem profiler_scope(SamplingProfiler::Subsystem::Video);
   SCPFifoStruct& fifo = CommandProcessor::fifo;
   bool reset_simd_state = false;
   int available_ticks = int(ticks * SConfig::GetInstance().fSyncGpuOverclock) + s_sync_ticks.load();
@@ -67,6 +67,13 @@ std::string Statistics::ToString()
   str += StringFromFormat("Index streamed: %i kB\n", stats.thisFrame.bytesIndexStreamed / 1024);
   str += StringFromFormat("Uniform streamed: %i kB\n", stats.thisFrame.bytesUniformStreamed / 1024);
   str += StringFromFormat("Vertex Loaders: %i\n", stats.numVertexLoaders);
+  str += StringFromFormat("Gather pipe flushes: %i\n", stats.thisFrame.numGatherPipeFlushes);
+  if (stats.thisFrame.numGatherPipeFlushes)
+  {
+    str += StringFromFormat("Bursts per flush: %.2f\n",
+                            static_cast<float>(stats.thisFrame.numGatherPipeBursts) /
+                                stats.thisFrame.numGatherPipeFlushes);
+  }
 
   std::string vertex_list;
   VertexLoaderManager::AppendListToString(&vertex_list);
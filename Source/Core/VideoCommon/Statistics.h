@@ -61,6 +61,10 @@ struct Statistics
     int numVerticesLoaded;
     int tevPixelsIn;
     int tevPixelsOut;
+
+    // Counted on the CPU thread.
+    int numGatherPipeFlushes;
+    int numGatherPipeBursts;
   };
   ThisFrame thisFrame;
   void ResetFrame();
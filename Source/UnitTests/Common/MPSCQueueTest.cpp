@@ -0,0 +1,79 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/MPSCQueue.h"
+
+TEST(MPSCQueue, Simple)
+{
+  Common::MPSCQueue<u32, 8> q;
+  u32 v;
+
+  EXPECT_TRUE(q.Empty());
+  EXPECT_FALSE(q.Pop(v));
+
+  // Fill it up, then wrap around a few times.
+  for (u32 i = 0; i < 8; ++i)
+    EXPECT_TRUE(q.TryPush(i));
+  EXPECT_FALSE(q.TryPush(8u));
+  EXPECT_FALSE(q.Empty());
+
+  for (u32 i = 0; i < 100; ++i)
+  {
+    ASSERT_TRUE(q.Pop(v));
+    EXPECT_EQ(i, v);
+    EXPECT_TRUE(q.TryPush(i + 8));
+  }
+  for (u32 i = 100; i < 108; ++i)
+  {
+    ASSERT_TRUE(q.Pop(v));
+    EXPECT_EQ(i, v);
+  }
+  EXPECT_TRUE(q.Empty());
+  EXPECT_FALSE(q.Pop(v));
+}
+
+TEST(MPSCQueue, MultiThreaded)
+{
+  constexpr u32 NUM_WRITERS = 4;
+  constexpr u32 NUM_VALUES = 100000;
+  Common::MPSCQueue<u32, 64> q;
+
+  std::vector<std::thread> writers;
+  for (u32 writer = 0; writer < NUM_WRITERS; ++writer)
+  {
+    writers.emplace_back([&q, writer]() {
+      for (u32 i = 0; i < NUM_VALUES; ++i)
+      {
+        while (!q.TryPush((writer << 24) | i))
+          std::this_thread::yield();
+      }
+    });
+  }
+
+  // Every writer's values arrive complete and in order.
+  std::vector<u32> next(NUM_WRITERS, 0);
+  for (u32 received = 0; received < NUM_WRITERS * NUM_VALUES;)
+  {
+    u32 v;
+    if (!q.Pop(v))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    const u32 writer = v >> 24;
+    ASSERT_LT(writer, NUM_WRITERS);
+    ASSERT_EQ(next[writer], v & 0xFFFFFF);
+    next[writer]++;
+    received++;
+  }
+
+  for (std::thread& writer : writers)
+    writer.join();
+  EXPECT_TRUE(q.Empty());
+}
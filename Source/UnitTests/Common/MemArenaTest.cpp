@@ -0,0 +1,66 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
+
+namespace
+{
+void TestMirroredViews(bool huge_pages)
+{
+  constexpr size_t SIZE = 2 * Common::HUGE_PAGE_SIZE;
+
+  MemArena arena;
+  arena.GrabSHMSegment(SIZE, huge_pages);
+  u8* view = static_cast<u8*>(arena.CreateView(0, SIZE));
+  u8* mirror = static_cast<u8*>(arena.CreateView(0, SIZE));
+  u8* page = static_cast<u8*>(arena.CreateView(Common::HUGE_PAGE_SIZE, 0x1000));
+  ASSERT_NE(nullptr, view);
+  ASSERT_NE(nullptr, mirror);
+  ASSERT_NE(nullptr, page);
+
+  std::memset(view, 0x5A, SIZE);
+  view[Common::HUGE_PAGE_SIZE + 4] = 0x12;
+  EXPECT_EQ(0x5A, mirror[0]);
+  EXPECT_EQ(0x5A, mirror[SIZE - 1]);
+  EXPECT_EQ(0x12, mirror[Common::HUGE_PAGE_SIZE + 4]);
+  EXPECT_EQ(0x12, page[4]);
+  EXPECT_LE(Common::GetHugePageBytes(view, SIZE), SIZE);
+
+  arena.ReleaseView(page, 0x1000);
+  arena.ReleaseView(mirror, SIZE);
+  arena.ReleaseView(view, SIZE);
+  arena.ReleaseSHMSegment();
+}
+}  // namespace
+
+TEST(MemArena, MirroredViews)
+{
+  TestMirroredViews(false);
+}
+
+TEST(MemArena, MirroredViewsWithHugePages)
+{
+  TestMirroredViews(true);
+}
+
+TEST(MemoryUtil, HugePages)
+{
+  constexpr size_t SIZE = 4 * Common::HUGE_PAGE_SIZE;
+  u8* ptr = static_cast<u8*>(Common::AllocateMemoryPages(SIZE));
+  ASSERT_NE(nullptr, ptr);
+
+  // Whether there are huge pages depends on the OS, but they can't exceed the range.
+  if (Common::AdviseHugePages(ptr, SIZE))
+    std::memset(ptr, 1, SIZE);
+  EXPECT_LE(Common::GetHugePageBytes(ptr, SIZE), SIZE);
+  EXPECT_EQ(0u, Common::GetHugePageBytes(ptr, 0));
+
+  Common::FreeMemoryPages(ptr, SIZE);
+}
@@ -0,0 +1,49 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/WorkerPool.h"
+
+TEST(WorkerPool, SingleThreadRunsOnCaller)
+{
+  Common::WorkerPool pool(1, "Test worker");
+  EXPECT_EQ(1u, pool.GetNumThreads());
+
+  const std::thread::id caller = std::this_thread::get_id();
+  int calls = 0;
+  pool.Run([&](size_t index) {
+    EXPECT_EQ(0u, index);
+    EXPECT_EQ(caller, std::this_thread::get_id());
+    calls++;
+  });
+  EXPECT_EQ(1, calls);
+}
+
+TEST(WorkerPool, EveryThreadRunsOncePerCall)
+{
+  constexpr size_t NUM_THREADS = 4;
+  constexpr int NUM_RUNS = 2000;
+  Common::WorkerPool pool(NUM_THREADS, "Test worker");
+  EXPECT_EQ(NUM_THREADS, pool.GetNumThreads());
+
+  std::vector<int> calls(NUM_THREADS);
+  for (int run = 0; run < NUM_RUNS; ++run)
+  {
+    std::atomic<int> finished{0};
+    pool.Run([&](size_t index) {
+      calls[index]++;
+      finished++;
+    });
+    // All of them are done once Run returns.
+    EXPECT_EQ(static_cast<int>(NUM_THREADS), finished.load());
+  }
+
+  for (int count : calls)
+    EXPECT_EQ(NUM_RUNS, count);
+}
@@ -1005,6 +1005,17 @@ VEX_RMI_TEST(RORX)
       }                                                                                            \
   }
 
+AVX_RRM_TEST(VADDSD, "qword")
+AVX_RRM_TEST(VSUBSD, "qword")
+AVX_RRM_TEST(VMULSD, "qword")
+AVX_RRM_TEST(VDIVSD, "qword")
+AVX_RRM_TEST(VADDPD, "dqword")
+AVX_RRM_TEST(VSUBPD, "dqword")
+AVX_RRM_TEST(VMULPD, "dqword")
+AVX_RRM_TEST(VDIVPD, "dqword")
+AVX_RRM_TEST(VSQRTSD, "qword")
+AVX_RRM_TEST(VUNPCKLPD, "dqword")
+AVX_RRM_TEST(VUNPCKHPD, "dqword")
 AVX_RRM_TEST(VANDPS, "dqword")
 AVX_RRM_TEST(VANDPD, "dqword")
 AVX_RRM_TEST(VANDNPS, "dqword")
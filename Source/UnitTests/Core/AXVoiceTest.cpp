@@ -0,0 +1,362 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/MathUtil.h"
+#include "Common/WorkerPool.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/DSP.h"
+#include "Core/HW/DSPHLE/DSPHLE.h"
+
+#define AX_WII
+#include "Core/HW/DSPHLE/UCodes/AXVoice.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+constexpr u32 ARAM_SAMPLES_BASE = 0x100000;
+
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    SConfig::Init();
+    CoreTiming::Init();
+    DSP::Init(true);
+    DSP::GetDSPEmulator()->Initialize(false, false);
+
+    // Random sample data and ADPCM headers.
+    std::mt19937 rng(1234);
+    for (u32 i = 0; i < 0x40000; ++i)
+      DSP::WriteARAM(static_cast<u8>(rng()), ARAM_SAMPLES_BASE + i);
+  }
+  ~ScopeInit()
+  {
+    DSP::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+  }
+};
+
+// Makes a running PB like the ones games use: looping ADPCM or PCM sound effects and music,
+// mostly resampled linearly, with volume ramps.
+AXPBWii MakePB(std::mt19937& rng)
+{
+  AXPBWii pb = {};
+  pb.running = 1;
+  pb.src_type = rng() % 8 == 0 ? SRCTYPE_NEAREST : SRCTYPE_LINEAR;
+
+  const u32 format = rng() % 10;
+  pb.audio_addr.sample_format =
+      format < 6 ? AUDIOFORMAT_ADPCM : format < 9 ? AUDIOFORMAT_PCM16 : AUDIOFORMAT_PCM8;
+  pb.audio_addr.looping = 1;
+  pb.is_stream = rng() % 4 == 0;
+
+  // Addresses are in nibbles for ADPCM, in samples otherwise.
+  const u32 unit = pb.audio_addr.sample_format == AUDIOFORMAT_ADPCM ? 2 :
+                   pb.audio_addr.sample_format == AUDIOFORMAT_PCM16 ? 1 : 2;
+  const u32 start = ARAM_SAMPLES_BASE / 2 * unit + (rng() % 0x1000) * 16;
+  const u32 length = 0x100 + (rng() % 0x800) * 16;
+  const u32 loop = start + 2;
+  const u32 end = start + length - 1;
+  const u32 cur = start + 2 + (rng() % (length / 16)) * 16;
+  pb.audio_addr.loop_addr_hi = loop >> 16;
+  pb.audio_addr.loop_addr_lo = loop & 0xFFFF;
+  pb.audio_addr.end_addr_hi = end >> 16;
+  pb.audio_addr.end_addr_lo = end & 0xFFFF;
+  pb.audio_addr.cur_addr_hi = cur >> 16;
+  pb.audio_addr.cur_addr_lo = cur & 0xFFFF;
+
+  for (s16& coef : pb.adpcm.coefs)
+    coef = static_cast<s16>(rng() % 0x1000) - 0x800;
+  pb.adpcm.pred_scale = rng() & 0x7F;
+  pb.adpcm_loop_info.pred_scale = rng() & 0x7F;
+
+  const u32 ratio = 0x4000 + rng() % 0x1C000;
+  pb.src.ratio_hi = ratio >> 16;
+  pb.src.ratio_lo = ratio & 0xFFFF;
+  pb.src.cur_addr_frac = rng() & 0xFFFF;
+
+  pb.vol_env.cur_volume = 0x4000 + rng() % 0x4000;
+  pb.vol_env.cur_volume_delta = static_cast<s16>(rng() % 64) - 32;
+
+  u16* mixer = reinterpret_cast<u16*>(&pb.mixer);
+  for (size_t i = 0; i < sizeof(pb.mixer) / sizeof(u16); i += 2)
+  {
+    mixer[i] = rng() & 0xFFFF;
+    mixer[i + 1] = static_cast<u16>(static_cast<s16>(rng() % 16) - 8);
+  }
+
+  pb.remote = rng() % 8 == 0;
+  pb.remote_mixer_control = rng() & 0xFFFF;
+  u16* remote_mixer = reinterpret_cast<u16*>(&pb.remote_mixer);
+  for (size_t i = 0; i < sizeof(pb.remote_mixer) / sizeof(u16); ++i)
+    remote_mixer[i] = rng() & 0xFFFF;
+  return pb;
+}
+
+u32 MakeMixerControl(std::mt19937& rng)
+{
+  // Main and AUXA with ramps are the most common.
+  u32 mctrl = MIX_L | MIX_L_RAMP | MIX_R | MIX_R_RAMP;
+  if (rng() % 2)
+    mctrl |= MIX_AUXA_L | MIX_AUXA_L_RAMP | MIX_AUXA_R | MIX_AUXA_R_RAMP;
+  if (rng() % 4 == 0)
+    mctrl |= MIX_S | MIX_AUXB_L | MIX_AUXB_R;
+  return mctrl;
+}
+
+struct MixBuffers
+{
+  std::array<std::array<int, MAX_SAMPLES_PER_FRAME>, 20> buffers{};
+
+  AXBuffers Get()
+  {
+    AXBuffers ax_buffers;
+    for (size_t i = 0; i < buffers.size(); ++i)
+      ax_buffers.ptrs[i] = buffers[i].data();
+    return ax_buffers;
+  }
+};
+}  // namespace
+
+TEST(AXVoice, BlockDecodeMatchesAccelerator)
+{
+  ScopeInit guard;
+
+  std::mt19937 rng(1);
+  for (int test = 0; test < 2000; ++test)
+  {
+    AXPBWii pb = MakePB(rng);
+    pb.audio_addr.looping = rng() % 2;
+    // Close to the end, so that it's reached in the middle of the block every now and then.
+    const u32 end = HILO_TO_32(pb.audio_addr.end_addr);
+    const u32 cur = end - rng() % 300;
+    pb.audio_addr.cur_addr_hi = cur >> 16;
+    pb.audio_addr.cur_addr_lo = cur & 0xFFFF;
+    const u32 count = 1 + rng() % MAX_INPUT_SAMPLES;
+
+    AXPBWii expected_pb = pb;
+    u32 expected_addr = cur;
+    AcceleratorState expected_acc;
+    AcceleratorSetup(expected_acc, &expected_pb, &expected_addr);
+    std::vector<s16> expected(count);
+    for (s16& sample : expected)
+      sample = AcceleratorGetSample(expected_acc);
+
+    u32 addr = cur;
+    AcceleratorState acc;
+    AcceleratorSetup(acc, &pb, &addr);
+    std::vector<s16> samples(count);
+    AcceleratorGetSamples(acc, samples.data(), count);
+
+    EXPECT_EQ(expected, samples);
+    EXPECT_EQ(expected_addr, addr);
+    EXPECT_EQ(0, memcmp(&expected_pb, &pb, sizeof(pb)));
+  }
+}
+
+TEST(AXVoice, BlockResampleMatchesStreamed)
+{
+  std::mt19937 rng(2);
+  for (int test = 0; test < 20000; ++test)
+  {
+    const u32 count = 4 + rng() % (MAX_SAMPLES_PER_FRAME - 3);
+    const u32 ratio = test % 4 == 0 ? rng() % 0x80000 : rng() % 0x30000;
+    const u32 curr_pos = rng() & 0xFFFF;
+    const int srctype = rng() % 3;
+    const u32 input_count = GetInputSampleCount(count, curr_pos, ratio, srctype);
+    if (input_count > MAX_INPUT_SAMPLES)
+      continue;
+
+    std::vector<s16> input(input_count);
+    for (s16& sample : input)
+      sample = static_cast<s16>(rng());
+    std::array<s16, 4> last_samples;
+    for (s16& sample : last_samples)
+      sample = static_cast<s16>(rng());
+
+    std::array<s16, 4> expected_last_samples = last_samples;
+    std::vector<s16> expected(count);
+    u32 read_count = 0;
+    const u32 expected_pos = ResampleAudioStreamed(
+        [&](u32 i) {
+          read_count = i + 1;
+          return input[i];
+        },
+        expected.data(), count, expected_last_samples.data(), curr_pos, ratio, srctype);
+    if (srctype == SRCTYPE_LINEAR || srctype == SRCTYPE_POLYPHASE)
+    {
+      EXPECT_EQ(input_count, read_count);
+    }
+
+    std::vector<s16> output(count);
+    const u32 pos = ResampleAudio(input.data(), output.data(), count, last_samples.data(),
+                                  curr_pos, ratio, srctype);
+
+    EXPECT_EQ(expected, output);
+    EXPECT_EQ(expected_last_samples, last_samples);
+    EXPECT_EQ(expected_pos, pos);
+  }
+}
+
+TEST(AXVoice, MixAddMatchesScalar)
+{
+  std::mt19937 rng(3);
+  for (int test = 0; test < 20000; ++test)
+  {
+    const u32 count = rng() % (MAX_SAMPLES_PER_FRAME + 1);
+    std::vector<s16> input(count);
+    for (s16& sample : input)
+      sample = static_cast<s16>(rng());
+    std::vector<int> out(count);
+    for (int& sample : out)
+      sample = static_cast<int>(rng() % 0x40000) - 0x20000;
+    u16 vol[2] = {static_cast<u16>(rng()), static_cast<u16>(rng())};
+    if (test % 2)
+      vol[1] = static_cast<u16>(static_cast<s16>(rng() % 64) - 32);
+    const bool ramp = rng() % 4 != 0;
+    s16 dpop = 0x1234;
+
+    std::vector<int> expected = out;
+    u16 expected_volume = vol[0];
+    s16 expected_dpop = dpop;
+    for (u32 i = 0; i < count; ++i)
+    {
+      s32 value = MathUtil::Clamp((input[i] * expected_volume) >> 15, -32767, 32767);
+      expected[i] += static_cast<s16>(value);
+      expected_dpop = value;
+      if (ramp)
+        expected_volume += vol[1];
+    }
+
+    MixAdd(out.data(), input.data(), count, vol, &dpop, ramp);
+
+    EXPECT_EQ(expected, out);
+    EXPECT_EQ(expected_volume, vol[0]);
+    EXPECT_EQ(expected_dpop, dpop);
+  }
+}
+
+// Replays 64 voices for a few seconds of 3 ms frames, as AXWii processes them.
+TEST(AXVoice, ProcessVoiceBenchmark)
+{
+  ScopeInit guard;
+
+  constexpr u32 NUM_VOICES = 64;
+  constexpr u32 NUM_FRAMES = 2000;
+
+  std::mt19937 rng(42);
+  std::vector<AXPBWii> pbs;
+  std::vector<u32> mixer_controls;
+  for (u32 i = 0; i < NUM_VOICES; ++i)
+  {
+    pbs.push_back(MakePB(rng));
+    mixer_controls.push_back(MakeMixerControl(rng));
+  }
+
+  MixBuffers buffers;
+  const auto start = std::chrono::steady_clock::now();
+  for (u32 frame = 0; frame < NUM_FRAMES; ++frame)
+  {
+    for (u32 i = 0; i < NUM_VOICES; ++i)
+    {
+      ProcessVoice(pbs[i], buffers.Get(), MAX_SAMPLES_PER_FRAME,
+                   static_cast<AXMixControl>(mixer_controls[i]), nullptr);
+    }
+  }
+  const std::chrono::duration<double, std::micro> time = std::chrono::steady_clock::now() - start;
+
+  // Covers the output and the state left in the PBs, which has to stay exactly the same.
+  u64 checksum = 0;
+  for (const auto& buffer : buffers.buffers)
+  {
+    for (int sample : buffer)
+      checksum = checksum * 31 + static_cast<u32>(sample);
+  }
+  for (const AXPBWii& pb : pbs)
+  {
+    const u16* data = reinterpret_cast<const u16*>(&pb);
+    for (size_t i = 0; i < sizeof(pb) / sizeof(u16); ++i)
+      checksum = checksum * 31 + data[i];
+  }
+  printf("%u voices: %.1f us per 3 ms frame, checksum %016llx\n", NUM_VOICES,
+         time.count() / NUM_FRAMES, static_cast<unsigned long long>(checksum));
+  EXPECT_EQ(0xb729180036dc895dULL, checksum);
+}
+
+// Processes the same voices one after the other and on a few threads, which has to give exactly
+// the same output and PBs.
+TEST(AXVoice, ParallelMatchesSerial)
+{
+  ScopeInit guard;
+
+  constexpr u32 NUM_VOICES = 64;
+  constexpr u32 NUM_FRAMES = 500;
+  constexpr size_t NUM_THREADS = 4;
+
+  std::mt19937 rng(7);
+  std::vector<AXPBWii> serial_pbs;
+  std::vector<u32> mixer_controls;
+  for (u32 i = 0; i < NUM_VOICES; ++i)
+  {
+    serial_pbs.push_back(MakePB(rng));
+    serial_pbs.back().audio_addr.looping = rng() % 4 != 0;
+    mixer_controls.push_back(MakeMixerControl(rng));
+  }
+  std::vector<AXPBWii> parallel_pbs = serial_pbs;
+
+  MixBuffers serial_buffers;
+  auto start = std::chrono::steady_clock::now();
+  for (u32 frame = 0; frame < NUM_FRAMES; ++frame)
+  {
+    for (u32 i = 0; i < NUM_VOICES; ++i)
+    {
+      ProcessVoice(serial_pbs[i], serial_buffers.Get(), MAX_SAMPLES_PER_FRAME,
+                   static_cast<AXMixControl>(mixer_controls[i]), nullptr);
+    }
+  }
+  const std::chrono::duration<double, std::micro> serial_time =
+      std::chrono::steady_clock::now() - start;
+
+  Common::WorkerPool workers(NUM_THREADS, "AX voice worker");
+  MixBuffers parallel_buffers;
+  std::vector<int> thread_buffers;
+  u32 buffer_sizes[20];
+  std::fill(std::begin(buffer_sizes), std::end(buffer_sizes), MAX_SAMPLES_PER_FRAME);
+  start = std::chrono::steady_clock::now();
+  for (u32 frame = 0; frame < NUM_FRAMES; ++frame)
+  {
+    ProcessPBsInParallel(workers, parallel_pbs, parallel_buffers.Get(), buffer_sizes,
+                         thread_buffers, [&](AXPBWii& pb, const AXBuffers& buffers) {
+                           const size_t i = &pb - parallel_pbs.data();
+                           ProcessVoice(pb, buffers, MAX_SAMPLES_PER_FRAME,
+                                        static_cast<AXMixControl>(mixer_controls[i]), nullptr);
+                         });
+  }
+  const std::chrono::duration<double, std::micro> parallel_time =
+      std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(serial_buffers.buffers, parallel_buffers.buffers);
+  for (u32 i = 0; i < NUM_VOICES; ++i)
+    EXPECT_EQ(0, memcmp(&serial_pbs[i], &parallel_pbs[i], sizeof(AXPBWii)));
+
+  printf("%u voices: %.1f us per frame serially, %.1f us on %zu threads (%u host threads)\n",
+         NUM_VOICES, serial_time.count() / NUM_FRAMES, parallel_time.count() / NUM_FRAMES,
+         NUM_THREADS, std::thread::hardware_concurrency());
+}
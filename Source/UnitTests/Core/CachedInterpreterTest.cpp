@@ -0,0 +1,165 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(PowerPC::CORE_CACHEDINTERPRETER);
+  }
+  ~ScopeInit()
+  {
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+constexpr u32 CODE_ADDRESS = 0x3000;
+constexpr u32 DATA_ADDRESS = 0x4000;
+
+constexpr u32 DForm(u32 opcd, u32 d, u32 a, u32 imm)
+{
+  return (opcd << 26) | (d << 21) | (a << 16) | (imm & 0xFFFF);
+}
+
+constexpr u32 XForm(u32 d, u32 a, u32 b, u32 subop)
+{
+  return (31 << 26) | (d << 21) | (a << 16) | (b << 11) | (subop << 1);
+}
+
+constexpr u32 Rlwinm(u32 a, u32 s, u32 sh, u32 mb, u32 me)
+{
+  return (21 << 26) | (s << 21) | (a << 16) | (sh << 11) | (mb << 6) | (me << 1);
+}
+
+constexpr u32 Bc(u32 bo, u32 bi, s32 offset)
+{
+  return (16 << 26) | (bo << 21) | (bi << 16) | (offset & 0xFFFC);
+}
+
+// A loop body made of the instructions the cached interpreter decodes, with an rlwinm chain and
+// a load, compare and branch at the end. It is one block, run once per iteration.
+const std::array<u32, 14> LOOP{{
+    DForm(14, 3, 3, 1),             // addi r3, r3, 1
+    Rlwinm(6, 3, 2, 0, 29),         // rlwinm r6, r3, 2, 0, 29
+    Rlwinm(6, 6, 0, 16, 31),        // rlwinm r6, r6, 0, 16, 31
+    XForm(7, 7, 6, 266),            // add r7, r7, r6
+    DForm(24, 7, 8, 0x10),          // ori r8, r7, 0x10
+    DForm(36, 7, 4, 4),             // stw r7, 4(r4)
+    DForm(32, 5, 4, 4),             // lwz r5, 4(r4)
+    XForm(5, 9, 8, 444),            // or r9, r5, r8
+    DForm(11, 1 << 2, 9, u32(-5)),  // cmpwi cr1, r9, -5
+    DForm(10, 2 << 2, 8, 0x100),    // cmplwi cr2, r8, 0x100
+    DForm(36, 3, 4, 8),             // stw r3, 8(r4)
+    DForm(32, 5, 4, 8),             // lwz r5, 8(r4)
+    XForm(0, 5, 10, 0),             // cmpw r5, r10
+    Bc(12, 0, -52),                 // blt 0x3000
+}};
+
+struct State
+{
+  std::array<u32, 32> gpr;
+  u32 cr;
+  u32 pc;
+  u32 stored_value;
+};
+
+// Runs the loop for iterations blocks, with or without the decoded ops, and returns how long it
+// took.
+std::chrono::duration<double> RunLoop(u32 iterations, bool decoded_ops, State* state)
+{
+  SConfig::GetInstance().bJITOff = !decoded_ops;
+  JitInterface::ClearCache();
+
+  for (size_t i = 0; i < LOOP.size(); i++)
+    Memory::Write_U32(LOOP[i], CODE_ADDRESS + static_cast<u32>(i * 4));
+
+  PowerPC::ppcState.pc = CODE_ADDRESS;
+  PowerPC::ppcState.npc = CODE_ADDRESS + 4;
+  std::fill(std::begin(PowerPC::ppcState.gpr), std::end(PowerPC::ppcState.gpr), 0);
+  PowerPC::ppcState.gpr[4] = DATA_ADDRESS;
+  PowerPC::ppcState.gpr[7] = 0x7FFFFF00;
+  PowerPC::ppcState.gpr[10] = iterations;
+  // Compares copy the summary overflow bit.
+  SetXER_SO(1);
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (u32 i = 0; i < iterations; i++)
+    PowerPC::SingleStep();
+  const auto end = std::chrono::high_resolution_clock::now();
+
+  std::copy(std::begin(PowerPC::ppcState.gpr), std::end(PowerPC::ppcState.gpr),
+            state->gpr.begin());
+  state->cr = GetCR();
+  state->pc = PowerPC::ppcState.pc;
+  state->stored_value = Memory::Read_U32(DATA_ADDRESS + 4);
+  return end - start;
+}
+
+void ExpectSameState(const State& a, const State& b)
+{
+  for (size_t i = 0; i < a.gpr.size(); i++)
+    EXPECT_EQ(a.gpr[i], b.gpr[i]) << "r" << i;
+  EXPECT_EQ(a.cr, b.cr);
+  EXPECT_EQ(a.pc, b.pc);
+  EXPECT_EQ(a.stored_value, b.stored_value);
+}
+}  // namespace
+
+TEST(CachedInterpreter, DecodedOpsMatchInterpreter)
+{
+  ScopeInit guard;
+
+  State interpreted, decoded;
+  RunLoop(1000, false, &interpreted);
+  RunLoop(1000, true, &decoded);
+
+  EXPECT_EQ(1000u, decoded.gpr[3]);
+  EXPECT_EQ(CODE_ADDRESS + LOOP.size() * 4, decoded.pc);
+  ExpectSameState(interpreted, decoded);
+}
+
+TEST(CachedInterpreter, Benchmark)
+{
+  ScopeInit guard;
+
+  constexpr u32 ITERATIONS = 1000000;
+  State interpreted, decoded;
+  const double interpreted_seconds = RunLoop(ITERATIONS, false, &interpreted).count();
+  const double decoded_seconds = RunLoop(ITERATIONS, true, &decoded).count();
+  ExpectSameState(interpreted, decoded);
+
+  // Every block also enters a new timing slice, which both cases pay for.
+  const double instructions = double(ITERATIONS) * LOOP.size();
+  printf("Interpreter ops: %.1f MIPS\n", instructions / interpreted_seconds / 1e6);
+  printf("Decoded ops: %.1f MIPS (%.2fx)\n", instructions / decoded_seconds / 1e6,
+         interpreted_seconds / decoded_seconds);
+}
@@ -4,9 +4,17 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
 
+#include "Common/ChunkFile.h"
+#include "Common/StringUtil.h"
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -335,3 +343,218 @@ TEST(CoreTiming, Overclocking)
   SConfig::GetInstance().m_OCFactor = 1.0;
   AdvanceAndCheck(4, MAX_SLICE_LENGTH);
 }
+
+TEST(CoreTiming, RemoveEvent)
+{
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb_a = CoreTiming::RegisterEvent("callbackA", CallbackTemplate<0>);
+  CoreTiming::EventType* cb_b = CoreTiming::RegisterEvent("callbackB", CallbackTemplate<1>);
+  CoreTiming::EventType* cb_c = CoreTiming::RegisterEvent("callbackC", CallbackTemplate<2>);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  CoreTiming::ScheduleEvent(100, cb_a, CB_IDS[0]);
+  CoreTiming::ScheduleEvent(200, cb_b, CB_IDS[1]);
+  CoreTiming::ScheduleEvent(300, cb_c, CB_IDS[2]);
+  CoreTiming::ScheduleEvent(400, cb_c, CB_IDS[2]);
+  EXPECT_EQ(100, PowerPC::ppcState.downcount);
+
+  // Removing the first event doesn't update the downcount before the next Advance().
+  CoreTiming::RemoveEvent(cb_a);
+  CoreTiming::RemoveEvent(cb_c);
+  CoreTiming::ScheduleEvent(500, cb_a, CB_IDS[0]);
+
+  s_callbacks_ran_flags = 0;
+  PowerPC::ppcState.downcount = 0;
+  CoreTiming::Advance();
+  EXPECT_EQ(0u, s_callbacks_ran_flags.count());
+  EXPECT_EQ(100, PowerPC::ppcState.downcount);
+
+  AdvanceAndCheck(1, 300);
+  AdvanceAndCheck(0, MAX_SLICE_LENGTH);
+}
+
+TEST(CoreTiming, SaveState)
+{
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb_a = CoreTiming::RegisterEvent("callbackA", CallbackTemplate<0>);
+  CoreTiming::EventType* cb_b = CoreTiming::RegisterEvent("callbackB", CallbackTemplate<1>);
+  CoreTiming::EventType* cb_c = CoreTiming::RegisterEvent("callbackC", CallbackTemplate<2>);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  CoreTiming::ScheduleEvent(300, cb_c, CB_IDS[2]);
+  CoreTiming::ScheduleEvent(200, cb_b, CB_IDS[1]);
+  CoreTiming::ScheduleEvent(100, cb_a, CB_IDS[0]);
+  CoreTiming::RemoveEvent(cb_b);
+
+  u8* ptr = nullptr;
+  PointerWrap p_measure(&ptr, PointerWrap::MODE_MEASURE);
+  CoreTiming::DoState(p_measure);
+  std::vector<u8> buffer(reinterpret_cast<size_t>(ptr));
+  ptr = buffer.data();
+  PointerWrap p_write(&ptr, PointerWrap::MODE_WRITE);
+  CoreTiming::DoState(p_write);
+
+  CoreTiming::ClearPendingEvents();
+  ptr = buffer.data();
+  PointerWrap p_read(&ptr, PointerWrap::MODE_READ);
+  CoreTiming::DoState(p_read);
+  EXPECT_EQ(buffer.data() + buffer.size(), ptr);
+
+  AdvanceAndCheck(0, 200, 0, PowerPC::ppcState.downcount - 100);
+  AdvanceAndCheck(2, MAX_SLICE_LENGTH);
+}
+
+namespace RescheduleBenchmark
+{
+constexpr u32 NUM_HOT_EVENTS = 8;
+constexpr u32 NUM_IDLE_EVENTS = 32;
+constexpr u32 NUM_RESCHEDULES = 2000000;
+
+static std::array<CoreTiming::EventType*, NUM_HOT_EVENTS> s_hot_events;
+static u32 s_callbacks;
+
+static s64 GetPeriod(u64 userdata)
+{
+  return 1000 + static_cast<s64>(userdata) * 37;
+}
+
+static void HotCallback(u64 userdata, s64 lateness)
+{
+  s_callbacks++;
+  CoreTiming::ScheduleEvent(GetPeriod(userdata) - lateness, s_hot_events[userdata], userdata);
+}
+}
+
+// Hardware like the VI, SI and DSP keeps removing and rescheduling its events, while a few others
+// wait far in the future.
+TEST(CoreTiming, RescheduleBenchmark)
+{
+  using namespace RescheduleBenchmark;
+
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb_idle = CoreTiming::RegisterEvent("idle", CallbackTemplate<0>);
+  for (u32 i = 0; i < NUM_HOT_EVENTS; i++)
+    s_hot_events[i] = CoreTiming::RegisterEvent(StringFromFormat("hot%u", i), HotCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  for (u32 i = 0; i < NUM_IDLE_EVENTS; i++)
+    CoreTiming::ScheduleEvent(INT64_C(1) << 40, cb_idle, CB_IDS[0]);
+  for (u32 i = 0; i < NUM_HOT_EVENTS; i++)
+    CoreTiming::ScheduleEvent(GetPeriod(i), s_hot_events[i], i);
+
+  s_callbacks = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (u32 i = 0; i < NUM_RESCHEDULES; i++)
+  {
+    const u32 event = i % NUM_HOT_EVENTS;
+    CoreTiming::RemoveEvent(s_hot_events[event]);
+    CoreTiming::ScheduleEvent(GetPeriod(event) / 2, s_hot_events[event], event);
+    PowerPC::ppcState.downcount = 0;
+    CoreTiming::Advance();
+  }
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  EXPECT_NE(0u, s_callbacks);
+  printf("%.2f million reschedules per second, %u callbacks\n",
+         NUM_RESCHEDULES / time.count() / 1e6, s_callbacks);
+
+  for (CoreTiming::EventType* event : s_hot_events)
+    CoreTiming::RemoveEvent(event);
+  CoreTiming::RemoveEvent(cb_idle);
+  PowerPC::ppcState.downcount = 0;
+  CoreTiming::Advance();
+  EXPECT_EQ(MAX_SLICE_LENGTH, PowerPC::ppcState.downcount);
+}
+
+namespace ThreadSafeTest
+{
+constexpr u32 NUM_THREADS = 4;
+constexpr u32 NUM_EVENTS = 50000;
+constexpr u32 NUM_ROUND_TRIPS = 2000;
+
+using Clock = std::chrono::steady_clock;
+static std::array<u32, NUM_THREADS> s_next_event;
+static std::atomic<u32> s_received;
+
+static void Callback(u64 userdata, s64 lateness)
+{
+  const u32 thread = static_cast<u32>(userdata >> 32);
+  const u32 event = static_cast<u32>(userdata);
+
+  // The events of each thread arrive in order.
+  EXPECT_EQ(s_next_event[thread], event);
+  s_next_event[thread]++;
+  s_received++;
+}
+
+// Runs the CPU thread's side until the given number of events arrived.
+static void AdvanceUntilReceived(u32 count)
+{
+  while (s_received.load() < count)
+  {
+    PowerPC::ppcState.downcount = 0;
+    CoreTiming::Advance();
+    std::this_thread::yield();
+  }
+}
+}
+
+// The threads schedule much faster than the CPU thread takes their events, so this also goes
+// through the overflow when the queue is full.
+TEST(CoreTiming, ThreadSafeBenchmark)
+{
+  using namespace ThreadSafeTest;
+
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb = CoreTiming::RegisterEvent("callback", Callback);
+  CoreTiming::Advance();
+
+  // Throughput of several threads scheduling at once.
+  s_next_event.fill(0);
+  s_received = 0;
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (u64 thread = 0; thread < NUM_THREADS; thread++)
+  {
+    threads.emplace_back([cb, thread] {
+      for (u32 i = 0; i < NUM_EVENTS; i++)
+        CoreTiming::ScheduleEvent(0, cb, (thread << 32) | i, CoreTiming::FromThread::NON_CPU);
+    });
+  }
+  AdvanceUntilReceived(NUM_THREADS * NUM_EVENTS);
+  const std::chrono::duration<double> throughput_time = Clock::now() - start;
+  for (std::thread& thread : threads)
+    thread.join();
+  for (u32 next_event : s_next_event)
+    EXPECT_EQ(NUM_EVENTS, next_event);
+
+  // Latency from scheduling an event to its callback, one event at a time.
+  s_next_event.fill(0);
+  s_received = 0;
+  start = Clock::now();
+  std::thread thread([cb] {
+    for (u32 i = 0; i < NUM_ROUND_TRIPS; i++)
+    {
+      CoreTiming::ScheduleEvent(0, cb, i, CoreTiming::FromThread::NON_CPU);
+      while (s_received.load() <= i)
+        std::this_thread::yield();
+    }
+  });
+  AdvanceUntilReceived(NUM_ROUND_TRIPS);
+  const std::chrono::duration<double, std::micro> latency_time = Clock::now() - start;
+  thread.join();
+
+  printf("%u threads: %.2f million events per second\n", NUM_THREADS,
+         NUM_THREADS * NUM_EVENTS / throughput_time.count() / 1e6);
+  printf("Round trip: %.2f us per event\n", latency_time.count() / NUM_ROUND_TRIPS);
+}
@@ -0,0 +1,240 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Common/MsgHandler.h"
+#include "Core/ConfigManager.h"
+#include "Core/DSP/DSPCaptureLogger.h"
+#include "Core/DSP/DSPCodeUtil.h"
+#include "Core/DSP/DSPCore.h"
+#include "Core/DSP/DSPHWInterface.h"
+#include "Core/DSP/DSPTables.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+// Scales a buffer of samples from DRAM into another one a number of times and halts, with a block
+// loop of extended instructions like the inner loops of AX.
+const char MIX_CODE[] = R"(
+	lri	$AC1.M, #100
+frame:
+	lri	$AR0, #0x0100
+	lri	$AR3, #0x0200
+	lri	$AX1.H, #0x4000
+	lrri	$AX0.H, @$AR0
+	bloopi	#127, mix_end
+	mulx'l	$AX0.H, $AX1.H : $AX0.H, @$AR0
+	movp'ir	$ACC0 : $AR1
+mix_end:
+	srri	@$AR3, $AC0.M
+	decm	$AC1.M
+	jnz	frame
+	halt
+)";
+
+struct CapturedDMA
+{
+  u16 control;
+  u32 gc_address;
+  u16 dsp_address;
+  std::vector<u8> data;
+};
+
+// Keeps the DMAs to the DSP, which is all a ucode capture needs to be replayed.
+class DMARecorder final : public DefaultDSPCaptureLogger
+{
+public:
+  explicit DMARecorder(std::vector<CapturedDMA>* dmas) : m_dmas(dmas) {}
+  void LogDMA(u16 control, u32 gc_address, u16 dsp_address, u16 length, const u8* data) override
+  {
+    if (control & DSP_CR_TO_CPU)
+      return;
+    m_dmas->push_back({control, gc_address, dsp_address, std::vector<u8>(data, data + length)});
+  }
+
+private:
+  std::vector<CapturedDMA>* m_dmas;
+};
+
+bool NoAlerts(const char*, const char*, bool, int)
+{
+  return false;
+}
+
+class ScopeInit final
+{
+public:
+  ScopeInit(DSPInitOptions::CoreType core_type, DSPCaptureLogger* capture_logger = nullptr)
+      : m_ram(0x10000)
+  {
+    SConfig::Init();
+    RegisterMsgAlertHandler(NoAlerts);
+    InitInstructionTable();
+
+    DSPInitOptions options;
+    options.irom_contents.fill(0);
+    options.coef_contents.fill(0);
+    options.core_type = core_type;
+    if (capture_logger)
+    {
+      delete options.capture_logger;
+      options.capture_logger = capture_logger;
+    }
+    m_initialized = DSPCore_Init(options);
+    g_dsp.cpu_ram = m_ram.data();
+  }
+  ~ScopeInit()
+  {
+    DSPCore_Shutdown();
+    RegisterMsgAlertHandler(nullptr);
+    SConfig::Shutdown();
+  }
+  bool Initialized() const { return m_initialized; }
+
+private:
+  bool m_initialized;
+  std::vector<u8> m_ram;
+};
+
+// Copies words in DSP order to main memory and has the DSP fetch them, the way ucodes are loaded.
+void DMAToDSP(u16 control, u32 gc_address, u16 dsp_address, const u16* words, u16 num_words)
+{
+  for (u16 i = 0; i < num_words; ++i)
+  {
+    const u16 swapped = Common::swap16(words[i]);
+    std::memcpy(g_dsp.cpu_ram + gc_address + i * 2, &swapped, sizeof(swapped));
+  }
+
+  gdsp_ifx_write(DSP_DSMAH, gc_address >> 16);
+  gdsp_ifx_write(DSP_DSMAL, gc_address & 0xffff);
+  gdsp_ifx_write(DSP_DSPA, dsp_address / 2);
+  gdsp_ifx_write(DSP_DSCR, control);
+  gdsp_ifx_write(DSP_DSBL, num_words * 2);
+}
+
+void Replay(const std::vector<CapturedDMA>& dmas)
+{
+  for (const CapturedDMA& dma : dmas)
+  {
+    DMAToDSP(dma.control, dma.gc_address, dma.dsp_address,
+             reinterpret_cast<const u16*>(dma.data.data()), static_cast<u16>(dma.data.size() / 2));
+  }
+}
+
+// Runs the code from the start until it halts, and returns how many cycles that took.
+u64 RunUntilHalt()
+{
+  const u64 start_steps = g_dsp.step_counter;
+  g_dsp.pc = 0;
+  g_dsp.cr &= ~CR_HALT;
+  while (!(g_dsp.cr & CR_HALT))
+    DSPCore_RunCycles(1000);
+  return g_dsp.step_counter - start_steps;
+}
+
+std::vector<u16> AssembleCode(const char* text)
+{
+  std::vector<u16> code;
+  EXPECT_TRUE(Assemble(text, code));
+  return code;
+}
+
+// Uploads the mixing code and its samples through DMA and records them.
+std::vector<CapturedDMA> CaptureMixCode()
+{
+  std::vector<CapturedDMA> dmas;
+  ScopeInit guard(DSPInitOptions::CORE_INTERPRETER, new DMARecorder(&dmas));
+  EXPECT_TRUE(guard.Initialized());
+
+  const std::vector<u16> code = AssembleCode(MIX_CODE);
+  DMAToDSP(DSP_CR_IMEM | DSP_CR_FROM_CPU, 0x1000, 0, code.data(), static_cast<u16>(code.size()));
+  std::vector<u16> samples(0x100);
+  for (u16 i = 0; i < samples.size(); ++i)
+    samples[i] = i * 0x101;
+  DMAToDSP(DSP_CR_DMEM | DSP_CR_FROM_CPU, 0x2000, 0x0100 * 2, samples.data(), 0x100);
+
+  EXPECT_EQ(2u, dmas.size());
+  return dmas;
+}
+
+struct DSPState
+{
+  DSP_Regs regs;
+  std::vector<u16> dram;
+};
+
+DSPState GetState()
+{
+  return {g_dsp.r, std::vector<u16>(g_dsp.dram, g_dsp.dram + DSP_DRAM_SIZE)};
+}
+}  // namespace
+
+TEST(DSPInterpreter, MatchesJit)
+{
+  const std::vector<CapturedDMA> capture = CaptureMixCode();
+
+  DSPState states[2];
+  const DSPInitOptions::CoreType core_types[] = {DSPInitOptions::CORE_INTERPRETER,
+                                                 DSPInitOptions::CORE_JIT};
+  for (int i = 0; i < 2; ++i)
+  {
+    ScopeInit guard(core_types[i]);
+    ASSERT_TRUE(guard.Initialized());
+    Replay(capture);
+    RunUntilHalt();
+    states[i] = GetState();
+  }
+
+  EXPECT_EQ(0, memcmp(&states[0].regs, &states[1].regs, sizeof(DSP_Regs)));
+  EXPECT_EQ(states[0].dram, states[1].dram);
+  EXPECT_NE(0, states[0].dram[0x200 + 0x40]);
+}
+
+// Instructions must be decoded again once a DMA replaces the code.
+TEST(DSPInterpreter, IRAMDMA)
+{
+  ScopeInit guard(DSPInitOptions::CORE_INTERPRETER);
+  ASSERT_TRUE(guard.Initialized());
+
+  for (u16 value : {0x1234, 0x5678})
+  {
+    char text[64];
+    snprintf(text, sizeof(text), "lri $AC0.M, #0x%04x\n\tnx'ir : $AR0\n\thalt\n", value);
+    const std::vector<u16> code = AssembleCode(text);
+    DMAToDSP(DSP_CR_IMEM | DSP_CR_FROM_CPU, 0x1000, 0, code.data(), static_cast<u16>(code.size()));
+    const u16 ar0 = g_dsp.r.ar[0];
+    RunUntilHalt();
+    EXPECT_EQ(value, g_dsp.r.ac[0].m);
+    EXPECT_EQ(static_cast<u16>(ar0 + 1), g_dsp.r.ar[0]);
+  }
+}
+
+// Replays the capture of the mixing code over and over, and reports how many cycles the
+// interpreter gets through.
+TEST(DSPInterpreter, Benchmark)
+{
+  const std::vector<CapturedDMA> capture = CaptureMixCode();
+
+  ScopeInit guard(DSPInitOptions::CORE_INTERPRETER);
+  ASSERT_TRUE(guard.Initialized());
+  Replay(capture);
+
+  constexpr int RUNS = 200;
+  u64 cycles = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < RUNS; ++i)
+    cycles += RunUntilHalt();
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  printf("%d runs in %.1f ms, %llu cycles: %.2f million cycles/s\n", RUNS, time.count() * 1000,
+         static_cast<unsigned long long>(cycles), cycles / time.count() / 1e6);
+}
@@ -0,0 +1,273 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/MemoryUtil.h"
+#include "Common/MsgHandler.h"
+#include "Core/ConfigManager.h"
+#include "Core/DSP/DSPAnalyzer.h"
+#include "Core/DSP/DSPCodeUtil.h"
+#include "Core/DSP/DSPCore.h"
+#include "Core/DSP/DSPEmitter.h"
+#include "Core/DSP/DSPHost.h"
+#include "Core/DSP/DSPTables.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+// Mixes a buffer in DRAM a number of times and halts, with a block loop, a call, conditional
+// branches and a repeated instruction, like the inner loops of audio ucodes.
+const char MIX_CODE[] = R"(
+	clr	$ACC1
+	lri	$AC1.M, #100
+frame:
+	lri	$AR0, #0x0100
+	lri	$AR1, #0x0200
+	bloopi	#64, mix_end
+	lrri	$AC0.M, @$AR0
+	call	saturate
+mix_end:
+	srri	@$AR1, $AC0.M
+	lri	$AR2, #0x0300
+	loopi	#16
+	srri	@$AR2, $AC1.M
+	decm	$AC1.M
+	jnz	frame
+	halt
+
+saturate:
+	addis	$AC0.M, #3
+	cmpi	$AC0.M, #0x4000
+	jle	no_clamp
+	lri	$AC0.M, #0x4000
+no_clamp:
+	ret
+)";
+
+bool NoAlerts(const char*, const char*, bool, int)
+{
+  return false;
+}
+
+class ScopeInit final
+{
+public:
+  explicit ScopeInit(DSPInitOptions::CoreType core_type,
+                     const std::string& ucode_cache_filename = "")
+  {
+    SConfig::Init();
+    RegisterMsgAlertHandler(NoAlerts);
+    InitInstructionTable();
+
+    DSPInitOptions options;
+    options.irom_contents.fill(0);
+    options.coef_contents.fill(0);
+    options.core_type = core_type;
+    options.ucode_cache_filename = ucode_cache_filename;
+    m_initialized = DSPCore_Init(options);
+  }
+  ~ScopeInit()
+  {
+    DSPCore_Shutdown();
+    RegisterMsgAlertHandler(nullptr);
+    SConfig::Shutdown();
+  }
+  bool Initialized() const { return m_initialized; }
+
+private:
+  bool m_initialized;
+};
+
+void LoadCode(const std::vector<u16>& code)
+{
+  Common::UnWriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+  std::copy(code.begin(), code.end(), g_dsp.iram);
+  Common::WriteProtectMemory(g_dsp.iram, DSP_IRAM_BYTE_SIZE, false);
+  DSPHost::CodeLoaded(reinterpret_cast<const u8*>(g_dsp.iram), DSP_IRAM_BYTE_SIZE);
+
+  for (u16 i = 0; i < 0x100; ++i)
+    g_dsp.dram[0x100 + i] = i * 0x101;
+}
+
+// Runs the code from the start until it halts, in slices of the given number of cycles. Returns
+// the number of slices it took.
+int RunUntilHalt(int slice_cycles)
+{
+  g_dsp.pc = 0;
+  g_dsp.cr &= ~CR_HALT;
+  int slices = 0;
+  while (!(g_dsp.cr & CR_HALT))
+  {
+    DSPCore_RunCycles(slice_cycles);
+    slices++;
+  }
+  return slices;
+}
+
+struct DSPState
+{
+  DSP_Regs regs;
+  std::vector<u16> dram;
+};
+
+DSPState GetState()
+{
+  return {g_dsp.r, std::vector<u16>(g_dsp.dram, g_dsp.dram + DSP_DRAM_SIZE)};
+}
+
+std::vector<u16> AssembleMixCode()
+{
+  std::vector<u16> code;
+  EXPECT_TRUE(Assemble(MIX_CODE, code));
+  return code;
+}
+}  // namespace
+
+TEST(DSPJit, MatchesInterpreter)
+{
+  DSPState expected;
+  {
+    ScopeInit guard(DSPInitOptions::CORE_INTERPRETER);
+    ASSERT_TRUE(guard.Initialized());
+    LoadCode(AssembleMixCode());
+    RunUntilHalt(1000);
+    expected = GetState();
+  }
+
+  // Blocks jump to each other only as long as there are cycles left, so try short slices too.
+  for (int slice_cycles : {1000, 13})
+  {
+    ScopeInit guard(DSPInitOptions::CORE_JIT);
+    ASSERT_TRUE(guard.Initialized());
+    LoadCode(AssembleMixCode());
+    RunUntilHalt(slice_cycles);
+    const DSPState state = GetState();
+
+    EXPECT_EQ(0, memcmp(&expected.regs, &state.regs, sizeof(state.regs))) << slice_cycles;
+    EXPECT_EQ(expected.dram, state.dram) << slice_cycles;
+  }
+}
+
+// Runs the mixing loop over and over, and reports how often the dispatcher had to pick the next
+// block.
+TEST(DSPJit, DispatcherBenchmark)
+{
+  ScopeInit guard(DSPInitOptions::CORE_JIT);
+  ASSERT_TRUE(guard.Initialized());
+  g_dsp_jit->SetCountDispatcherEntries(true);
+  LoadCode(AssembleMixCode());
+
+  constexpr int RUNS = 1000;
+  const u64 start_entries = g_dsp_jit->GetDispatcherEntries();
+  int slices = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < RUNS; ++i)
+    slices += RunUntilHalt(1000);
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  const u64 entries = g_dsp_jit->GetDispatcherEntries() - start_entries;
+  EXPECT_NE(0u, entries);
+
+  printf("%d runs in %.1f ms, %d slices of 1000 cycles: %.2f million dispatcher entries/s, "
+         "%.1f per slice\n",
+         RUNS, time.count() * 1000, slices, entries / time.count() / 1e6,
+         static_cast<double>(entries) / slices);
+}
+
+TEST(DSPJit, UCodeCache)
+{
+  const std::string dir = File::CreateTempDir();
+  ASSERT_FALSE(dir.empty());
+  const std::string filename = dir + DIR_SEP "ucodes.cache";
+
+  DSPState expected;
+  size_t num_blocks;
+  double cold_ms;
+  {
+    ScopeInit guard(DSPInitOptions::CORE_JIT, filename);
+    ASSERT_TRUE(guard.Initialized());
+    LoadCode(AssembleMixCode());
+    const auto start = std::chrono::steady_clock::now();
+    RunUntilHalt(1000);
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    cold_ms = time.count() * 1000;
+    expected = GetState();
+    num_blocks = g_dsp_jit->GetCompiledBlocks().size();
+  }
+
+  ScopeInit guard(DSPInitOptions::CORE_JIT, filename);
+  ASSERT_TRUE(guard.Initialized());
+
+  // The analysis comes from the cache, and must be what analyzing the code gives. Uploading the
+  // code already took it from there; do that again to time it.
+  LoadCode(AssembleMixCode());
+  auto start = std::chrono::steady_clock::now();
+  DSPCore_IRAMChanged();
+  const std::chrono::duration<double> cached_load = std::chrono::steady_clock::now() - start;
+  const auto code_flags = DSPAnalyzer::code_flags;
+  const auto loop_starts = DSPAnalyzer::loop_starts;
+  start = std::chrono::steady_clock::now();
+  DSPAnalyzer::Analyze();
+  const std::chrono::duration<double> analysis = std::chrono::steady_clock::now() - start;
+  EXPECT_TRUE(code_flags == DSPAnalyzer::code_flags);
+  EXPECT_TRUE(loop_starts == DSPAnalyzer::loop_starts);
+
+  // The blocks from the first run are compiled along with the code space reset, before the code
+  // runs again.
+  ASSERT_TRUE(g_dsp.reset_dspjit_codespace);
+  start = std::chrono::steady_clock::now();
+  g_dsp_jit->ClearIRAMandDSPJITCodespaceReset();
+  const std::chrono::duration<double> precompile = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(num_blocks, g_dsp_jit->GetCompiledBlocks().size());
+
+  start = std::chrono::steady_clock::now();
+  RunUntilHalt(1000);
+  const std::chrono::duration<double> warm = std::chrono::steady_clock::now() - start;
+  const DSPState state = GetState();
+  EXPECT_EQ(0, memcmp(&expected.regs, &state.regs, sizeof(state.regs)));
+  EXPECT_EQ(expected.dram, state.dram);
+
+  printf("Analysis from the cache: %.3f ms, analyzing: %.3f ms\n", cached_load.count() * 1000,
+         analysis.count() * 1000);
+  printf("%zu blocks precompiled in %.3f ms, first run: %.3f ms cold, %.3f ms warm\n", num_blocks,
+         precompile.count() * 1000, cold_ms, warm.count() * 1000);
+
+  File::DeleteDirRecursively(dir);
+}
+
+// A ucode which was replaced before it ran must not be remembered with the blocks compiled in
+// IROM until then.
+TEST(DSPJit, UCodeCacheSkipsUCodesWhichDidNotRun)
+{
+  const std::string dir = File::CreateTempDir();
+  ASSERT_FALSE(dir.empty());
+  const std::string filename = dir + DIR_SEP "ucodes.cache";
+
+  {
+    ScopeInit guard(DSPInitOptions::CORE_JIT, filename);
+    ASSERT_TRUE(guard.Initialized());
+    g_dsp.pc = 0x8000;
+    g_dsp.cr &= ~CR_HALT;
+    DSPCore_RunCycles(100);
+    ASSERT_FALSE(g_dsp_jit->GetCompiledBlocks().empty());
+    LoadCode(AssembleMixCode());
+  }
+
+  ScopeInit guard(DSPInitOptions::CORE_JIT, filename);
+  ASSERT_TRUE(guard.Initialized());
+  LoadCode(AssembleMixCode());
+  g_dsp_jit->ClearIRAMandDSPJITCodespaceReset();
+  EXPECT_TRUE(g_dsp_jit->GetCompiledBlocks().empty());
+
+  File::DeleteDirRecursively(dir);
+}
@@ -0,0 +1,223 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HLE/HLE.h"
+#include "Core/HLE/HLE_Memory.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  explicit ScopeInit(int core = PowerPC::CORE_INTERPRETER)
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    SConfig::GetInstance().bHLEMemoryFunctions = true;
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(core);
+    HLE_Memory::ClearStats();
+
+    // The BATs set up by the IPL.
+    UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+    msr.DR = 1;
+    PowerPC::ppcState.spr[SPR_DBAT0U] = 0x80001fff;
+    PowerPC::ppcState.spr[SPR_DBAT0L] = 0x00000002;
+    PowerPC::ppcState.spr[SPR_DBAT1U] = 0xc0001fff;
+    PowerPC::ppcState.spr[SPR_DBAT1L] = 0x0000002a;
+    PowerPC::DBATUpdated();
+  }
+  ~ScopeInit()
+  {
+    HLE::Clear();
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+constexpr u32 CALL_ADDRESS = 0x3000;
+constexpr u32 RETURN_ADDRESS = CALL_ADDRESS + 4;
+constexpr u32 FUNCTION_ADDRESS = 0x3100;
+
+// Calls function the way HLE::Execute does, and returns where the CPU goes on.
+u32 Call(void (*function)(), u32 r3, u32 r4, u32 r5)
+{
+  GPR(3) = r3;
+  GPR(4) = r4;
+  GPR(5) = r5;
+  LR = RETURN_ADDRESS;
+  NPC = FUNCTION_ADDRESS;
+  function();
+  return NPC;
+}
+
+u64 GetCounter(const std::string& name)
+{
+  std::vector<std::pair<std::string, u64>> counters;
+  HLE_Memory::GetCounters(&counters);
+  for (const auto& counter : counters)
+  {
+    if (counter.first == name)
+      return counter.second;
+  }
+  return 0;
+}
+
+void FillPattern(u32 address, u32 size)
+{
+  for (u32 i = 0; i < size; i++)
+    Memory::Write_U8(static_cast<u8>(i * 7 + 1), address + i);
+}
+}  // namespace
+
+TEST(HLEMemory, Memcpy)
+{
+  ScopeInit guard;
+  FillPattern(0x1000, 100);
+
+  const int downcount = PowerPC::ppcState.downcount;
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_memcpy, 0x80002000, 0x80001000, 100));
+
+  for (u32 i = 0; i < 100; i++)
+    EXPECT_EQ(Memory::Read_U8(0x1000 + i), Memory::Read_U8(0x2000 + i)) << i;
+  EXPECT_EQ(0, Memory::Read_U8(0x2000 + 100));
+  EXPECT_EQ(0x80002000u, GPR(3));
+  EXPECT_LT(PowerPC::ppcState.downcount, downcount);
+  EXPECT_EQ(1u, GetCounter("HLE memcpy calls"));
+  EXPECT_EQ(100u, GetCounter("HLE memcpy bytes"));
+  EXPECT_EQ(0u, GetCounter("HLE memory functions outside of RAM"));
+}
+
+TEST(HLEMemory, MemmoveOverlapping)
+{
+  ScopeInit guard;
+  FillPattern(0x1000, 64);
+  std::vector<u8> expected(64);
+  for (u32 i = 0; i < 64; i++)
+    expected[i] = Memory::Read_U8(0x1000 + i);
+
+  // Through the uncached mirror, forwards and then back again.
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_memmove, 0xC0001010, 0x80001000, 64));
+  for (u32 i = 0; i < 64; i++)
+    EXPECT_EQ(expected[i], Memory::Read_U8(0x1010 + i)) << i;
+
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_copy_longs, 0x80001000, 0x80001010, 64));
+  for (u32 i = 0; i < 64; i++)
+    EXPECT_EQ(expected[i], Memory::Read_U8(0x1000 + i)) << i;
+
+  EXPECT_EQ(1u, GetCounter("HLE memmove calls"));
+  EXPECT_EQ(1u, GetCounter("HLE __copy_longs calls"));
+}
+
+TEST(HLEMemory, Memset)
+{
+  ScopeInit guard;
+  FillPattern(0x1000, 48);
+
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_memset, 0x80001004, 0x1AB, 40));
+
+  EXPECT_EQ(Memory::Read_U8(0x1003), 1u + 3 * 7);
+  for (u32 i = 0; i < 40; i++)
+    EXPECT_EQ(0xAB, Memory::Read_U8(0x1004 + i)) << i;
+  EXPECT_EQ(Memory::Read_U8(0x1004 + 40), static_cast<u8>(1u + 44 * 7));
+  EXPECT_EQ(40u, GetCounter("HLE memset bytes"));
+}
+
+TEST(HLEMemory, OutsideOfRAM)
+{
+  ScopeInit guard;
+  FillPattern(0x1000, 100);
+
+  // Without translation the library code has to make the accesses, and take any exceptions.
+  UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+  msr.DR = 0;
+  EXPECT_EQ(FUNCTION_ADDRESS, Call(HLE_Memory::HLE_memcpy, 0x2000, 0x1000, 100));
+
+  EXPECT_EQ(0, Memory::Read_U8(0x2000));
+  EXPECT_EQ(0u, GetCounter("HLE memcpy calls"));
+  EXPECT_EQ(1u, GetCounter("HLE memory functions outside of RAM"));
+}
+
+// Runs a byte copy loop hooked as memcpy on each CPU core, which must run the loop itself when the
+// HLE function leaves the copy to it.
+TEST(HLEMemory, OriginalCodeRunsOutsideOfRAM)
+{
+  for (int core :
+       {PowerPC::CORE_INTERPRETER, PowerPC::CORE_CACHEDINTERPRETER, PowerPC::CORE_JIT64})
+  {
+    for (bool translate : {false, true})
+    {
+      ScopeInit guard(core);
+      FillPattern(0x1000, 100);
+      UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+      msr.DR = translate;
+
+      const u32 code[] = {
+          0x48000101,  // bl FUNCTION_ADDRESS
+          0x48000000,  // b .
+      };
+      const u32 function[] = {
+          0x7CA903A6,  // mtctr r5
+          0x3884FFFF,  // addi r4, r4, -1
+          0x38C3FFFF,  // addi r6, r3, -1
+          0x8C040001,  // lbzu r0, 1(r4)
+          0x9C060001,  // stbu r0, 1(r6)
+          0x4200FFF8,  // bdnz -8
+          0x4E800020,  // blr
+      };
+      for (u32 i = 0; i < ArraySize(code); i++)
+        Memory::Write_U32(code[i], CALL_ADDRESS + i * 4);
+      for (u32 i = 0; i < ArraySize(function); i++)
+        Memory::Write_U32(function[i], FUNCTION_ADDRESS + i * 4);
+      HLE::Patch(FUNCTION_ADDRESS, "memcpy");
+
+      const u32 base = translate ? 0x80000000 : 0;
+      GPR(3) = base | 0x2000;
+      GPR(4) = base | 0x1000;
+      GPR(5) = 100;
+      PC = CALL_ADDRESS;
+      NPC = CALL_ADDRESS + 4;
+      for (int i = 0; i < 1000 && PC != RETURN_ADDRESS; i++)
+        PowerPC::SingleStep();
+
+      EXPECT_EQ(RETURN_ADDRESS, PC) << core << translate;
+      for (u32 i = 0; i < 100; i++)
+        EXPECT_EQ(Memory::Read_U8(0x1000 + i), Memory::Read_U8(0x2000 + i)) << core << i;
+      EXPECT_EQ(translate ? 1u : 0u, GetCounter("HLE memcpy calls")) << core;
+      EXPECT_EQ(translate ? 0u : 1u, GetCounter("HLE memory functions outside of RAM")) << core;
+    }
+  }
+}
+
+TEST(HLEMemory, CacheRanges)
+{
+  ScopeInit guard;
+
+  const int downcount = PowerPC::ppcState.downcount;
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_DCFlushRange, 0x80001010, 0x40, 0));
+  EXPECT_EQ(RETURN_ADDRESS, Call(HLE_Memory::HLE_DCInvalidateRange, 0x80001000, 0, 0));
+
+  EXPECT_LT(PowerPC::ppcState.downcount, downcount);
+  EXPECT_EQ(1u, GetCounter("HLE DCFlushRange calls"));
+  EXPECT_EQ(0x40u, GetCounter("HLE DCFlushRange bytes"));
+  EXPECT_EQ(1u, GetCounter("HLE DCInvalidateRange calls"));
+}
@@ -0,0 +1,99 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PPCCache.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(PowerPC::CORE_INTERPRETER);
+    HID0.ICE = 1;
+  }
+  ~ScopeInit()
+  {
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+u32 Instruction(u32 address)
+{
+  return 0x38000000 | (address & 0xffff);
+}
+
+void FillLine(u32 address)
+{
+  for (u32 i = 0; i < 32; i += 4)
+    Memory::Write_U32(Instruction(address + i), address + i);
+}
+}  // namespace
+
+TEST(ICache, SequentialReads)
+{
+  ScopeInit guard;
+  FillLine(0x1000);
+  FillLine(0x1020);
+
+  PowerPC::InstructionCache& icache = PowerPC::ppcState.iCache;
+  for (u32 address = 0x1000; address < 0x1040; address += 4)
+    EXPECT_EQ(Instruction(address), icache.ReadInstruction(address)) << address;
+
+  // Stores don't reach the cache until the line is invalidated.
+  Memory::Write_U32(0x60000000, 0x1004);
+  EXPECT_EQ(Instruction(0x1000), icache.ReadInstruction(0x1000));
+  EXPECT_EQ(Instruction(0x1004), icache.ReadInstruction(0x1004));
+  icache.Invalidate(0x1004);
+  EXPECT_EQ(0x60000000u, icache.ReadInstruction(0x1004));
+
+  // With the cache disabled, reads go to memory.
+  Memory::Write_U32(0x60000000, 0x1024);
+  HID0.ICE = 0;
+  EXPECT_EQ(0x60000000u, icache.ReadInstruction(0x1024));
+  HID0.ICE = 1;
+  EXPECT_EQ(Instruction(0x1024), icache.ReadInstruction(0x1024));
+}
+
+TEST(ICache, Eviction)
+{
+  ScopeInit guard;
+
+  // More lines of the same set than there are ways, each read twice in a row.
+  PowerPC::InstructionCache& icache = PowerPC::ppcState.iCache;
+  for (u32 i = 0; i <= PowerPC::ICACHE_WAYS; i++)
+  {
+    const u32 address = 0x1000 + i * 0x1000;
+    FillLine(address);
+    EXPECT_EQ(Instruction(address), icache.ReadInstruction(address)) << address;
+    EXPECT_EQ(Instruction(address + 4), icache.ReadInstruction(address + 4)) << address;
+  }
+
+  // The first line was evicted, so it's read from memory again.
+  Memory::Write_U32(0x60000000, 0x1000);
+  EXPECT_EQ(0x60000000u, icache.ReadInstruction(0x1000));
+  for (u32 i = 1; i <= PowerPC::ICACHE_WAYS; i++)
+  {
+    const u32 address = 0x1000 + i * 0x1000;
+    EXPECT_EQ(Instruction(address), icache.ReadInstruction(address)) << address;
+  }
+}
@@ -0,0 +1,206 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "Core/PowerPC/JitCommon/JitIdleLoops.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  explicit ScopeInit(int core = PowerPC::CORE_INTERPRETER)
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    SConfig::GetInstance().bJITIdleLoops = true;
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(core);
+
+    // The BATs set up by the IPL, which decide what is RAM.
+    UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+    msr.DR = 1;
+    PowerPC::ppcState.spr[SPR_DBAT0U] = 0x80001fff;
+    PowerPC::ppcState.spr[SPR_DBAT0L] = 0x00000002;
+    PowerPC::ppcState.spr[SPR_DBAT1U] = 0xc0001fff;
+    PowerPC::ppcState.spr[SPR_DBAT1L] = 0x0000002a;
+    PowerPC::DBATUpdated();
+  }
+  ~ScopeInit()
+  {
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+constexpr u32 CODE_ADDRESS = 0x3000;
+
+PPCAnalyst::IdleLoop Analyze(const std::vector<u32>& code)
+{
+  for (size_t i = 0; i < code.size(); i++)
+    Memory::Write_U32(code[i], CODE_ADDRESS + static_cast<u32>(i * 4));
+
+  PPCAnalyst::CodeBuffer buffer(32);
+  PPCAnalyst::BlockStats stats;
+  PPCAnalyst::BlockRegStats gpa, fpa;
+  PPCAnalyst::CodeBlock block;
+  block.m_stats = &stats;
+  block.m_gpa = &gpa;
+  block.m_fpa = &fpa;
+
+  PPCAnalyst::PPCAnalyzer analyzer;
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_BRANCH_MERGE);
+  analyzer.Analyze(CODE_ADDRESS, &block, &buffer, buffer.GetSize());
+  return PPCAnalyst::AnalyzeIdleLoop(block, buffer);
+}
+
+constexpr u32 BLR = 0x4E800020;
+constexpr u32 NOP = 0x60000000;
+}  // namespace
+
+TEST(IdleLoop, PollingLoop)
+{
+  ScopeInit guard;
+
+  // lwz r0, 0x10(r13); lhz r4, 2(r3); or. r0, r0, r4; beq -12; blr
+  auto loop = Analyze({0x800D0010, 0xA0830002, 0x7C002379, 0x4182FFF4, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Poll, loop.type) << loop.reason;
+  EXPECT_EQ(CODE_ADDRESS + 12, loop.branch_address);
+  EXPECT_EQ(4u, loop.num_instructions);
+
+  // Where r13 and r3 point is only known when the loop runs.
+  ASSERT_EQ(2u, loop.loads.size());
+  EXPECT_EQ(13, loop.loads[0].base);
+  EXPECT_EQ(-1, loop.loads[0].index);
+  EXPECT_EQ(0x10u, loop.loads[0].offset);
+  EXPECT_EQ(3, loop.loads[1].base);
+  EXPECT_EQ(2u, loop.loads[1].offset);
+}
+
+TEST(IdleLoop, ConstantAddressPoll)
+{
+  ScopeInit guard;
+
+  // lis r3, 0x8000; lwz r4, 0x3100(r3); cmpwi r4, 0; beq -12; blr
+  auto loop = Analyze({0x3C608000, 0x80833100, 0x2C040000, 0x4182FFF4, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Poll, loop.type) << loop.reason;
+  EXPECT_TRUE(loop.loads.empty());
+}
+
+// The vertical beam position changes with time, without any event.
+TEST(IdleLoop, TimerPollIsBusy)
+{
+  ScopeInit guard;
+
+  // lis r3, 0xcc00; lhz r4, 0x202c(r3); cmplwi r4, 100; blt -12; blr
+  auto loop = Analyze({0x3C60CC00, 0xA083202C, 0x28040064, 0x4180FFF4, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Busy, loop.type);
+  EXPECT_EQ("reads cc00202c, which isn't RAM, with lhz at 00003004", loop.reason);
+}
+
+// Loads through registers are checked when the loop runs.
+TEST(IdleLoop, JitSkipsOnlyRAMPolls)
+{
+  for (u32 address : {0x80003100u, 0xcc003000u})
+  {
+    ScopeInit guard(PowerPC::CORE_JIT64);
+    EMM::InstallExceptionHandler();
+
+    // lwz r4, 0(r3); b -4
+    const u32 code[] = {0x80830000, 0x4BFFFFFC};
+    for (u32 i = 0; i < ArraySize(code); i++)
+      Memory::Write_U32(code[i], CODE_ADDRESS + i * 4);
+    GPR(3) = address;
+    PC = CODE_ADDRESS;
+    NPC = CODE_ADDRESS + 4;
+    PowerPC::SingleStep();
+
+    const bool is_ram = address == 0x80003100;
+    EXPECT_EQ(is_ram, CoreTiming::GetIdleTicks() > 0) << std::hex << address;
+    EMM::UninstallExceptionHandler();
+  }
+}
+
+TEST(IdleLoop, ComputedAddressIsBusy)
+{
+  ScopeInit guard;
+
+  // lwz r3, 0(r13); lwz r4, 0(r3); cmpwi r4, 0; beq -12; blr
+  auto loop = Analyze({0x806D0000, 0x80830000, 0x2C040000, 0x4182FFF4, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Busy, loop.type);
+  EXPECT_EQ("reads memory at a computed address with lwz at 00003004", loop.reason);
+}
+
+TEST(IdleLoop, DelayLoop)
+{
+  ScopeInit guard;
+
+  // nop; bdnz -4; blr
+  auto loop = Analyze({NOP, 0x4200FFFC, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Delay, loop.type) << loop.reason;
+}
+
+TEST(IdleLoop, CountingLoopIsBusy)
+{
+  ScopeInit guard;
+
+  // addi r3, r3, 1; cmpwi r3, 10; blt -8; blr
+  auto loop = Analyze({0x38630001, 0x2C03000A, 0x4180FFF8, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Busy, loop.type);
+  EXPECT_EQ("keeps r3 between iterations", loop.reason);
+}
+
+TEST(IdleLoop, StoringLoopIsBusy)
+{
+  ScopeInit guard;
+
+  // lwz r0, 0(r3); stw r0, 0(r4); b -8
+  auto loop = Analyze({0x80030000, 0x90040000, 0x4BFFFFF8});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::Busy, loop.type);
+  EXPECT_EQ(CODE_ADDRESS + 8, loop.branch_address);
+}
+
+TEST(IdleLoop, NoLoop)
+{
+  ScopeInit guard;
+
+  auto loop = Analyze({NOP, BLR});
+  EXPECT_EQ(PPCAnalyst::IdleLoopType::None, loop.type);
+}
+
+TEST(IdleLoop, SkipDelayLoop)
+{
+  ScopeInit guard;
+
+  // Only the iterations which fit before the next event are skipped.
+  CTR = 100;
+  PowerPC::ppcState.downcount = 50;
+  JitIdleLoops::SkipDelayLoop(2);
+  EXPECT_EQ(76u, CTR);
+  EXPECT_EQ(2, PowerPC::ppcState.downcount);
+
+  // The last iteration still runs.
+  CTR = 3;
+  PowerPC::ppcState.downcount = 1000;
+  JitIdleLoops::SkipDelayLoop(2);
+  EXPECT_EQ(1u, CTR);
+  EXPECT_EQ(996, PowerPC::ppcState.downcount);
+}
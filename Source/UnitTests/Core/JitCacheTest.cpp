@@ -0,0 +1,453 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+
+namespace
+{
+// Enough to exceed the 100k live blocks we see in large Wii titles.
+constexpr int NUM_TEST_BLOCKS = 120000;
+constexpr u32 BLOCK_SIZE_INSTRUCTIONS = 6;
+constexpr u32 BLOCK_STRIDE = 4 * BLOCK_SIZE_INSTRUCTIONS;
+constexpr u32 CODE_BASE = 0x80003100;
+
+u8 s_dispatcher;
+
+class TestBlockCache final : public JitBaseBlockCache
+{
+public:
+  int num_links = 0;
+  int num_unlinks = 0;
+  // Where each exit currently jumps to.
+  std::map<const u8*, const u8*> link_targets;
+
+private:
+  void WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest) override
+  {
+    if (dest)
+      num_links++;
+    else
+      num_unlinks++;
+    link_targets[source.exitPtrs] = GetLinkTarget(source, dest, &s_dispatcher);
+  }
+};
+
+u32 BlockAddress(int i)
+{
+  return CODE_BASE + BLOCK_STRIDE * i;
+}
+
+// Fills the cache with a chain of blocks, each linking to its successor.
+void FillCache(TestBlockCache* cache, int count = NUM_TEST_BLOCKS)
+{
+  for (int i = 0; i < count; i++)
+  {
+    int block_num = cache->AllocateBlock(BlockAddress(i));
+    JitBlock* b = cache->GetBlock(block_num);
+    b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+    b->codeSize = 0;
+    b->checkedEntry = nullptr;
+    b->normalEntry = nullptr;
+    b->linkData.push_back({nullptr, BlockAddress(i + 1), false});
+    cache->FinalizeBlock(block_num, true, nullptr);
+  }
+}
+
+// Stand-ins for the host code of a block with a single exit.
+struct BoundBlockCode
+{
+  u8 checked_entry;
+  u8 bound_entry;
+  u8 exit;
+  u8 fallback;
+};
+
+// Adds a block at BlockAddress(i) which takes entry_binding, with an exit to
+// BlockAddress(exit_to) passing exit_binding. The dirty sets say which of the
+// bound registers are passed without being stored.
+int AddBoundBlock(TestBlockCache* cache, int i, u64 entry_binding, int exit_to, u64 exit_binding,
+                  BoundBlockCode* code, u64 entry_dirty = 0, u64 exit_dirty = 0)
+{
+  int block_num = cache->AllocateBlock(BlockAddress(i));
+  JitBlock* b = cache->GetBlock(block_num);
+  b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+  b->codeSize = 1;
+  b->checkedEntry = &code->checked_entry;
+  b->normalEntry = &code->checked_entry;
+  b->entryBinding = entry_binding;
+  b->entryDirty = entry_dirty;
+  b->boundEntry = entry_binding ? &code->bound_entry : nullptr;
+  JitBlock::LinkData link = {&code->exit, BlockAddress(exit_to), false};
+  link.binding = exit_binding;
+  link.dirty = exit_dirty;
+  link.bindingFallback = exit_binding ? &code->fallback : nullptr;
+  b->linkData.push_back(link);
+  cache->FinalizeBlock(block_num, true, &code->checked_entry);
+  return block_num;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+TEST(JitCache, LookupAndLinking)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  FillCache(cache.get());
+
+  // Every block but the last one got linked to its successor.
+  EXPECT_EQ(NUM_TEST_BLOCKS - 1, cache->num_links);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+    ASSERT_EQ(i + 1, cache->GetBlockNumberFromStartAddress(BlockAddress(i), 0));
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+    ASSERT_EQ(-1, cache->GetBlockNumberFromStartAddress(BlockAddress(i) + 4, 0));
+  std::printf("%d lookups in %.3f ms\n", 2 * NUM_TEST_BLOCKS, SecondsSince(start) * 1000.0);
+}
+
+TEST(JitCache, InvalidateSingleLines)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  FillCache(cache.get());
+
+  // Invalidate every other cache line, which is what dcbi/icbi loops over
+  // DMA'd code end up doing.
+  auto start = std::chrono::steady_clock::now();
+  const u32 code_end = BlockAddress(NUM_TEST_BLOCKS);
+  for (u32 addr = CODE_BASE & ~0x1f; addr < code_end; addr += 64)
+    cache->InvalidateICache(addr, 32, true);
+  std::printf("Invalidated %u lines in %.3f ms\n", (code_end - CODE_BASE) / 64,
+              SecondsSince(start) * 1000.0);
+
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+  {
+    const u32 addr = BlockAddress(i);
+    const u32 last = addr + BLOCK_STRIDE - 1;
+    // A block survives only if none of its lines were invalidated.
+    bool hit = false;
+    for (u32 line = addr & ~0x1f; line <= last; line += 32)
+      hit |= ((line - (CODE_BASE & ~0x1f)) % 64) == 0;
+    EXPECT_EQ(hit ? -1 : i + 1, cache->GetBlockNumberFromStartAddress(addr, 0)) << i;
+  }
+
+  // Destroyed blocks must have been unlinked from their predecessors.
+  EXPECT_LT(0, cache->num_unlinks);
+}
+
+TEST(JitCache, InvalidateWholeRange)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  FillCache(cache.get());
+
+  auto start = std::chrono::steady_clock::now();
+  cache->InvalidateICache(0, 0xffffffff, true);
+  std::printf("Invalidated %d blocks in %.3f ms\n", NUM_TEST_BLOCKS, SecondsSince(start) * 1000.0);
+
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+    ASSERT_EQ(-1, cache->GetBlockNumberFromStartAddress(BlockAddress(i), 0));
+
+  // Recompiling into the same range still works once everything is gone.
+  FillCache(cache.get(), 16);
+  EXPECT_EQ(NUM_TEST_BLOCKS + 1, cache->GetBlockNumberFromStartAddress(BlockAddress(0), 0));
+}
+
+TEST(JitCache, InvalidateTraceRanges)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+
+  // A trace made of two runs of code with a gap between them.
+  const u32 first = CODE_BASE;
+  const u32 second = CODE_BASE + 0x400;
+  int block_num = cache->AllocateBlock(first);
+  JitBlock* b = cache->GetBlock(block_num);
+  b->originalSize = 8;
+  b->codeSize = 0;
+  b->checkedEntry = nullptr;
+  b->normalEntry = nullptr;
+  b->physicalRanges = {{first, 16}, {second, 16}};
+  cache->FinalizeBlock(block_num, true, nullptr);
+
+  // Code in the gap isn't part of the trace.
+  cache->InvalidateICache(first + 0x100, 32, true);
+  EXPECT_EQ(block_num, cache->GetBlockNumberFromStartAddress(first, 0));
+
+  cache->InvalidateICache(second, 32, true);
+  EXPECT_EQ(-1, cache->GetBlockNumberFromStartAddress(first, 0));
+}
+
+TEST(JitCache, DestroyBlocksInCodeRange)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  // Pretend every block has one byte of code, so the blocks are laid out in
+  // the same order in the code space as in guest memory.
+  static u8 code[64];
+  for (int i = 0; i < 64; i++)
+  {
+    int block_num = cache->AllocateBlock(BlockAddress(i));
+    JitBlock* b = cache->GetBlock(block_num);
+    b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+    b->codeSize = 1;
+    b->checkedEntry = &code[i];
+    b->normalEntry = &code[i];
+    b->linkData.push_back({nullptr, BlockAddress(i + 1), false});
+    cache->FinalizeBlock(block_num, true, &code[i]);
+  }
+  cache->num_unlinks = 0;
+
+  EXPECT_EQ(16, cache->DestroyBlocksInCodeRange(&code[16], &code[32]));
+  for (int i = 0; i < 64; i++)
+  {
+    const bool evicted = i >= 16 && i < 32;
+    EXPECT_EQ(evicted ? -1 : i + 1, cache->GetBlockNumberFromStartAddress(BlockAddress(i), 0));
+  }
+  // The block jumping into the range is unlinked, and so is every exit of the
+  // evicted blocks.
+  EXPECT_EQ(17, cache->num_unlinks);
+}
+
+TEST(JitCache, HostAddressLookup)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  cache->EnableHostCodeLookup(true);
+  // Blocks of 4 bytes of code with a 4 byte gap after each.
+  static u8 code[64];
+  for (int i = 0; i < 8; i++)
+  {
+    int block_num = cache->AllocateBlock(BlockAddress(i));
+    JitBlock* b = cache->GetBlock(block_num);
+    b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+    b->codeSize = 4;
+    b->checkedEntry = &code[8 * i];
+    b->normalEntry = &code[8 * i + 1];
+    cache->FinalizeBlock(block_num, false, &code[8 * i]);
+  }
+
+  for (int i = 0; i < 8; i++)
+  {
+    EXPECT_EQ(i + 1, cache->GetBlockNumberFromHostAddress(&code[8 * i]));
+    EXPECT_EQ(i + 1, cache->GetBlockNumberFromHostAddress(&code[8 * i + 3]));
+    EXPECT_EQ(-1, cache->GetBlockNumberFromHostAddress(&code[8 * i + 4]));
+  }
+
+  EXPECT_EQ(1, cache->DestroyBlocksInCodeRange(&code[8], &code[16]));
+  EXPECT_EQ(-1, cache->GetBlockNumberFromHostAddress(&code[8]));
+  EXPECT_EQ(1, cache->GetBlockNumberFromHostAddress(&code[0]));
+  EXPECT_EQ(3, cache->GetBlockNumberFromHostAddress(&code[16]));
+}
+
+// The host code map is only needed by the sampling profiler, so it's left alone otherwise.
+TEST(JitCache, HostAddressLookupIsOptIn)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  static u8 code[4];
+  int block_num = cache->AllocateBlock(BlockAddress(0));
+  JitBlock* b = cache->GetBlock(block_num);
+  b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+  b->codeSize = 4;
+  b->checkedEntry = &code[0];
+  b->normalEntry = &code[1];
+  cache->FinalizeBlock(block_num, false, &code[0]);
+
+  EXPECT_EQ(-1, cache->GetBlockNumberFromHostAddress(&code[0]));
+}
+
+TEST(JitCache, DestroyedBlocksUnlinkTheirExits)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  FillCache(cache.get(), 3);
+  cache->num_unlinks = 0;
+
+  // A blr can return into the code after a bl of a destroyed block, so its
+  // exits have to go through the dispatcher from then on.
+  const int block_num = cache->GetBlockNumberFromStartAddress(BlockAddress(1), 0);
+  cache->InvalidateICache(BlockAddress(1), 4, true);
+  EXPECT_EQ(2, cache->num_unlinks);
+  EXPECT_FALSE(cache->GetBlock(block_num)->linkData[0].linkStatus);
+
+  // Destroying its old target doesn't touch the destroyed block again.
+  cache->InvalidateICache(BlockAddress(2), 4, true);
+  EXPECT_EQ(2, cache->num_unlinks);
+}
+
+TEST(JitCache, ReuseDestroyedBlocksWhenFull)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  FillCache(cache.get(), JitBaseBlockCache::MAX_NUM_BLOCKS - 2);
+  EXPECT_TRUE(cache->IsFull());
+
+  cache->InvalidateICache(BlockAddress(100), 4, true);
+  EXPECT_FALSE(cache->IsFull());
+
+  // The slot of the destroyed block is handed out again.
+  const u32 address = BlockAddress(JitBaseBlockCache::MAX_NUM_BLOCKS);
+  int block_num = cache->AllocateBlock(address);
+  EXPECT_EQ(101, block_num);
+  JitBlock* b = cache->GetBlock(block_num);
+  b->originalSize = BLOCK_SIZE_INSTRUCTIONS;
+  b->codeSize = 0;
+  b->checkedEntry = nullptr;
+  b->normalEntry = nullptr;
+  cache->FinalizeBlock(block_num, true, nullptr);
+  EXPECT_TRUE(cache->IsFull());
+  EXPECT_EQ(101, cache->GetBlockNumberFromStartAddress(address, 0));
+}
+
+// Inserts and erases at random, with addresses from a small range so that probe sequences run into
+// each other and wrap around the end of the table.
+TEST(JitCache, BlockStartMap)
+{
+  auto map = std::make_unique<BlockStartMap>();
+  std::unordered_map<u32, int> reference;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<u32> address_dist(0, 4 * JitBaseBlockCache::MAX_NUM_BLOCKS);
+
+  for (int i = 0; i < 1000000; i++)
+  {
+    const u32 address = address_dist(rng) * 4;
+    if (rng() % 3 == 0)
+    {
+      map->Erase(address);
+      reference.erase(address);
+    }
+    else if (reference.size() < JitBaseBlockCache::MAX_NUM_BLOCKS)
+    {
+      map->Insert(address, i);
+      reference[address] = i;
+    }
+  }
+
+  for (u32 address = 0; address <= 16 * JitBaseBlockCache::MAX_NUM_BLOCKS; address += 4)
+  {
+    const auto it = reference.find(address);
+    ASSERT_EQ(it == reference.end() ? -1 : it->second, map->Find(address)) << address;
+  }
+}
+
+// The lookup the dispatcher falls back to, compared to the standard hash map.
+TEST(JitCache, BlockStartMapBenchmark)
+{
+  auto map = std::make_unique<BlockStartMap>();
+  std::unordered_map<u32, int> unordered_map;
+  unordered_map.reserve(JitBaseBlockCache::MAX_NUM_BLOCKS);
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+  {
+    map->Insert(BlockAddress(i), i);
+    unordered_map[BlockAddress(i)] = i;
+  }
+
+  // Look the blocks up in a random order, like a game jumping around its code.
+  std::vector<u32> addresses;
+  for (int i = 0; i < NUM_TEST_BLOCKS; i++)
+    addresses.push_back(BlockAddress(i) + (i % 2) * 4);
+  std::shuffle(addresses.begin(), addresses.end(), std::mt19937(1234));
+
+  constexpr int RUNS = 20;
+  int found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; run++)
+  {
+    for (u32 address : addresses)
+      found += map->Find(address) != -1;
+  }
+  const double map_time = SecondsSince(start);
+
+  int unordered_found = 0;
+  start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; run++)
+  {
+    for (u32 address : addresses)
+      unordered_found += unordered_map.find(address) != unordered_map.end();
+  }
+  const double unordered_time = SecondsSince(start);
+
+  EXPECT_EQ(RUNS * NUM_TEST_BLOCKS / 2, found);
+  EXPECT_EQ(found, unordered_found);
+  std::printf("%d lookups: %.3f ms in BlockStartMap, %.3f ms in std::unordered_map\n",
+              RUNS * NUM_TEST_BLOCKS, map_time * 1000.0, unordered_time * 1000.0);
+}
+
+// An exit passing registers must never be left jumping into a block which isn't there anymore,
+// nor to the dispatcher, which expects the registers in ppcState.
+TEST(JitCache, BoundDestinationDestroyed)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  BoundBlockCode source, dest;
+  AddBoundBlock(cache.get(), 0, 0, 1, 0x3, &source);
+  AddBoundBlock(cache.get(), 1, 0x3, 2, 0, &dest);
+  EXPECT_EQ(&dest.bound_entry, cache->link_targets[&source.exit]);
+
+  EXPECT_EQ(1, cache->DestroyBlocksInCodeRange(&dest.checked_entry, &dest.checked_entry + 1));
+  EXPECT_EQ(&source.fallback, cache->link_targets[&source.exit]);
+}
+
+TEST(JitCache, RelinkToDifferentBinding)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  BoundBlockCode source, unbound_source, dest, other_dest, same_dest;
+  AddBoundBlock(cache.get(), 0, 0, 2, 0x3, &source);
+  AddBoundBlock(cache.get(), 1, 0, 2, 0, &unbound_source);
+
+  // The block got compiled again with other registers as its inputs.
+  AddBoundBlock(cache.get(), 2, 0x3, 3, 0, &dest);
+  cache->InvalidateICache(BlockAddress(2), 4, true);
+  AddBoundBlock(cache.get(), 2, 0x5, 3, 0, &other_dest);
+  EXPECT_EQ(&source.fallback, cache->link_targets[&source.exit]);
+  EXPECT_EQ(&other_dest.checked_entry, cache->link_targets[&unbound_source.exit]);
+
+  // Replacing it with one taking the same registers links the bound exit again.
+  AddBoundBlock(cache.get(), 2, 0x3, 3, 0, &same_dest);
+  EXPECT_EQ(&same_dest.bound_entry, cache->link_targets[&source.exit]);
+  EXPECT_EQ(&same_dest.checked_entry, cache->link_targets[&unbound_source.exit]);
+}
+
+TEST(JitCache, RelinkToDifferentDirtyRegisters)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  BoundBlockCode source, dest, other_dest;
+  AddBoundBlock(cache.get(), 0, 0, 1, 0x3, &source, 0, 0x3);
+  AddBoundBlock(cache.get(), 1, 0x3, 2, 0, &dest, 0x3);
+  EXPECT_EQ(&dest.bound_entry, cache->link_targets[&source.exit]);
+
+  // The exit doesn't store the second register, which the new block expects to be clean.
+  cache->InvalidateICache(BlockAddress(1), 4, true);
+  AddBoundBlock(cache.get(), 1, 0x3, 2, 0, &other_dest, 0x1);
+  EXPECT_EQ(&source.fallback, cache->link_targets[&source.exit]);
+}
+
+TEST(JitCache, InvalidationUnbindsExits)
+{
+  auto cache = std::make_unique<TestBlockCache>();
+  BoundBlockCode first, second, third;
+  AddBoundBlock(cache.get(), 0, 0, 1, 0x3, &first);
+  AddBoundBlock(cache.get(), 1, 0x3, 2, 0x7, &second);
+  AddBoundBlock(cache.get(), 2, 0x7, 0, 0, &third);
+  EXPECT_EQ(&second.bound_entry, cache->link_targets[&first.exit]);
+  EXPECT_EQ(&third.bound_entry, cache->link_targets[&second.exit]);
+  EXPECT_EQ(&first.checked_entry, cache->link_targets[&third.exit]);
+
+  // Both the exits into the invalidated block and its own exits stop passing registers.
+  cache->InvalidateICache(BlockAddress(1), 4, true);
+  EXPECT_EQ(&first.fallback, cache->link_targets[&first.exit]);
+  EXPECT_EQ(&second.fallback, cache->link_targets[&second.exit]);
+  EXPECT_EQ(&first.checked_entry, cache->link_targets[&third.exit]);
+
+  cache->InvalidateICache(0, 0xffffffff, true);
+  EXPECT_EQ(&s_dispatcher, cache->link_targets[&third.exit]);
+}
+
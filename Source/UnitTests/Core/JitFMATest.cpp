@@ -0,0 +1,186 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "Common/CPUDetect.h"
+#include "Common/CommonTypes.h"
+#include "Common/FPURoundMode.h"
+#include "Common/x64ABI.h"
+#include "Common/x64Emitter.h"
+#include "Core/PowerPC/Interpreter/Interpreter_FPUtils.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+using namespace Gen;
+
+namespace
+{
+using MaddFunction = double (*)(double a, double c, double b);
+using KernelFunction = void (*)(double* data, u64 iterations);
+
+// Emits the sequences Jit64::fmaddXX uses for madd, with c in the destination register.
+class MaddEmitter : public X64CodeBlock
+{
+public:
+  MaddEmitter() { AllocCodeSpace(4096); }
+  void PoisonMemory() override {}
+  MaddFunction EmitMadd(bool fused)
+  {
+    const u8* start = AlignCode16();
+    MOVAPD(XMM3, R(XMM1));
+    if (fused)
+    {
+      VFMADD132SD(XMM3, XMM2, R(XMM0));
+    }
+    else
+    {
+      MULSD(XMM3, R(XMM0));
+      ADDSD(XMM3, R(XMM2));
+    }
+    MOVAPD(XMM0, R(XMM3));
+    RET();
+    return reinterpret_cast<MaddFunction>(start);
+  }
+
+  // A ps_madd heavy kernel: four independent accumulators, acc = acc * a + b.
+  KernelFunction EmitKernel(bool fused)
+  {
+    const u8* start = AlignCode16();
+    MOVAPD(XMM4, MatR(ABI_PARAM1));
+    MOVAPD(XMM5, MDisp(ABI_PARAM1, 16));
+    for (int i = 0; i < 4; i++)
+      MOVAPD(static_cast<X64Reg>(XMM0 + i), MDisp(ABI_PARAM1, 32 + 16 * i));
+    const u8* loop = GetCodePtr();
+    for (int i = 0; i < 4; i++)
+    {
+      X64Reg acc = static_cast<X64Reg>(XMM0 + i);
+      if (fused)
+      {
+        VFMADD132PD(acc, XMM5, R(XMM4));
+      }
+      else
+      {
+        MULPD(acc, R(XMM4));
+        ADDPD(acc, R(XMM5));
+      }
+    }
+    SUB(64, R(ABI_PARAM2), Imm8(1));
+    J_CC(CC_NZ, loop);
+    for (int i = 0; i < 4; i++)
+      MOVAPD(MDisp(ABI_PARAM1, 32 + 16 * i), static_cast<X64Reg>(XMM0 + i));
+    RET();
+    return reinterpret_cast<KernelFunction>(start);
+  }
+};
+
+u64 ToBits(double value)
+{
+  u64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double FromBits(u64 bits)
+{
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+double RandomSingle(std::mt19937_64& rng)
+{
+  while (true)
+  {
+    u32 bits = static_cast<u32>(rng());
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (!std::isnan(value))
+      return value;
+  }
+}
+}  // namespace
+
+// With both factors being singles the product is exact, so the fused multiply-add has to give
+// the same result as the interpreter in every rounding mode.
+TEST(JitFMA, ExactProductMatchesInterpreter)
+{
+  if (!cpu_info.bFMA)
+    return;
+
+  MaddEmitter emitter;
+  MaddFunction fused = emitter.EmitMadd(true);
+  std::mt19937_64 rng(0);
+
+  FPURoundMode::SaveSIMDState();
+  for (int mode = FPURoundMode::ROUND_NEAR; mode <= FPURoundMode::ROUND_DOWN; mode++)
+  {
+    FPURoundMode::SetSIMDMode(mode, false);
+    for (int i = 0; i < 100000; i++)
+    {
+      double a = RandomSingle(rng);
+      double c = RandomSingle(rng);
+      double b = i % 2 ? RandomSingle(rng) : FromBits(rng());
+      if (std::isnan(b))
+        continue;
+
+      double expected = NI_madd(a, c, b);
+      double result = fused(a, c, b);
+      // Which NaN gets generated is up to HandleNaNs.
+      if (std::isnan(expected))
+        EXPECT_TRUE(std::isnan(result));
+      else
+        EXPECT_EQ(ToBits(expected), ToBits(result)) << a << " * " << c << " + " << b;
+    }
+  }
+  FPURoundMode::LoadSIMDState();
+}
+
+// The fused form has to pick the same NaN as the separate multiply and add.
+TEST(JitFMA, NaNOrder)
+{
+  if (!cpu_info.bFMA)
+    return;
+
+  MaddEmitter emitter;
+  MaddFunction fused = emitter.EmitMadd(true);
+  MaddFunction unfused = emitter.EmitMadd(false);
+  const double values[] = {1.5, FromBits(0x7FF8000000000001), FromBits(0xFFF8000000000002),
+                           FromBits(0x7FF0000000000003), FromBits(0xFFF0000000000004)};
+
+  for (double a : values)
+  {
+    for (double c : values)
+    {
+      for (double b : values)
+        EXPECT_EQ(ToBits(unfused(a, c, b)), ToBits(fused(a, c, b)));
+    }
+  }
+}
+
+TEST(JitFMA, Throughput)
+{
+  if (!cpu_info.bFMA)
+    return;
+
+  constexpr u64 ITERATIONS = 10000000;
+  MaddEmitter emitter;
+  alignas(16) double data[12] = {0.5, 0.25, 1.0, 2.0};
+
+  for (bool fused : {false, true})
+  {
+    KernelFunction kernel = emitter.EmitKernel(fused);
+    auto start = std::chrono::high_resolution_clock::now();
+    kernel(data, ITERATIONS);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    printf("%s: %.3f ns per ps_madd\n", fused ? "FMA" : "MULPD+ADDPD",
+           static_cast<double>(ns) / (ITERATIONS * 4));
+  }
+}
@@ -0,0 +1,132 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/PowerPC/JitCommon/JitTiering.h"
+#include "Core/PowerPC/PowerPC.h"
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    PowerPC::Init(PowerPC::CORE_INTERPRETER);
+    CoreTiming::Init();
+  }
+  ~ScopeInit()
+  {
+    CoreTiming::Shutdown();
+    PowerPC::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+// Pretends the CPU executed the given number of cycles.
+void AdvanceTicks(int cycles)
+{
+  PowerPC::ppcState.downcount -= cycles;
+  CoreTiming::Advance();
+}
+
+// Runs a block through tier 0 until it is hot, and returns whether it then got compiled.
+bool TierUp(JitTiering* tiering, u32 address)
+{
+  for (u32 i = 0; i < JitTiering::TIER_UP_THRESHOLD; ++i)
+    EXPECT_TRUE(tiering->ShouldInterpret(address, 0));
+  return !tiering->ShouldInterpret(address, 0);
+}
+}  // namespace
+
+TEST(JitTiering, DisabledNeverInterprets)
+{
+  ScopeInit guard;
+  JitTiering tiering;
+  tiering.Init(false);
+
+  for (int i = 0; i < 4; ++i)
+    EXPECT_FALSE(tiering.ShouldInterpret(0x80003100, 0));
+  EXPECT_EQ(0u, tiering.GetStats().tier0_executions);
+}
+
+TEST(JitTiering, CompilesAfterThreshold)
+{
+  ScopeInit guard;
+  JitTiering tiering;
+  tiering.Init(true);
+
+  EXPECT_TRUE(TierUp(&tiering, 0x80003100));
+  EXPECT_EQ(1u, tiering.GetStats().tier0_blocks);
+  EXPECT_EQ(static_cast<u64>(JitTiering::TIER_UP_THRESHOLD), tiering.GetStats().tier0_executions);
+  EXPECT_EQ(1u, tiering.GetStats().compiled_blocks);
+  EXPECT_EQ(0u, tiering.GetStats().queue_latency_max);
+
+  // Once compiled, the block belongs to the block cache. Getting asked again means it was
+  // invalidated, so it starts over in tier 0.
+  EXPECT_TRUE(tiering.ShouldInterpret(0x80003100, 0));
+  EXPECT_EQ(2u, tiering.GetStats().tier0_blocks);
+}
+
+TEST(JitTiering, MSRBitsAreSeparateBlocks)
+{
+  ScopeInit guard;
+  JitTiering tiering;
+  tiering.Init(true);
+
+  for (u32 i = 0; i < JitTiering::TIER_UP_THRESHOLD; ++i)
+    EXPECT_TRUE(tiering.ShouldInterpret(0x80003100, 0));
+  EXPECT_TRUE(tiering.ShouldInterpret(0x80003100, 0x30));
+  EXPECT_FALSE(tiering.ShouldInterpret(0x80003100, 0));
+  EXPECT_EQ(2u, tiering.GetStats().tier0_blocks);
+}
+
+TEST(JitTiering, ClearRestartsTier0)
+{
+  ScopeInit guard;
+  JitTiering tiering;
+  tiering.Init(true);
+
+  for (u32 i = 0; i < JitTiering::TIER_UP_THRESHOLD; ++i)
+    EXPECT_TRUE(tiering.ShouldInterpret(0x80003100, 0));
+  tiering.Clear();
+  EXPECT_TRUE(TierUp(&tiering, 0x80003100));
+}
+
+TEST(JitTiering, BudgetRefillsWithEmulatedTime)
+{
+  ScopeInit guard;
+  JitTiering tiering;
+  tiering.Init(true);
+
+  u32 address = 0x80003100;
+  for (s64 i = 0; i < JitTiering::MAX_COMPILE_BURST; ++i, address += 4)
+    EXPECT_TRUE(TierUp(&tiering, address));
+
+  // The budget is spent, so a hot block stays queued and keeps running in tier 0.
+  const u32 queued = address;
+  EXPECT_FALSE(TierUp(&tiering, queued));
+  AdvanceTicks(JitTiering::CYCLES_PER_COMPILE - 1);
+  EXPECT_TRUE(tiering.ShouldInterpret(queued, 0));
+  AdvanceTicks(1);
+  EXPECT_FALSE(tiering.ShouldInterpret(queued, 0));
+  EXPECT_EQ(static_cast<u64>(JitTiering::CYCLES_PER_COMPILE), tiering.GetStats().queue_latency_max);
+
+  // Emulated time only saves up a burst's worth of compilations.
+  AdvanceTicks(JitTiering::CYCLES_PER_COMPILE * JitTiering::MAX_COMPILE_BURST * 2);
+  address = 0x80100000;
+  for (s64 i = 0; i < JitTiering::MAX_COMPILE_BURST; ++i, address += 4)
+    EXPECT_TRUE(TierUp(&tiering, address));
+  EXPECT_FALSE(TierUp(&tiering, address));
+  EXPECT_EQ(static_cast<u64>(JitTiering::MAX_COMPILE_BURST * 2 + 1),
+            tiering.GetStats().compiled_blocks);
+}
@@ -0,0 +1,220 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <atomic>
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+constexpr u32 PAGE_TABLE = 0x00100000;
+constexpr u32 VSID = 0x123;
+constexpr u32 PTE2_R = 1 << 8;
+constexpr u32 PTE2_C = 1 << 7;
+
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    SConfig::GetInstance().bMMU = true;
+    SConfig::GetInstance().bMMUFastmem = true;
+    SConfig::GetInstance().bFastmem = true;
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(PowerPC::CORE_INTERPRETER);
+
+    // A hashed page table with no BATs, so that every access goes through it.
+    UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+    msr.DR = 1;
+    PowerPC::ppcState.sr[0] = VSID;
+    PowerPC::ppcState.spr[SPR_SDR] = PAGE_TABLE;
+    PowerPC::SDRUpdated();
+  }
+  ~ScopeInit()
+  {
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+// Adds a page table entry mapping the page at effective_address to physical_address, and returns
+// the address of its second word.
+u32 MapPage(u32 effective_address, u32 physical_address)
+{
+  const u32 page_index = (effective_address >> 12) & 0xffff;
+  const u32 api = (effective_address >> 22) & 0x3f;
+  u32 pte_address = (((VSID ^ page_index) & 0x3ff) << 6) | PAGE_TABLE;
+  while (Memory::Read_U32(pte_address) & 0x80000000)
+    pte_address += 8;
+  Memory::Write_U32(0x80000000 | (VSID << 7) | api, pte_address);
+  Memory::Write_U32(physical_address | 2, pte_address + 4);
+  return pte_address + 4;
+}
+
+Memory::LogicalPageAccess GetAccess(u32 effective_address)
+{
+  return Memory::GetLogicalPageAccess(effective_address);
+}
+
+// Lets the page fault handler map pages the way the JIT's does, without backpatching.
+class MMUFastmemFakeJit : public JitBase
+{
+public:
+  // CPUCoreBase methods
+  void Init() override {}
+  void Shutdown() override {}
+  void ClearCache() override {}
+  void Run() override {}
+  void SingleStep() override {}
+  const char* GetName() override { return nullptr; }
+  // JitBase methods
+  JitBaseBlockCache* GetBlockCache() override { return nullptr; }
+  void Jit(u32 em_address) override {}
+  const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
+  bool HandleFault(uintptr_t access_address, SContext* ctx) override
+  {
+    m_faults++;
+    return PowerPC::HandleLogicalPageFault(
+        static_cast<u32>(access_address - reinterpret_cast<uintptr_t>(Memory::logical_base)));
+  }
+
+  int m_faults = 0;
+};
+}  // namespace
+
+TEST(MMUFastmem, ReadOnlyUntilCBitIsSet)
+{
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::HasLogicalPages());
+
+  const u32 pte2 = MapPage(0x5000, 0x20000);
+  Memory::Write_U32(0x12345678, 0x20000);
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x5000));
+
+  EXPECT_EQ(0x12345678u, PowerPC::Read_U32(0x5000));
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadOnly, GetAccess(0x5000));
+  EXPECT_EQ(PTE2_R, Memory::Read_U32(pte2) & (PTE2_R | PTE2_C));
+  const u32* page = reinterpret_cast<u32*>(Memory::logical_base + 0x5000);
+  EXPECT_EQ(0x12345678u, Common::swap32(page[0]));
+
+  PowerPC::Write_U32(0xCAFEF00D, 0x5004);
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadWrite, GetAccess(0x5000));
+  EXPECT_EQ(PTE2_R | PTE2_C, Memory::Read_U32(pte2) & (PTE2_R | PTE2_C));
+  EXPECT_EQ(0xCAFEF00Du, Common::swap32(page[1]));
+}
+
+TEST(MMUFastmem, TLBIEUnmapsItsSet)
+{
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::HasLogicalPages());
+
+  // 0x5000 and 0x45000 share a TLB set, 0x6000 is in the next one.
+  for (u32 address : {0x5000u, 0x45000u, 0x6000u})
+  {
+    MapPage(address, 0x20000 + address);
+    PowerPC::Read_U32(address);
+    EXPECT_EQ(Memory::LogicalPageAccess::ReadOnly, GetAccess(address));
+  }
+
+  PowerPC::InvalidateTLBEntry(0x5000);
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x5000));
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x45000));
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadOnly, GetAccess(0x6000));
+
+  PowerPC::Read_U32(0x45000);
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadOnly, GetAccess(0x45000));
+}
+
+TEST(MMUFastmem, SDR1UnmapsAllPages)
+{
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::HasLogicalPages());
+
+  for (u32 address : {0x5000u, 0x6000u})
+  {
+    MapPage(address, 0x20000 + address);
+    PowerPC::Read_U32(address);
+  }
+
+  PowerPC::SDRUpdated();
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x5000));
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x6000));
+}
+
+TEST(MMUFastmem, DBATsUnmapAllPages)
+{
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::HasLogicalPages());
+
+  for (u32 address : {0x5000u, 0x6000u})
+  {
+    MapPage(address, 0x20000 + address);
+    PowerPC::Read_U32(address);
+  }
+
+  // A BAT over the pages takes precedence over the page table.
+  PowerPC::ppcState.spr[SPR_DBAT0U] = 0x00001fff;
+  PowerPC::ppcState.spr[SPR_DBAT0L] = 0x00000002;
+  PowerPC::DBATUpdated();
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x5000));
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x6000));
+  PowerPC::Read_U32(0x5000);
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x5000));
+  EXPECT_FALSE(PowerPC::HandleLogicalPageFault(0x5000));
+}
+
+// Fastmem accesses to pages which aren't mapped yet map them and get retried.
+TEST(MMUFastmem, FaultsMapPages)
+{
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::HasLogicalPages());
+
+  const u32 pte2 = MapPage(0x5000, 0x20000);
+  Memory::Write_U32(0x12345678, 0x20000);
+
+  EMM::InstallExceptionHandler();
+  MMUFastmemFakeJit fake_jit;
+  jit = &fake_jit;
+
+  // The fault handler has to see the fake JIT before the first access.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+
+  volatile u32* page = reinterpret_cast<u32*>(Memory::logical_base + 0x5000);
+  EXPECT_EQ(0x12345678u, Common::swap32(page[0]));
+  EXPECT_EQ(1, fake_jit.m_faults);
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadOnly, GetAccess(0x5000));
+  EXPECT_EQ(PTE2_R, Memory::Read_U32(pte2) & (PTE2_R | PTE2_C));
+
+  page[1] = Common::swap32(0xCAFEF00D);
+  EXPECT_EQ(2, fake_jit.m_faults);
+  EXPECT_EQ(Memory::LogicalPageAccess::ReadWrite, GetAccess(0x5000));
+  EXPECT_EQ(PTE2_R | PTE2_C, Memory::Read_U32(pte2) & (PTE2_R | PTE2_C));
+  EXPECT_EQ(0xCAFEF00Du, Memory::Read_U32(0x20004));
+
+  jit = nullptr;
+  EMM::UninstallExceptionHandler();
+
+  // Faults on writeable pages, or on pages the page table doesn't map, are left to the
+  // backpatcher.
+  EXPECT_FALSE(PowerPC::HandleLogicalPageFault(0x5000));
+  EXPECT_FALSE(PowerPC::HandleLogicalPageFault(0x9000));
+  EXPECT_EQ(Memory::LogicalPageAccess::None, GetAccess(0x9000));
+}
@@ -0,0 +1,183 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PPCAnalysisCache.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(PowerPC::CORE_INTERPRETER);
+    m_dir = File::CreateTempDir();
+  }
+  ~ScopeInit()
+  {
+    File::DeleteDirRecursively(m_dir);
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+  std::string GetCacheFilename() const { return m_dir + DIR_SEP "analysis.cache"; }
+
+private:
+  std::string m_dir;
+};
+
+constexpr u32 CODE_ADDRESS = 0x3000;
+constexpr u32 BLR = 0x4E800020;
+
+void WriteCode(const std::vector<u32>& code)
+{
+  for (size_t i = 0; i < code.size(); i++)
+    Memory::Write_U32(code[i], CODE_ADDRESS + static_cast<u32>(i * 4));
+}
+
+class Analysis final
+{
+public:
+  Analysis() : buffer(32)
+  {
+    block.m_stats = &stats;
+    block.m_gpa = &gpa;
+    block.m_fpa = &fpa;
+  }
+
+  // Analyzes the code at CODE_ADDRESS, through the cache if there is one.
+  void Run(PPCAnalyst::AnalysisCache* cache)
+  {
+    PPCAnalyst::PPCAnalyzer analyzer;
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE);
+    analyzer.SetCache(cache);
+    next_pc = analyzer.Analyze(CODE_ADDRESS, &block, &buffer, buffer.GetSize());
+  }
+
+  PPCAnalyst::CodeBuffer buffer;
+  PPCAnalyst::BlockStats stats;
+  PPCAnalyst::BlockRegStats gpa;
+  PPCAnalyst::BlockRegStats fpa;
+  PPCAnalyst::CodeBlock block;
+  u32 next_pc = 0;
+};
+
+// Checks that analyzing the code at CODE_ADDRESS through the cache gives what analyzing it
+// gives without one.
+void ExpectSameAsUncached(const Analysis& cached)
+{
+  Analysis expected;
+  expected.Run(nullptr);
+
+  EXPECT_EQ(expected.next_pc, cached.next_pc);
+  EXPECT_EQ(expected.stats.numCycles, cached.stats.numCycles);
+  EXPECT_EQ(expected.block.m_gpr_inputs, cached.block.m_gpr_inputs);
+  EXPECT_EQ(expected.block.m_gpr_overwritten, cached.block.m_gpr_overwritten);
+  ASSERT_EQ(expected.block.m_num_instructions, cached.block.m_num_instructions);
+  for (u32 reg = 0; reg < 32; reg++)
+  {
+    EXPECT_EQ(expected.gpa.numReads[reg], cached.gpa.numReads[reg]);
+    EXPECT_EQ(expected.gpa.lastWrite[reg], cached.gpa.lastWrite[reg]);
+  }
+  for (u32 i = 0; i < expected.block.m_num_instructions; i++)
+  {
+    const PPCAnalyst::CodeOp& expected_op = expected.buffer.codebuffer[i];
+    const PPCAnalyst::CodeOp& op = cached.buffer.codebuffer[i];
+    EXPECT_EQ(expected_op.inst.hex, op.inst.hex);
+    EXPECT_EQ(expected_op.opinfo, op.opinfo);
+    EXPECT_EQ(expected_op.address, op.address);
+    EXPECT_EQ(expected_op.regsIn, op.regsIn);
+    EXPECT_EQ(expected_op.regsOut, op.regsOut);
+    EXPECT_EQ(expected_op.gprInUse, op.gprInUse);
+    EXPECT_EQ(expected_op.canEndBlock, op.canEndBlock);
+  }
+}
+
+// addi r3, r3, 1; blr
+const std::vector<u32> FIRST_CODE = {0x38630001, BLR};
+// add r4, r4, r5; blr
+const std::vector<u32> SECOND_CODE = {0x7C842A14, BLR};
+}  // namespace
+
+// An entry which went stale because the code changed is stored again once the new code is
+// analyzed, and that is what the next session loads.
+TEST(PPCAnalysisCache, StaleEntriesAreReplaced)
+{
+  ScopeInit guard;
+  PPCAnalyst::AnalysisCache cache;
+
+  WriteCode(FIRST_CODE);
+  cache.Open(guard.GetCacheFilename());
+  Analysis().Run(&cache);
+  EXPECT_EQ(1u, cache.GetStats().misses);
+  cache.Close();
+
+  cache.Open(guard.GetCacheFilename());
+  EXPECT_EQ(1u, cache.GetStats().loaded);
+  Analysis first;
+  first.Run(&cache);
+  EXPECT_EQ(1u, cache.GetStats().hits);
+  ExpectSameAsUncached(first);
+
+  WriteCode(SECOND_CODE);
+  Analysis().Run(&cache);
+  EXPECT_EQ(1u, cache.GetStats().stale);
+  Analysis second;
+  second.Run(&cache);
+  EXPECT_EQ(2u, cache.GetStats().hits);
+  ExpectSameAsUncached(second);
+  cache.Close();
+
+  cache.Open(guard.GetCacheFilename());
+  EXPECT_EQ(1u, cache.GetStats().loaded);
+  Analysis reloaded;
+  reloaded.Run(&cache);
+  EXPECT_EQ(1u, cache.GetStats().hits);
+  EXPECT_EQ(0u, cache.GetStats().stale);
+  ExpectSameAsUncached(reloaded);
+  cache.Close();
+}
+
+TEST(PPCAnalysisCache, UnchangedEntriesAreWrittenOnce)
+{
+  ScopeInit guard;
+  PPCAnalyst::AnalysisCache cache;
+
+  WriteCode(FIRST_CODE);
+  Analysis analysis;
+  analysis.Run(nullptr);
+  const PPCAnalyst::AnalysisCache::Key key = {CODE_ADDRESS, 0, 0, 32, 0};
+
+  cache.Open(guard.GetCacheFilename());
+  cache.Store(key, analysis.block, analysis.buffer, analysis.next_pc);
+  cache.Close();
+  const u64 size = File::GetSize(guard.GetCacheFilename());
+
+  cache.Open(guard.GetCacheFilename());
+  cache.Store(key, analysis.block, analysis.buffer, analysis.next_pc);
+  cache.Store(key, analysis.block, analysis.buffer, analysis.next_pc);
+  cache.Close();
+  EXPECT_EQ(size, File::GetSize(guard.GetCacheFilename()));
+}
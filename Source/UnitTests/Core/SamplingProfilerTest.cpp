@@ -0,0 +1,62 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <string>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "Core/SamplingProfiler.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+// Keeps this thread busy for the given amount of CPU time, roughly.
+void Spin(std::chrono::milliseconds duration)
+{
+  const auto end = std::chrono::steady_clock::now() + duration;
+  volatile u32 counter = 0;
+  while (std::chrono::steady_clock::now() < end)
+    counter = counter + 1;
+}
+}  // namespace
+
+TEST(SamplingProfiler, AttributesSamplesToSubsystems)
+{
+  if (!SamplingProfiler::IsSupported())
+    return;
+
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::CPU);
+  PowerPC::ppcState.pc = 0x80003100;
+  ASSERT_TRUE(SamplingProfiler::Start(1000));
+  EXPECT_TRUE(SamplingProfiler::IsRunning());
+  EXPECT_FALSE(SamplingProfiler::Start(1000));
+
+  Spin(std::chrono::milliseconds(300));
+  {
+    SamplingProfiler::ScopedSubsystem scope(SamplingProfiler::Subsystem::Video);
+    EXPECT_EQ(SamplingProfiler::Subsystem::Video, SamplingProfiler::GetThreadSubsystem());
+    Spin(std::chrono::milliseconds(300));
+  }
+  EXPECT_EQ(SamplingProfiler::Subsystem::CPU, SamplingProfiler::GetThreadSubsystem());
+
+  SamplingProfiler::Stop();
+  EXPECT_FALSE(SamplingProfiler::IsRunning());
+  SamplingProfiler::SetThreadSubsystem(SamplingProfiler::Subsystem::Other);
+
+  const std::string dir = File::CreateTempDir();
+  const std::string filename = dir + "/samples.txt";
+  SamplingProfiler::WriteReport(filename);
+  std::string report;
+  ASSERT_TRUE(File::ReadFileToString(filename, report));
+  File::DeleteDirRecursively(dir);
+
+  // Without a JIT, samples on the CPU thread are attributed to the function
+  // at PC, and there is no symbol map.
+  EXPECT_NE(std::string::npos, report.find("CPU;Host;[unknown function] "));
+  EXPECT_NE(std::string::npos, report.find("Video "));
+}
@@ -0,0 +1,217 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <functional>
+
+#include "Common/BreakPoints.h"
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+constexpr u32 WATCHED_ADDRESS = 0x80011234;
+constexpr u32 CODE_ADDRESS = 0x3000;
+
+// Changing the memory checks schedules an event to update the logical view and the JIT, which
+// isn't allowed from the CPU thread, so do its work right away instead.
+void UpdateMemChecks(const std::function<void()>& update)
+{
+  JitBase* const current_jit = jit;
+  jit = nullptr;
+  update();
+  jit = current_jit;
+  PowerPC::DBATUpdated();
+  JitInterface::ClearCache();
+}
+
+class ScopeInit final
+{
+public:
+  explicit ScopeInit(int core = PowerPC::CORE_INTERPRETER)
+  {
+    Core::DeclareAsCPUThread();
+    SConfig::Init();
+    CoreTiming::Init();
+    Memory::Init();
+    PowerPC::Init(core);
+
+    // The BATs set up by the IPL.
+    UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+    msr.DR = 1;
+    PowerPC::ppcState.spr[SPR_DBAT0U] = 0x80001fff;
+    PowerPC::ppcState.spr[SPR_DBAT0L] = 0x00000002;
+  }
+  ~ScopeInit()
+  {
+    UpdateMemChecks([] { PowerPC::memchecks.Clear(); });
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    CoreTiming::Shutdown();
+    SConfig::Shutdown();
+    Core::UndeclareAsCPUThread();
+  }
+};
+
+void Watch(u32 address)
+{
+  TMemCheck mc;
+  mc.StartAddress = mc.EndAddress = address;
+  mc.OnRead = mc.OnWrite = true;
+  UpdateMemChecks([&mc] { PowerPC::memchecks.Add(mc); });
+}
+
+// Records faults in the logical view, and maps the memory again by dropping the memory checks,
+// so that the access can be retried.
+class WatchedMemoryFakeJit : public JitBase
+{
+public:
+  // CPUCoreBase methods
+  void Init() override {}
+  void Shutdown() override {}
+  void ClearCache() override {}
+  void Run() override {}
+  void SingleStep() override {}
+  const char* GetName() override { return nullptr; }
+  // JitBase methods
+  JitBaseBlockCache* GetBlockCache() override { return nullptr; }
+  void Jit(u32 em_address) override {}
+  const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
+  bool HandleFault(uintptr_t access_address, SContext* ctx) override
+  {
+    m_faults++;
+    m_fault_address =
+        static_cast<u32>(access_address - reinterpret_cast<uintptr_t>(Memory::logical_base));
+
+    // Without a JIT to clear, updating the memory checks and the view is safe here.
+    jit = nullptr;
+    PowerPC::memchecks.Clear();
+    PowerPC::DBATUpdated();
+    jit = this;
+    return true;
+  }
+
+  int m_faults = 0;
+  u32 m_fault_address = 0;
+};
+}  // namespace
+
+// Only the chunk around a memory check is left out of the logical view, so accesses next to it
+// keep using fastmem.
+TEST(WatchedMemory, OnlyWatchedChunkFaults)
+{
+  ScopeInit guard;
+  Memory::Write_U32(0x12345678, WATCHED_ADDRESS & 0x0fffffff);
+  Memory::Write_U32(0x9abcdef0, 0x00020000);
+  Watch(WATCHED_ADDRESS);
+
+  EXPECT_TRUE(Memory::IsWatchedLogicalChunk(WATCHED_ADDRESS));
+  EXPECT_TRUE(Memory::IsWatchedLogicalChunk(0x80010000));
+  EXPECT_FALSE(Memory::IsWatchedLogicalChunk(0x80020000));
+  EXPECT_FALSE(Memory::IsWatchedLogicalChunk(0x8000fffc));
+  // The other pages of the chunk aren't mapped either, so constant accesses can't go straight to
+  // memory.
+  EXPECT_FALSE(PowerPC::IsOptimizableRAMAddress(WATCHED_ADDRESS));
+  EXPECT_FALSE(PowerPC::IsOptimizableRAMAddress(0x80010000));
+  EXPECT_TRUE(PowerPC::IsOptimizableRAMAddress(0x80020000));
+
+  EMM::InstallExceptionHandler();
+  WatchedMemoryFakeJit fake_jit;
+  jit = &fake_jit;
+  // The fault handler has to see the fake JIT before the first access.
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+
+  volatile u32* neighbour = reinterpret_cast<u32*>(Memory::logical_base + 0x80020000);
+  EXPECT_EQ(0x9abcdef0u, Common::swap32(*neighbour));
+  EXPECT_EQ(0, fake_jit.m_faults);
+
+  volatile u32* watched = reinterpret_cast<u32*>(Memory::logical_base + WATCHED_ADDRESS);
+  EXPECT_EQ(0x12345678u, Common::swap32(*watched));
+  EXPECT_EQ(1, fake_jit.m_faults);
+  EXPECT_EQ(WATCHED_ADDRESS, fake_jit.m_fault_address);
+
+  jit = nullptr;
+  EMM::UninstallExceptionHandler();
+}
+
+// The quantized load routines are generated once when the JIT starts, so they have to handle
+// memory checks added afterwards.
+TEST(WatchedMemory, PairedLoadWithNonConstantGQR)
+{
+  ScopeInit guard(PowerPC::CORE_JIT64);
+  EMM::InstallExceptionHandler();
+  Memory::Write_U32(0x12345678, WATCHED_ADDRESS & 0x0fffffff);
+  Watch(WATCHED_ADDRESS);
+  EXPECT_FALSE(PowerPC::IsOptimizableRAMAddress(WATCHED_ADDRESS));
+
+  const u32 code[] = {
+      0x7CB1E3A6,  // mtspr GQR1, r5
+      0xE0231000,  // psq_l f1, 0(r3), 0, 1
+      0x48000000,  // b .
+  };
+  for (u32 i = 0; i < ArraySize(code); i++)
+    Memory::Write_U32(code[i], CODE_ADDRESS + i * 4);
+
+  UReg_MSR& msr = reinterpret_cast<UReg_MSR&>(PowerPC::ppcState.msr);
+  msr.FP = 1;
+  // Setting the GQR in the block keeps the JIT from inlining the load.
+  GPR(3) = WATCHED_ADDRESS;
+  GPR(5) = 0x00040000;  // Load unsigned bytes without scaling.
+  PC = CODE_ADDRESS;
+  NPC = CODE_ADDRESS + 4;
+  for (int i = 0; i < 10 && PC != CODE_ADDRESS + 8; i++)
+    PowerPC::SingleStep();
+
+  EXPECT_EQ(CODE_ADDRESS + 8, PC);
+  EXPECT_EQ(0x12, rPS0(1));
+  EXPECT_EQ(0x34, rPS1(1));
+  EXPECT_EQ(1u, PowerPC::memchecks.GetMemCheck(WATCHED_ADDRESS)->numHits);
+
+  EMM::UninstallExceptionHandler();
+}
+
+// Loads from constant addresses only go through the memory functions when they're watched, and
+// update their base register after the memory check.
+TEST(WatchedMemory, ConstantAddressLoads)
+{
+  ScopeInit guard(PowerPC::CORE_JIT64);
+  EMM::InstallExceptionHandler();
+  Memory::Write_U32(0x12345678, WATCHED_ADDRESS & 0x0fffffff);
+  Memory::Write_U32(0x9abcdef0, 0x00020000);
+  Watch(WATCHED_ADDRESS);
+
+  const u32 code[] = {
+      0x3C608001,  // lis r3, 0x8001
+      0x84831234,  // lwzu r4, 0x1234(r3)
+      0x3CA08002,  // lis r5, 0x8002
+      0x80C50000,  // lwz r6, 0(r5)
+      0x48000000,  // b .
+  };
+  for (u32 i = 0; i < ArraySize(code); i++)
+    Memory::Write_U32(code[i], CODE_ADDRESS + i * 4);
+
+  PC = CODE_ADDRESS;
+  NPC = CODE_ADDRESS + 4;
+  for (int i = 0; i < 10 && PC != CODE_ADDRESS + 16; i++)
+    PowerPC::SingleStep();
+
+  EXPECT_EQ(CODE_ADDRESS + 16, PC);
+  EXPECT_EQ(WATCHED_ADDRESS, GPR(3));
+  EXPECT_EQ(0x12345678u, GPR(4));
+  EXPECT_EQ(0x9abcdef0u, GPR(6));
+  EXPECT_EQ(1u, PowerPC::memchecks.GetMemCheck(WATCHED_ADDRESS)->numHits);
+
+  EMM::UninstallExceptionHandler();
+}